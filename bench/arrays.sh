@@ -0,0 +1,60 @@
+#!/bin/sh
+# Compare whole-array operations across kernel sets, and with element loops.
+#
+# Usage: bench/arrays.sh [IZMIR [RUN_NO]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark runs bench/arrays.iz RUN_NO
+# times (default 3) with each kernel set the processor supports, and then a
+# version of the same program computing every whole-array operation with an
+# element loop.  Every configuration must print the same result.  Times are
+# wall-clock averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+run_no=${2:-3}
+program="$(dirname "$0")/arrays.iz"
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-arrays-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# The same computation, one element at a time.
+loops="$work/arrays-loops.iz"
+cat > "$loops" <<'END'
+var n = 100000, a = array(n), b = array(n), c = array(n), i = 0;
+while i < n do
+  a[i] := i mod 1000;
+  b[i] := (i * 7) mod 1009 - 500;
+  i := i + 1;
+end
+var round = 0, result = 0;
+while round < 1000 do
+  var s = 0, largest = 0, smallest = b[0];
+  i := 0;
+  while i < n do
+    c[i] := (a[i] + b[i]) * b[i];
+    s := s + a[i] * b[i] + c[i];
+    if i = 0 or c[i] > largest then
+      largest := c[i];
+    end
+    if b[i] < smallest then
+      smallest := b[i];
+    end
+    i := i + 1;
+  end
+  result := result + s + largest - smallest;
+  round := round + 1;
+end
+print result;
+END
+
+expected=$("$izmir" --array-kernels=portable "$program")
+for set in portable sse4.2 avx2; do
+  if "$izmir" --array-kernels=$set "$program" > /dev/null 2>&1; then
+    printf '%-9s %s ms\n' "$set:" "$(measure_checked "$program" --array-kernels=$set)"
+  else
+    echo "$set: not supported"
+  fi
+done
+printf '%-9s %s ms\n' "loops:" "$(measure_checked "$loops")"
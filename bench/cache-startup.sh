@@ -0,0 +1,37 @@
+#!/bin/sh
+# Compare izmir startup time without and with a warm compiled-code cache.
+#
+# Usage: bench/cache-startup.sh [IZMIR [STATEMENT_NO [RUN_NO]]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark generates a long
+# straight-line program of STATEMENT_NO statements (default 20000), so that
+# front-end time dominates, and runs it RUN_NO times (default 10) in each
+# configuration:
+#   - no cache: parse, optimize and compile every time;
+#   - cold: with --cache-dir pointing to an empty directory, which also pays
+#     for writing the entry;
+#   - warm: with --cache-dir pointing to a populated cache, which maps the
+#     entry and skips the front end.
+# Times are wall-clock averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+statement_no=${2:-20000}
+run_no=${3:-10}
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-cache-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# Generate the program.
+program="$work/straight-line.iz"
+"$(dirname "$0")/generate-straight-line.sh" "$statement_no" > "$program"
+
+cache="$work/cache"
+echo "statements: $statement_no, runs per configuration: $run_no"
+echo "no cache:   $(measure '"$izmir" --no-cache "$program"') ms"
+echo "cold cache: $(measure '"$izmir" --cache-dir="$cache" "$program"' \
+                            'rm -rf "$cache"') ms"
+"$izmir" --cache-dir="$cache" "$program" > /dev/null
+echo "warm cache: $(measure '"$izmir" --cache-dir="$cache" "$program"') ms"
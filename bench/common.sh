@@ -0,0 +1,47 @@
+# Shell functions shared by the benchmark scripts, which source this file.
+# measure and measure_checked use the variables izmir , the izmir executable,
+# and run_no , the number of runs to average over.
+
+# Print the current time in nanoseconds.
+now () {
+  date +%s%N
+}
+
+# Evaluate the given shell command RUN_NO times, with its standard output
+# discarded, and print the average wall-clock time in milliseconds.  If a
+# second command is given, evaluate it untimed before each run.
+measure () {
+  total=0
+  i=0
+  while [ $i -lt "$run_no" ]; do
+    eval "${2:-:}"
+    start=$(now)
+    eval "$1" > /dev/null
+    end=$(now)
+    total=$((total + end - start))
+    i=$((i + 1))
+  done
+  echo $((total / run_no / 1000000))
+}
+
+# Run izmir on the given program with the given options RUN_NO times, check
+# that it prints the value of the variable expected , and print the average
+# wall-clock time in milliseconds.
+measure_checked () {
+  file=$1
+  shift
+  total=0
+  i=0
+  while [ $i -lt "$run_no" ]; do
+    start=$(now)
+    result=$("$izmir" "$@" "$file")
+    end=$(now)
+    if [ "$result" != "$expected" ]; then
+      echo "$*: printed $result instead of $expected" >&2
+      exit 1
+    fi
+    total=$((total + end - start))
+    i=$((i + 1))
+  done
+  echo $((total / run_no / 1000000))
+}
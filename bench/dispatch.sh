@@ -0,0 +1,36 @@
+#!/bin/sh
+# Compare the run time of an izmir program across Jitter dispatch models.
+#
+# Usage: bench/dispatch.sh [IZMIR [PROGRAM [RUN_NO]]]
+#
+# IZMIR defaults to ./build/izmir , the launcher; every dispatch model it was
+# built with is measured.  PROGRAM defaults to a generated loop-heavy program,
+# where dispatch dominates.  Times are wall-clock averages over RUN_NO runs
+# (default 5), in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+program=$2
+run_no=${3:-5}
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-dispatch-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+if [ -z "$program" ]; then
+  program="$work/loop.iz"
+  cat > "$program" <<'PROGRAM'
+var i = 0, s = 0;
+while i < 50000000 do
+  s := (s + i * 3) mod 1000003;
+  i := i + 1;
+end
+print s;
+PROGRAM
+fi
+
+for dispatch in $("$izmir" --dispatch=list); do
+  printf '%-20s %8d ms\n' "$dispatch" \
+    "$(measure '"$izmir" --dispatch="$dispatch" "$program"')"
+done
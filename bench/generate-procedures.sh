@@ -0,0 +1,33 @@
+#!/bin/sh
+# Print an izmir program with many procedures on the standard output.
+#
+# Usage: bench/generate-procedures.sh [PROCEDURE_NO [STATEMENT_NO]]
+#
+# The program defines PROCEDURE_NO procedures (default 5000), each a loop over
+# STATEMENT_NO straight-line statements (default 40) calling the previous
+# procedure, and calls the last one once.  Compilation dominates, and is
+# spread evenly across procedures.
+
+set -e
+
+procedure_no=${1:-5000}
+statement_no=${2:-40}
+
+awk -v n="$procedure_no" -v m="$statement_no" 'BEGIN {
+  for (i = 0; i < n; i ++)
+    {
+      printf "procedure p%i (a, b)\n", i
+      printf "  var x = a, y = b, k = 0;\n"
+      printf "  repeat\n"
+      for (j = 0; j < m; j ++)
+        printf "    x := x + %i * y; y := (y + x) mod 1000 + 1;\n", i + j
+      printf "    k := k + 1;\n"
+      printf "  until k >= 2;\n"
+      if (i > 0)
+        printf "  return p%i (x mod 97, y);\n", i - 1
+      else
+        printf "  return x + y;\n"
+      printf "end;\n"
+    }
+  printf "print p%i (1, 2);\n", n - 1
+}'
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Print a long straight-line izmir program on the standard output.
+#
+# Usage: bench/generate-straight-line.sh [STATEMENT_NO]
+#
+# The program has no loops or procedures: it assigns two variables
+# STATEMENT_NO times (default 100000), so that running it takes almost no
+# time and the front end dominates.  Every statement is different, so that
+# neither the optimizer nor the rewriter can collapse them.
+
+set -e
+
+statement_no=${1:-100000}
+
+echo 'var x = 0, y = 1;'
+awk -v n="$statement_no" 'BEGIN {
+  for (i = 0; i < n; i ++)
+    printf "x := x + %i * y; y := (y + x) mod 1000 + 1;\n", i
+}'
+echo 'print x;'
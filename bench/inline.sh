@@ -0,0 +1,23 @@
+#!/bin/sh
+# Compare run times with and without inlining of small procedures.
+#
+# Usage: bench/inline.sh [IZMIR [RUN_NO]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark runs bench/inline.iz , whose
+# hot loop calls small helper procedures, RUN_NO times (default 3) with
+# inlining disabled, with the default inlining budget and with a large one.
+# Every configuration must print the same result.  Times are wall-clock
+# averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+run_no=${2:-3}
+program="$(dirname "$0")/inline.iz"
+. "$(dirname "$0")/common.sh"
+
+expected=$("$izmir" --inline-budget=0 "$program")
+for budget in 0 40 1000; do
+  printf '%-20s %s ms\n' "--inline-budget=$budget:" \
+    "$(measure_checked "$program" --inline-budget=$budget)"
+done
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Measure how fast izmir reads integers with the input primitive.
+#
+# Usage: bench/input.sh [IZMIR [NUMBER_NO [RUN_NO]]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark generates NUMBER_NO random
+# integers (default 10000000) and runs a program adding them all up RUN_NO
+# times (default 3) in each configuration:
+#   - pipe: the numbers come through a pipe, and are read in blocks;
+#   - file: the standard input is the file, which is mapped into memory.
+# Times are wall-clock averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+number_no=${2:-10000000}
+run_no=${3:-3}
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-input-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+program="$work/sum.iz"
+cat > "$program" <<PROGRAM
+var i = 0, s = 0;
+while i < $number_no do
+  s := s + input;
+  i := i + 1;
+end
+print s;
+PROGRAM
+
+numbers="$work/numbers.txt"
+awk -v n="$number_no" 'BEGIN {
+  srand (1);
+  for (i = 0; i < n; i ++)
+    printf "%i\n", int (rand () * 2000000) - 1000000
+}' > "$numbers"
+
+echo "numbers: $number_no, runs per configuration: $run_no"
+echo "pipe: $(measure 'cat "$numbers" | "$izmir" "$program"') ms"
+echo "file: $(measure '"$izmir" "$program" < "$numbers"') ms"
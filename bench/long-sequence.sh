@@ -0,0 +1,68 @@
+#!/bin/sh
+# Check that very long statement sequences compile in bounded stack space and
+# linear time.
+#
+# Usage: bench/long-sequence.sh [IZMIR [STATEMENT_NO [STACK_KIB]]]
+#
+# IZMIR defaults to ./build/izmir .  The script generates two straight-line
+# programs, one of STATEMENT_NO statements (default 10000000) and one a tenth
+# as long, and compiles each with --dry-run --time under a stack limit of
+# STACK_KIB KiB (default 256), far less than a recursive parser or code
+# generator would need.  It prints the phase times in seconds and fails if
+# either run fails, or if the long program takes more than twenty times as
+# long to parse and compile as the short one.  It then compiles, under the same
+# limit, a program of 20000 consecutive variable declarations, each of which
+# opens a block nested in the previous one; only failure is checked, since
+# scope lookup is linear in the number of visible variables.
+
+set -e
+
+izmir=${1:-./build/izmir}
+statement_no=${2:-10000000}
+stack_kib=${3:-256}
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-long-sequence.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# Compile a generated program of the given number of statements with the stack
+# limit, and print its parse and compile times in seconds, space-separated.
+# The generator emits two statements per line.
+measure () {
+  program="$work/program-$1.iz"
+  "$(dirname "$0")/generate-straight-line.sh" $(($1 / 2)) > "$program"
+  if ! (ulimit -s "$stack_kib" \
+        && "$izmir" --dry-run --time "$program" \
+             2> "$work/times" > /dev/null); then
+    echo "compiling $1 statements failed with a $stack_kib KiB stack" >&2
+    cat "$work/times" >&2
+    exit 1
+  fi
+  awk -F, 'END { print $1, $2 }' "$work/times"
+  rm -f "$program"
+}
+
+short=$(measure $((statement_no / 10)))
+long=$(measure "$statement_no")
+echo "$short" "$long" | awk -v n="$statement_no" -v stack="$stack_kib" '{
+  short = $1 + $2; long = $3 + $4
+  printf "stack limit: %i KiB\n", stack
+  printf "%12i statements: parse %.3f s, compile %.3f s\n", n / 10, $1, $2
+  printf "%12i statements: parse %.3f s, compile %.3f s\n", n, $3, $4
+  ratio = (short > 0) ? long / short : 0
+  printf "growth for 10x statements: %.1fx\n", ratio
+  if (ratio > 20) {
+    print "front-end time grows faster than linearly" > "/dev/stderr"
+    exit 1
+  }
+}'
+
+program="$work/declarations.iz"
+awk 'BEGIN { for (i = 0; i < 20000; i ++) printf "var x%i = %i;\n", i, i;
+             print "print x19999;" }' > "$program"
+if ! (ulimit -s "$stack_kib" \
+      && "$izmir" --dry-run "$program" > /dev/null 2> "$work/errors"); then
+  echo "compiling 20000 declarations failed with a $stack_kib KiB stack" >&2
+  cat "$work/errors" >&2
+  exit 1
+fi
+echo "20000 nested declarations: compiled"
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Compare the ways izmir can write the output of print instructions.
+#
+# Usage: bench/output.sh [IZMIR [RUN_NO]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark runs bench/print.iz , which
+# prints millions of integers, RUN_NO times (default 3) in each configuration:
+#   - printf: --output-buffer-size=0 , one printf call per number;
+#   - buffered: the default buffer, flushed to the standard output stream;
+#   - writev: the default buffer, written to file descriptor 1 with writev .
+# Output goes to /dev/null .  Times are wall-clock averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+run_no=${2:-3}
+program="$(dirname "$0")/print.iz"
+. "$(dirname "$0")/common.sh"
+
+echo "printf:   $(measure '"$izmir" --output-buffer-size=0 "$program"') ms"
+echo "buffered: $(measure '"$izmir" "$program"') ms"
+echo "writev:   $(measure '"$izmir" --output-fd=1 "$program"') ms"
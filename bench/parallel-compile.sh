@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compare compilation times with different numbers of compilation threads, and
+# check that every thread count yields the same routine.
+#
+# Usage: bench/parallel-compile.sh [IZMIR [PROCEDURE_NO [JOB_NOS]]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark generates a program of
+# PROCEDURE_NO procedures (default 5000) and compiles it with --dry-run
+# --time once for each thread count in the space-separated list JOB_NOS
+# (default "1 2 4 0", where 0 means one per processor).  It fails if the
+# printed routine differs from the one compiled with the first thread count.
+
+set -e
+
+izmir=${1:-./build/izmir}
+procedure_no=${2:-5000}
+job_nos=${3:-1 2 4 0}
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-parallel.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+program="$work/procedures.iz"
+"$(dirname "$0")/generate-procedures.sh" "$procedure_no" > "$program"
+
+echo "procedures: $procedure_no"
+reference=
+for job_no in $job_nos; do
+  "$izmir" --dry-run --time --print --jobs="$job_no" "$program" \
+    2> "$work/times" > "$work/routine-$job_no"
+  awk -F, -v j="$job_no" 'END {
+    printf "jobs %3s: parse %.3f s, compile %.3f s\n", j, $1, $2 }' \
+    "$work/times"
+  if [ -z "$reference" ]; then
+    reference="$work/routine-$job_no"
+  elif ! cmp -s "$reference" "$work/routine-$job_no"; then
+    echo "the routine compiled with --jobs=$job_no differs" >&2
+    exit 1
+  fi
+done
@@ -0,0 +1,91 @@
+#!/bin/sh
+# Check that the rewrite rules still match the code the generators emit, and
+# compare run times with and without them.
+#
+# Usage: bench/rewriting.sh [IZMIR [RUN_NO]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark prints the routine of every
+# bench/*.iz program, and of a small program written to exercise every rule,
+# with both code generators, and fails if any instruction introduced by a rule
+# in izmirvm.jitter never appears: such a rule matches nothing the generators
+# emit.  It then runs the call-heavy programs RUN_NO times (default 3) with
+# each generator, with and without --no-optimization-rewriting ; every
+# configuration must print the same result.  Times are wall-clock averages in
+# milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+run_no=${2:-3}
+bench_dir=$(dirname "$0")
+specification="$bench_dir/../izmirvm.jitter"
+. "$bench_dir/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-rewriting-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# Comparisons as values and as conditions, arithmetic with a literal operand,
+# assignments followed by uses, and calls with live registers and computed
+# actuals.
+cat > "$work/rules.iz" <<'END'
+procedure f (a, b, c)
+  return a + b + c;
+end;
+
+var x = input, y = input, z = input;
+print x = 0;
+print x <> 0;
+print x + 1;
+print x - 1;
+print x * 10;
+if x = 1 then print 1; else print 0; end
+if x <> 1 then print 1; else print 0; end
+if x < 1 then print 1; else print 0; end
+if x <= 1 then print 1; else print 0; end
+if x > 1 then print 1; else print 0; end
+if x >= 1 then print 1; else print 0; end
+y := f (x, y, z) + f (x + y, x - 1, z);
+print y;
+print x + y + z;
+END
+
+# Optimization is disabled so that constant folding and inlining do not hide
+# the sequences the generators emit for source code like the above.
+for generator in --stack --register; do
+  for program in "$bench_dir"/*.iz "$work/rules.iz"; do
+    "$izmir" $generator -O0 --print --dry-run "$program" < /dev/null
+  done
+done > "$work/routines"
+
+# Every instruction on the right-hand side of a rule must occur somewhere.
+awk '/^into$/ { into = 1; next }
+     /^end$/ { into = 0 }
+     into { gsub (/[;,]/, " ");
+            for (i = 1; i <= NF; i ++) if ($i !~ /^\$/) print $i }' \
+  "$specification" | sort -u > "$work/introduced"
+status=0
+while read -r instruction; do
+  if awk -v name="$instruction" '
+       { for (i = 1; i <= NF; i ++) if ($i == name) found = 1 }
+       END { exit ! found }' "$work/routines"; then
+    echo "$instruction: introduced"
+  else
+    echo "$instruction: never introduced" >&2
+    status=1
+  fi
+done < "$work/introduced"
+if [ $status -ne 0 ]; then
+  exit $status
+fi
+
+for name in fib calls; do
+  program="$bench_dir/$name.iz"
+  expected=$("$izmir" --no-optimization-rewriting "$program")
+  for generator in --stack --register; do
+    printf '%-7s %-11s %-28s %s ms\n' "$name" "$generator" "rewriting:" \
+      "$(measure_checked "$program" $generator)"
+    printf '%-7s %-11s %-28s %s ms\n' "$name" "$generator" \
+      "--no-optimization-rewriting:" \
+      "$(measure_checked "$program" $generator --no-optimization-rewriting)"
+  done
+done
@@ -0,0 +1,77 @@
+#!/bin/sh
+# Run the izmir benchmark suite and write the results as CSV and JSON.
+#
+# Usage: bench/run.sh [IZMIR [OUTPUT_PREFIX [RUN_NO]]]
+#
+# IZMIR defaults to ./build/izmir , the launcher; every dispatch model it was
+# built with is measured.  The programs are every bench/*.iz file, plus a
+# straight-line program from generate-straight-line.sh where the front end
+# dominates.  Each program is run RUN_NO times (default 3) with --time , and
+# the phase times are averaged.
+#
+# The results go to OUTPUT_PREFIX.csv and OUTPUT_PREFIX.json (default
+# ./bench-results), one record per program and dispatch model, with times in
+# seconds.  The instruction count and rate are only filled in when izmir was
+# configured with -DIZMIR_PROFILE_COUNT=ON , which also slows execution down;
+# compare times between builds with the same setting.
+
+set -e
+
+izmir=${1:-./build/izmir}
+output=${2:-./bench-results}
+run_no=${3:-3}
+bench_dir=$(dirname "$0")
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+"$bench_dir/generate-straight-line.sh" > "$work/straight-line.iz"
+
+csv="$output.csv"
+json="$output.json"
+echo 'program,dispatch,parse,compile,specialize,execute,instructions,instructions_per_second' \
+  > "$csv"
+
+for program in "$bench_dir"/*.iz "$work/straight-line.iz"; do
+  name=$(basename "$program" .iz)
+  for dispatch in $("$izmir" --dispatch=list); do
+    i=0
+    : > "$work/times"
+    while [ $i -lt "$run_no" ]; do
+      "$izmir" --dispatch="$dispatch" --time "$program" \
+        2>> "$work/times" > /dev/null
+      i=$((i + 1))
+    done
+    # Every run prints one line parse,compile,specialize,execute,instructions
+    # on stderr.
+    awk -F, -v name="$name" -v dispatch="$dispatch" '
+      { for (i = 1; i <= 4; i ++) t[i] += $i; instructions = $5; n ++ }
+      END {
+        for (i = 1; i <= 4; i ++) t[i] /= n;
+        rate = "";
+        if (instructions != "" && t[4] > 0)
+          rate = sprintf ("%.0f", instructions / t[4]);
+        printf "%s,%s,%.6f,%.6f,%.6f,%.6f,%s,%s\n", name, dispatch,
+               t[1], t[2], t[3], t[4], instructions, rate
+      }' "$work/times" | tee -a "$csv"
+  done
+done
+
+# Convert the CSV file into a JSON array of objects, with null for missing
+# numbers.
+awk -F, '
+  NR == 1 { for (i = 1; i <= NF; i ++) key[i] = $i; next }
+  {
+    printf "%s  {", (NR == 2 ? "[\n" : ",\n");
+    for (i = 1; i <= NF; i ++) {
+      if (i <= 2)
+        value = "\"" $i "\"";
+      else
+        value = ($i == "" ? "null" : $i);
+      printf "%s\"%s\": %s", (i == 1 ? "" : ", "), key[i], value
+    }
+    printf "}"
+  }
+  END { print (NR < 2 ? "[]" : "\n]") }' "$csv" > "$json"
+
+echo "results written to $csv and $json"
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Compare the latency of running small programs in separate processes and
+# through one server process, and check that errors do not stop the server.
+#
+# Usage: bench/server.sh [IZMIR [REQUEST_NO [PROCESS_NO]]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark sends REQUEST_NO small
+# programs (default 10000) to one izmir --server process, and runs PROCESS_NO
+# of the same programs (default 200) as separate izmir processes.  Every tenth
+# request fails, in turn with a syntax error, an undefined variable, a
+# division by zero, malformed input and runaway recursion through a procedure
+# with no formals, which overflows the return stack but not the main stack;
+# the server must answer all of them.
+# Times are wall-clock averages in microseconds per program.
+
+set -e
+
+izmir=${1:-./build/izmir}
+request_no=${2:-10000}
+process_no=${3:-200}
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-server.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# Print a request for the given program text and input text.
+request () {
+  printf '%s %s\n%s%s' "$(printf '%s' "$1" | wc -c)" \
+    "$(printf '%s' "$2" | wc -c)" "$1" "$2"
+}
+
+good='var i = 0, s = input;
+while i < 100 do
+  s := s + i;
+  i := i + 1;
+end
+print s;
+'
+printf '%s' "$good" > "$work/good.iz"
+
+awk -v n="$request_no" 'BEGIN { for (i = 0; i < n; i ++) print i }' \
+  | while read -r i; do
+      case $((i % 50)) in
+        9)  request 'print 1 +;' '' ;;
+        19) request 'print x;' '' ;;
+        29) request 'var z = 0; print 1 / z;' '' ;;
+        39) request 'print input;' 'forty' ;;
+        49) request 'procedure f () f (); end; f ();' '' ;;
+        *)  request "$good" "$i" ;;
+      esac
+    done > "$work/requests"
+
+start=$(now)
+"$izmir" --server < "$work/requests" > "$work/replies"
+end=$(now)
+ok_no=$(grep -c -a '^ok ' "$work/replies" || true)
+error_no=$(grep -c -a '^error ' "$work/replies" || true)
+if [ $((ok_no + error_no)) -ne "$request_no" ]; then
+  echo "expected $request_no replies, got $((ok_no + error_no))" >&2
+  exit 1
+fi
+echo "server: $(((end - start) / request_no / 1000)) us per program" \
+  "($ok_no ok, $error_no errors)"
+
+start=$(now)
+i=0
+while [ $i -lt "$process_no" ]; do
+  echo $i | "$izmir" "$work/good.iz" > /dev/null
+  i=$((i + 1))
+done
+end=$(now)
+echo "processes: $(((end - start) / process_no / 1000)) us per program"
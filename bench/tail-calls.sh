@@ -0,0 +1,61 @@
+#!/bin/sh
+# Show that tail calls run in constant stack space, at the speed of loops.
+#
+# Usage: bench/tail-calls.sh [IZMIR [RUN_NO]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark runs bench/tail-calls.iz ,
+# whose loops are written as tail calls a million deep, RUN_NO times (default
+# 3), and then the same computation written with while loops: the two must
+# print the same result, in similar times.  It then checks that the program
+# fails with --no-tail-calls , since a million nested ordinary calls do not
+# fit in the stacks.  Times are wall-clock averages in milliseconds.
+
+set -e
+
+izmir=${1:-./build/izmir}
+run_no=${2:-3}
+program="$(dirname "$0")/tail-calls.iz"
+. "$(dirname "$0")/common.sh"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-tail-calls-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# The same computation, with loops.
+loops="$work/tail-calls-loops.iz"
+cat > "$loops" <<'END'
+procedure sum (i, n, acc)
+  while i <= n do
+    acc := acc + i mod 7;
+    i := i + 1;
+  end
+  return acc;
+end;
+
+procedure even (n, acc)
+  while n <> 0 do
+    acc := acc + 1;
+    n := n - 1;
+    if n <> 0 then
+      acc := acc + 2;
+      n := n - 1;
+    end
+  end
+  return acc;
+end;
+
+var round = 0, s = 0;
+while round < 10 do
+  s := s + sum (1, 1000000, 0) + even (1000000, round);
+  round := round + 1;
+end
+print s;
+END
+
+expected=$("$izmir" "$loops")
+printf '%-12s %s ms\n' "tail calls:" "$(measure_checked "$program")"
+printf '%-12s %s ms\n' "loops:" "$(measure_checked "$loops")"
+if "$izmir" --no-tail-calls "$program" > /dev/null 2>&1; then
+  echo "--no-tail-calls: unexpectedly succeeded" >&2
+  exit 1
+fi
+echo "--no-tail-calls: fails, as the stacks overflow"
@@ -0,0 +1,133 @@
+#!/bin/sh
+# Measure batch throughput with different numbers of threads, and check that
+# concurrent runs do not affect each other.
+#
+# Usage: bench/threads.sh [IZMIR [INPUT_NO [THREAD_NOS]]]
+#
+# IZMIR defaults to ./build/izmir .  The benchmark generates INPUT_NO input
+# files (default 64), each holding a different limit, and runs a program
+# computing Collatz step totals up to its limit on every input with --inputs
+# once for each thread count in the space-separated list THREAD_NOS (default
+# "1 2 4 0", where 0 means one per processor).  It fails if any output differs
+# from the one computed with the first thread count.  With each thread count it
+# then runs a second program on INPUT_NO inputs of which a third divide by zero
+# and a third are malformed, and fails unless the batch fails, every failing
+# input is reported with its own error and no other, and every input keeps the
+# output printed before its error, or its whole output.
+
+set -e
+
+izmir=${1:-./build/izmir}
+input_no=${2:-64}
+thread_nos=${3:-1 2 4 0}
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/izmir-threads.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# Every run reads its own limit, and prints it back along with its result, so
+# that a run seeing another one's input or output is caught.
+program="$work/collatz.iz"
+cat > "$program" <<'PROGRAM'
+var limit = input, n = 1, total = 0;
+while n <= limit do
+  var x = n;
+  while x <> 1 do
+    if (x mod 2) = 0 then
+      x := x / 2;
+    else
+      x := 3 * x + 1;
+    end
+    total := total + 1;
+  end
+  n := n + 1;
+end
+print limit;
+print total;
+PROGRAM
+
+list="$work/inputs"
+: > "$list"
+i=0
+while [ $i -lt "$input_no" ]; do
+  echo $((20000 + i * 997)) > "$work/input-$i"
+  echo "$work/input-$i" >> "$list"
+  i=$((i + 1))
+done
+
+echo "inputs: $input_no"
+reference=
+for thread_no in $thread_nos; do
+  "$izmir" --time --inputs="$list" --threads="$thread_no" "$program" \
+    2> "$work/times"
+  awk -F, -v t="$thread_no" -v n="$input_no" 'END {
+    printf "threads %3s: execute %.3f s, %.1f runs/s\n", t, $4, n / $4 }' \
+    "$work/times"
+  mkdir "$work/outputs-$thread_no"
+  i=0
+  while [ $i -lt "$input_no" ]; do
+    mv "$work/input-$i.out" "$work/outputs-$thread_no/$i"
+    i=$((i + 1))
+  done
+  if [ -z "$reference" ]; then
+    reference="$work/outputs-$thread_no"
+  elif ! diff -r "$reference" "$work/outputs-$thread_no" > /dev/null; then
+    echo "the outputs computed with --threads=$thread_no differ" >&2
+    exit 1
+  fi
+done
+
+# Every third input divides by zero after printing, and every third one is not
+# an integer; the others print their input and a quotient.
+program="$work/quotient.iz"
+cat > "$program" <<'PROGRAM'
+var n = input;
+print n;
+print 100 / n;
+PROGRAM
+
+list="$work/mixed-inputs"
+: > "$list"
+: > "$work/expected-errors"
+i=0
+while [ $i -lt "$input_no" ]; do
+  input="$work/mixed-$i"
+  case $((i % 3)) in
+    0) echo 0 > "$input"
+       printf '0\n' > "$input.expected"
+       echo "$input: division by zero" >> "$work/expected-errors" ;;
+    1) echo x > "$input"
+       : > "$input.expected"
+       echo "$input: input: invalid integer" >> "$work/expected-errors" ;;
+    2) echo $((i + 1)) > "$input"
+       printf '%i\n%i\n' $((i + 1)) $((100 / (i + 1))) > "$input.expected" ;;
+  esac
+  echo "$input" >> "$list"
+  i=$((i + 1))
+done
+sort "$work/expected-errors" > "$work/expected-errors.sorted"
+failed_no=$(($(wc -l < "$work/expected-errors")))
+
+for thread_no in $thread_nos; do
+  if "$izmir" --inputs="$list" --threads="$thread_no" "$program" \
+       2> "$work/errors"; then
+    echo "--threads=$thread_no: the batch succeeded despite failing inputs" >&2
+    exit 1
+  fi
+  # The byte offset of malformed input is not compared.
+  sed 's/ at byte [0-9]*$//' "$work/errors" | sort > "$work/errors.sorted"
+  if ! cmp -s "$work/expected-errors.sorted" "$work/errors.sorted"; then
+    echo "--threads=$thread_no: failing inputs were reported wrongly:" >&2
+    diff "$work/expected-errors.sorted" "$work/errors.sorted" >&2 || true
+    exit 1
+  fi
+  i=0
+  while [ $i -lt "$input_no" ]; do
+    if ! cmp -s "$work/mixed-$i.expected" "$work/mixed-$i.out"; then
+      echo "--threads=$thread_no: wrong output for input $i" >&2
+      exit 1
+    fi
+    rm "$work/mixed-$i.out"
+    i=$((i + 1))
+  done
+  echo "threads $thread_no: $failed_no of $input_no runs failed as expected"
+done
@@ -0,0 +1,150 @@
+/* Izmir language: arena allocation.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-arena.h"
+
+
+/* Arena tuning.
+ * ************************************************************************** */
+
+/* The alignment of every object, which must be a power of two. */
+#define IZMIR_ARENA_ALIGNMENT  (_Alignof (max_align_t))
+
+/* The size of the first chunk, and the maximum size of chunks allocated for
+   many objects; chunk sizes double from the first to the maximum, so that
+   small programs waste little memory and large programs need few chunks. */
+#define IZMIR_ARENA_INITIAL_CHUNK_SIZE  4096
+#define IZMIR_ARENA_MAXIMUM_CHUNK_SIZE  (1024 * 1024)
+
+/* Round the given size up to a multiple of the alignment. */
+#define IZMIR_ARENA_ROUND_UP(size)                                \
+  (((size) + IZMIR_ARENA_ALIGNMENT - 1)                           \
+   & ~ (size_t) (IZMIR_ARENA_ALIGNMENT - 1))
+
+/* The size of a chunk header, rounded up so that the usable space following
+   it is aligned. */
+#define IZMIR_ARENA_HEADER_SIZE                                   \
+  IZMIR_ARENA_ROUND_UP (sizeof (struct izmir_arena_chunk))
+
+
+
+
+/* Chunk allocation.
+ * ************************************************************************** */
+
+/* Make a new chunk with at least the given usable size the current chunk of
+   the pointed arena.  The free space remaining in the old current chunk, if
+   any, is wasted. */
+static void
+izmir_arena_add_chunk (struct izmir_arena *a, size_t minimum_size)
+{
+  size_t size = a->next_chunk_size;
+  if (size < minimum_size)
+    size = minimum_size;
+  else if (a->next_chunk_size < IZMIR_ARENA_MAXIMUM_CHUNK_SIZE)
+    a->next_chunk_size *= 2;
+
+  struct izmir_arena_chunk *c
+    = jitter_xmalloc (IZMIR_ARENA_HEADER_SIZE + size);
+  c->previous = a->chunks;
+  c->size = size;
+  a->chunks = c;
+  a->next = (char *) c + IZMIR_ARENA_HEADER_SIZE;
+  a->limit = a->next + size;
+  a->last = NULL;
+}
+
+
+
+
+/* Arena operations.
+ * ************************************************************************** */
+
+void
+izmir_arena_initialize (struct izmir_arena *a)
+{
+  a->chunks = NULL;
+  a->next = NULL;
+  a->limit = NULL;
+  a->last = NULL;
+  a->next_chunk_size = IZMIR_ARENA_INITIAL_CHUNK_SIZE;
+}
+
+void
+izmir_arena_finalize (struct izmir_arena *a)
+{
+  struct izmir_arena_chunk *c = a->chunks;
+  while (c != NULL)
+    {
+      struct izmir_arena_chunk *previous = c->previous;
+      free (c);
+      c = previous;
+    }
+  a->chunks = NULL;
+}
+
+void *
+izmir_arena_allocate (struct izmir_arena *a, size_t size)
+{
+  size = IZMIR_ARENA_ROUND_UP (size);
+  if (__builtin_expect ((size_t) (a->limit - a->next) < size, 0))
+    izmir_arena_add_chunk (a, size);
+  char *res = a->next;
+  a->next += size;
+  a->last = res;
+  return res;
+}
+
+void *
+izmir_arena_reallocate (struct izmir_arena *a, void *old, size_t old_size,
+                        size_t new_size)
+{
+  /* Grow in place if the object is the last one allocated and still fits in
+     its chunk. */
+  if (old != NULL
+      && old == a->last
+      && (size_t) (a->limit - (char *) old) >= new_size)
+    {
+      a->next = (char *) old + IZMIR_ARENA_ROUND_UP (new_size);
+      return old;
+    }
+
+  void *res = izmir_arena_allocate (a, new_size);
+  if (old != NULL)
+    memcpy (res, old, (old_size < new_size) ? old_size : new_size);
+  return res;
+}
+
+char *
+izmir_arena_clone_string (struct izmir_arena *a, const char *s)
+{
+  size_t size = strlen (s) + 1;
+  char *res = izmir_arena_allocate (a, size);
+  memcpy (res, s, size);
+  return res;
+}
@@ -0,0 +1,118 @@
+/* Izmir language: arena allocation.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_ARENA_H_
+#define IZMIR_ARENA_H_
+
+#include <stddef.h>
+
+
+/* About arenas.
+ * ************************************************************************** */
+
+/* An arena is a region of memory from which objects are allocated by bumping a
+   pointer, and which is released all at once.  There is no way of freeing an
+   individual object.
+
+   This fits ASTs well: a program is built by many small allocations, all of
+   which die together when the program is no longer needed.  Allocation is a
+   handful of instructions in the common case, and destroying a program costs
+   one free call per chunk rather than one per node. */
+
+
+
+
+/* Arena data structures.
+ * ************************************************************************** */
+
+/* A chunk of memory belonging to an arena.  The usable space immediately
+   follows this header. */
+struct izmir_arena_chunk
+{
+  /* The previously allocated chunk, or NULL if this is the first one. */
+  struct izmir_arena_chunk *previous;
+
+  /* The size of the usable space in this chunk, in bytes. */
+  size_t size;
+};
+
+/* An arena. */
+struct izmir_arena
+{
+  /* The most recently allocated chunk, or NULL if no chunk exists yet.  Older
+     chunks are reachable through the previous field. */
+  struct izmir_arena_chunk *chunks;
+
+  /* The first free byte in the current chunk. */
+  char *next;
+
+  /* The first byte past the end of the current chunk. */
+  char *limit;
+
+  /* The beginning of the most recent allocation, or NULL.  This allows the
+     last object to grow in place. */
+  char *last;
+
+  /* The size in bytes of the next chunk to allocate, unless a larger one is
+     needed for a single object. */
+  size_t next_chunk_size;
+};
+
+
+
+
+/* Arena operations.
+ * ************************************************************************** */
+
+/* Initialize the pointed arena to be empty.  No memory is allocated until the
+   first object is. */
+void
+izmir_arena_initialize (struct izmir_arena *a);
+
+/* Release every object in the pointed arena at once.  The arena must not be
+   used again unless re-initialized. */
+void
+izmir_arena_finalize (struct izmir_arena *a);
+
+/* Return a pointer to a fresh uninitialized object of the given size within
+   the pointed arena, suitably aligned for any type.  Never return NULL: fail
+   fatally if memory is exhausted. */
+void *
+izmir_arena_allocate (struct izmir_arena *a, size_t size);
+
+/* Return a pointer to an object of new_size bytes, whose first old_size bytes
+   are the same as the ones of the pointed object of old_size bytes, which must
+   belong to the pointed arena or be NULL.  The object is extended in place when
+   it was the last one allocated and there is room for it; otherwise it is
+   copied, and the old copy is wasted until the arena is finalized.  Growing an
+   array geometrically keeps the waste proportional to its final size. */
+void *
+izmir_arena_reallocate (struct izmir_arena *a, void *old, size_t old_size,
+                        size_t new_size);
+
+/* Return a copy of the given C string allocated within the pointed arena. */
+char *
+izmir_arena_clone_string (struct izmir_arena *a, const char *s);
+
+
+#endif // #ifndef IZMIR_ARENA_H_
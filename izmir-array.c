@@ -0,0 +1,576 @@
+/* Izmir language: integer arrays and their bulk operations.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <pthread.h>
+#include <string.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-array.h"
+#include "izmir-error.h"
+
+/* SIMD kernels are only compiled for x86-64, where jitter_int is 64 bits wide
+   and GCC-compatible compilers can build functions for instruction sets
+   beyond the baseline one. */
+#if defined (__x86_64__) && defined (__GNUC__)
+# define IZMIR_ARRAY_X86_KERNELS 1
+# include <immintrin.h>
+#else
+# define IZMIR_ARRAY_X86_KERNELS 0
+#endif
+
+
+/* Kernels.
+ * ************************************************************************** */
+
+/* A set of kernels, working on element arrays of the given length with no
+   check.  Lengths are non-zero for minimum and maximum. */
+struct izmir_array_kernels
+{
+  /* The name of the set, as in the --array-kernels command-line option. */
+  const char *name;
+
+  void (*fill) (jitter_int *to, size_t n, jitter_int value);
+  void (*add) (jitter_int *to, const jitter_int *a, const jitter_int *b,
+               size_t n);
+  void (*multiply) (jitter_int *to, const jitter_int *a, const jitter_int *b,
+                    size_t n);
+  jitter_int (*sum) (const jitter_int *a, size_t n);
+  jitter_int (*minimum) (const jitter_int *a, size_t n);
+  jitter_int (*maximum) (const jitter_int *a, size_t n);
+  jitter_int (*dot) (const jitter_int *a, const jitter_int *b, size_t n);
+};
+
+
+
+
+/* Portable kernels.
+ * ************************************************************************** */
+
+/* Arithmetic is done on unsigned integers, which wrap around on overflow like
+   VM instructions do. */
+
+static void
+izmir_array_fill_portable (jitter_int *to, size_t n, jitter_int value)
+{
+  size_t i;
+  for (i = 0; i < n; i ++)
+    to [i] = value;
+}
+
+static void
+izmir_array_add_portable (jitter_int *to, const jitter_int *a,
+                          const jitter_int *b, size_t n)
+{
+  size_t i;
+  for (i = 0; i < n; i ++)
+    to [i] = (jitter_uint) a [i] + (jitter_uint) b [i];
+}
+
+static void
+izmir_array_multiply_portable (jitter_int *to, const jitter_int *a,
+                               const jitter_int *b, size_t n)
+{
+  size_t i;
+  for (i = 0; i < n; i ++)
+    to [i] = (jitter_uint) a [i] * (jitter_uint) b [i];
+}
+
+static jitter_int
+izmir_array_sum_portable (const jitter_int *a, size_t n)
+{
+  jitter_uint res = 0;
+  size_t i;
+  for (i = 0; i < n; i ++)
+    res += a [i];
+  return res;
+}
+
+static jitter_int
+izmir_array_minimum_portable (const jitter_int *a, size_t n)
+{
+  jitter_int res = a [0];
+  size_t i;
+  for (i = 1; i < n; i ++)
+    if (a [i] < res)
+      res = a [i];
+  return res;
+}
+
+static jitter_int
+izmir_array_maximum_portable (const jitter_int *a, size_t n)
+{
+  jitter_int res = a [0];
+  size_t i;
+  for (i = 1; i < n; i ++)
+    if (a [i] > res)
+      res = a [i];
+  return res;
+}
+
+static jitter_int
+izmir_array_dot_portable (const jitter_int *a, const jitter_int *b, size_t n)
+{
+  jitter_uint res = 0;
+  size_t i;
+  for (i = 0; i < n; i ++)
+    res += (jitter_uint) a [i] * (jitter_uint) b [i];
+  return res;
+}
+
+static const struct izmir_array_kernels izmir_array_portable_kernels =
+  {
+    "portable",
+    izmir_array_fill_portable,
+    izmir_array_add_portable,
+    izmir_array_multiply_portable,
+    izmir_array_sum_portable,
+    izmir_array_minimum_portable,
+    izmir_array_maximum_portable,
+    izmir_array_dot_portable
+  };
+
+
+
+
+/* SIMD kernels.
+ * ************************************************************************** */
+
+#if IZMIR_ARRAY_X86_KERNELS
+
+/* The SSE4.2 and AVX2 kernels have the same structure: a vector loop over as
+   many whole vectors as fit, and a scalar loop over the remaining elements.
+   Loads and stores are unaligned, since the payload of heap objects is only
+   aligned like a jitter_int .  Neither instruction set multiplies 64-bit
+   integers, so products are composed from 32-bit multiplications; the high
+   halves of the partial products only affect bits which are discarded. */
+
+# define IZMIR_SSE  __attribute__ ((target ("sse4.2")))
+# define IZMIR_AVX2  __attribute__ ((target ("avx2")))
+
+/* Return the low 64 bits of the products of the elements of a and b. */
+static inline __m128i IZMIR_SSE
+izmir_array_vector_multiply_sse (__m128i a, __m128i b)
+{
+  __m128i low = _mm_mul_epu32 (a, b);
+  __m128i cross = _mm_add_epi64 (_mm_mul_epu32 (_mm_srli_epi64 (a, 32), b),
+                                 _mm_mul_epu32 (a, _mm_srli_epi64 (b, 32)));
+  return _mm_add_epi64 (low, _mm_slli_epi64 (cross, 32));
+}
+static inline __m256i IZMIR_AVX2
+izmir_array_vector_multiply_avx2 (__m256i a, __m256i b)
+{
+  __m256i low = _mm256_mul_epu32 (a, b);
+  __m256i cross
+    = _mm256_add_epi64 (_mm256_mul_epu32 (_mm256_srli_epi64 (a, 32), b),
+                        _mm256_mul_epu32 (a, _mm256_srli_epi64 (b, 32)));
+  return _mm256_add_epi64 (low, _mm256_slli_epi64 (cross, 32));
+}
+
+/* Return the sum of the elements of the given vector. */
+static inline jitter_uint IZMIR_SSE
+izmir_array_horizontal_sum_sse (__m128i v)
+{
+  return ((jitter_uint) _mm_cvtsi128_si64 (v)
+          + (jitter_uint) _mm_extract_epi64 (v, 1));
+}
+static inline jitter_uint IZMIR_AVX2
+izmir_array_horizontal_sum_avx2 (__m256i v)
+{
+  return izmir_array_horizontal_sum_sse
+            (_mm_add_epi64 (_mm256_castsi256_si128 (v),
+                            _mm256_extracti128_si256 (v, 1)));
+}
+
+/* Define the kernels for one instruction set.  The arguments are the suffix
+   of kernel names, the function attribute enabling the instruction set, the
+   vector type, its element number, and the intrinsic names used. */
+# define IZMIR_ARRAY_DEFINE_SIMD_KERNELS(suffix, attribute, vector,           \
+                                         width, set1, load, store, add,       \
+                                         compare_greater, blend, zero)        \
+  static void attribute                                                       \
+  izmir_array_fill_ ## suffix (jitter_int *to, size_t n, jitter_int value)    \
+  {                                                                           \
+    vector v = set1 (value);                                                  \
+    size_t i;                                                                 \
+    for (i = 0; i + width <= n; i += width)                                   \
+      store ((vector *) (to + i), v);                                         \
+    for (; i < n; i ++)                                                       \
+      to [i] = value;                                                         \
+  }                                                                           \
+                                                                              \
+  static void attribute                                                       \
+  izmir_array_add_ ## suffix (jitter_int *to, const jitter_int *a,            \
+                              const jitter_int *b, size_t n)                  \
+  {                                                                           \
+    size_t i;                                                                 \
+    for (i = 0; i + width <= n; i += width)                                   \
+      store ((vector *) (to + i), add (load ((const vector *) (a + i)),       \
+                                       load ((const vector *) (b + i))));     \
+    for (; i < n; i ++)                                                       \
+      to [i] = (jitter_uint) a [i] + (jitter_uint) b [i];                     \
+  }                                                                           \
+                                                                              \
+  static void attribute                                                       \
+  izmir_array_multiply_ ## suffix (jitter_int *to, const jitter_int *a,       \
+                                   const jitter_int *b, size_t n)             \
+  {                                                                           \
+    size_t i;                                                                 \
+    for (i = 0; i + width <= n; i += width)                                   \
+      store ((vector *) (to + i),                                             \
+             izmir_array_vector_multiply_ ## suffix                           \
+                (load ((const vector *) (a + i)),                             \
+                 load ((const vector *) (b + i))));                           \
+    for (; i < n; i ++)                                                       \
+      to [i] = (jitter_uint) a [i] * (jitter_uint) b [i];                     \
+  }                                                                           \
+                                                                              \
+  /* Sums use two accumulators, so that consecutive additions do not wait     \
+     for each other. */                                                       \
+  static jitter_int attribute                                                 \
+  izmir_array_sum_ ## suffix (const jitter_int *a, size_t n)                  \
+  {                                                                           \
+    vector s0 = zero (), s1 = zero ();                                        \
+    size_t i;                                                                 \
+    for (i = 0; i + 2 * width <= n; i += 2 * width)                           \
+      {                                                                       \
+        s0 = add (s0, load ((const vector *) (a + i)));                       \
+        s1 = add (s1, load ((const vector *) (a + i + width)));               \
+      }                                                                       \
+    jitter_uint res = izmir_array_horizontal_sum_ ## suffix (add (s0, s1));   \
+    for (; i < n; i ++)                                                       \
+      res += a [i];                                                           \
+    return res;                                                               \
+  }                                                                           \
+                                                                              \
+  static jitter_int attribute                                                 \
+  izmir_array_dot_ ## suffix (const jitter_int *a, const jitter_int *b,       \
+                              size_t n)                                       \
+  {                                                                           \
+    vector s0 = zero (), s1 = zero ();                                        \
+    size_t i;                                                                 \
+    for (i = 0; i + 2 * width <= n; i += 2 * width)                           \
+      {                                                                       \
+        s0 = add (s0, izmir_array_vector_multiply_ ## suffix                  \
+                         (load ((const vector *) (a + i)),                    \
+                          load ((const vector *) (b + i))));                  \
+        s1 = add (s1, izmir_array_vector_multiply_ ## suffix                  \
+                         (load ((const vector *) (a + i + width)),            \
+                          load ((const vector *) (b + i + width))));          \
+      }                                                                       \
+    jitter_uint res = izmir_array_horizontal_sum_ ## suffix (add (s0, s1));   \
+    for (; i < n; i ++)                                                       \
+      res += (jitter_uint) a [i] * (jitter_uint) b [i];                       \
+    return res;                                                               \
+  }                                                                           \
+                                                                              \
+  /* Minimum and maximum keep one candidate per lane, and then reduce the     \
+     lanes with the portable kernels. */                                      \
+  static jitter_int attribute                                                 \
+  izmir_array_minimum_ ## suffix (const jitter_int *a, size_t n)              \
+  {                                                                           \
+    if (n < width)                                                            \
+      return izmir_array_minimum_portable (a, n);                             \
+    vector m = load ((const vector *) a);                                     \
+    size_t i;                                                                 \
+    for (i = width; i + width <= n; i += width)                               \
+      {                                                                       \
+        vector x = load ((const vector *) (a + i));                           \
+        m = blend (m, x, compare_greater (m, x));                             \
+      }                                                                       \
+    jitter_int lanes [width];                                                 \
+    store ((vector *) lanes, m);                                              \
+    jitter_int res = izmir_array_minimum_portable (lanes, width);             \
+    for (; i < n; i ++)                                                       \
+      if (a [i] < res)                                                        \
+        res = a [i];                                                          \
+    return res;                                                               \
+  }                                                                           \
+                                                                              \
+  static jitter_int attribute                                                 \
+  izmir_array_maximum_ ## suffix (const jitter_int *a, size_t n)              \
+  {                                                                           \
+    if (n < width)                                                            \
+      return izmir_array_maximum_portable (a, n);                             \
+    vector m = load ((const vector *) a);                                     \
+    size_t i;                                                                 \
+    for (i = width; i + width <= n; i += width)                               \
+      {                                                                       \
+        vector x = load ((const vector *) (a + i));                           \
+        m = blend (m, x, compare_greater (x, m));                             \
+      }                                                                       \
+    jitter_int lanes [width];                                                 \
+    store ((vector *) lanes, m);                                              \
+    jitter_int res = izmir_array_maximum_portable (lanes, width);             \
+    for (; i < n; i ++)                                                       \
+      if (a [i] > res)                                                        \
+        res = a [i];                                                          \
+    return res;                                                               \
+  }                                                                           \
+                                                                              \
+  static const struct izmir_array_kernels                                     \
+  izmir_array_ ## suffix ## _kernels =                                        \
+    {                                                                         \
+      #suffix,                                                                \
+      izmir_array_fill_ ## suffix,                                            \
+      izmir_array_add_ ## suffix,                                             \
+      izmir_array_multiply_ ## suffix,                                        \
+      izmir_array_sum_ ## suffix,                                             \
+      izmir_array_minimum_ ## suffix,                                         \
+      izmir_array_maximum_ ## suffix,                                         \
+      izmir_array_dot_ ## suffix                                              \
+    };
+
+IZMIR_ARRAY_DEFINE_SIMD_KERNELS (sse, IZMIR_SSE, __m128i, 2,
+                                 _mm_set1_epi64x, _mm_loadu_si128,
+                                 _mm_storeu_si128, _mm_add_epi64,
+                                 _mm_cmpgt_epi64, _mm_blendv_epi8,
+                                 _mm_setzero_si128)
+IZMIR_ARRAY_DEFINE_SIMD_KERNELS (avx2, IZMIR_AVX2, __m256i, 4,
+                                 _mm256_set1_epi64x, _mm256_loadu_si256,
+                                 _mm256_storeu_si256, _mm256_add_epi64,
+                                 _mm256_cmpgt_epi64, _mm256_blendv_epi8,
+                                 _mm256_setzero_si256)
+
+#endif // #if IZMIR_ARRAY_X86_KERNELS
+
+
+
+
+/* Kernel selection.
+ * ************************************************************************** */
+
+enum izmir_array_kernel_set izmir_array_requested_kernel_set
+  = izmir_array_kernel_set_automatic;
+
+/* The kernels in use, set once by izmir_array_initialize . */
+static const struct izmir_array_kernels *izmir_array_kernels
+  = & izmir_array_portable_kernels;
+
+/* The control variable making izmir_array_select_kernels run once. */
+static pthread_once_t izmir_array_once = PTHREAD_ONCE_INIT;
+
+/* Set izmir_array_kernels according to the requested kernel set and to the
+   processor. */
+static void
+izmir_array_select_kernels (void)
+{
+  bool sse = false, avx2 = false;
+#if IZMIR_ARRAY_X86_KERNELS
+  __builtin_cpu_init ();
+  sse = __builtin_cpu_supports ("sse4.2");
+  avx2 = __builtin_cpu_supports ("avx2");
+#endif
+
+  switch (izmir_array_requested_kernel_set)
+    {
+    case izmir_array_kernel_set_automatic:
+#if IZMIR_ARRAY_X86_KERNELS
+      if (avx2)
+        izmir_array_kernels = & izmir_array_avx2_kernels;
+      else if (sse)
+        izmir_array_kernels = & izmir_array_sse_kernels;
+#endif
+      break;
+    case izmir_array_kernel_set_portable:
+      break;
+    case izmir_array_kernel_set_sse4_2:
+      if (! sse)
+        jitter_fatal ("this processor has no SSE4.2 array kernels");
+#if IZMIR_ARRAY_X86_KERNELS
+      izmir_array_kernels = & izmir_array_sse_kernels;
+#endif
+      break;
+    case izmir_array_kernel_set_avx2:
+      if (! avx2)
+        jitter_fatal ("this processor has no AVX2 array kernels");
+#if IZMIR_ARRAY_X86_KERNELS
+      izmir_array_kernels = & izmir_array_avx2_kernels;
+#endif
+      break;
+    default:
+      jitter_fatal ("invalid array kernel set %i",
+                    (int) izmir_array_requested_kernel_set);
+    }
+}
+
+void
+izmir_array_initialize (void)
+{
+  pthread_once (& izmir_array_once, izmir_array_select_kernels);
+}
+
+const char *
+izmir_array_kernel_set_name (void)
+{
+  izmir_array_initialize ();
+  return izmir_array_kernels->name;
+}
+
+
+
+
+/* Errors.
+ * ************************************************************************** */
+
+void
+izmir_array_fail_not_an_array (jitter_int value)
+{
+  izmir_fail ("not an array: %li", (long) value);
+}
+
+void
+izmir_array_fail_index (jitter_int index, jitter_int length)
+{
+  izmir_fail ("array index %li out of bounds for length %li", (long) index,
+              (long) length);
+}
+
+/* Return the length shared by the two given arrays, or fail if they have
+   different lengths.  The bounds of every bulk operation are checked here,
+   once, rather than in kernel loops. */
+static size_t
+izmir_array_common_length (const struct izmir_heap_object *a,
+                           const struct izmir_heap_object *b)
+{
+  jitter_int a_length = izmir_array_object_length (a);
+  jitter_int b_length = izmir_array_object_length (b);
+  if (a_length != b_length)
+    izmir_fail ("array lengths differ: %li and %li", (long) a_length,
+                (long) b_length);
+  return a_length;
+}
+
+
+
+
+/* Whole-array operations.
+ * ************************************************************************** */
+
+jitter_int
+izmir_array_new (struct izmir_heap *h, jitter_int length,
+                 const char *stack_height, jitter_int top)
+{
+  if (length < 0 || length > IZMIR_ARRAY_MAX_LENGTH)
+    izmir_fail ("invalid array length %li", (long) length);
+  jitter_int res = izmir_heap_allocate (h, length * sizeof (jitter_int),
+                                        stack_height, top);
+  if (res == 0)
+    izmir_fail ("cannot allocate array of length %li", (long) length);
+  return res;
+}
+
+void
+izmir_array_fill (struct izmir_heap *h, jitter_int array, jitter_int value)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  izmir_array_kernels->fill (izmir_heap_payload (o),
+                             izmir_array_object_length (o), value);
+  izmir_heap_write_barrier (h, o, value);
+}
+
+void
+izmir_array_copy (struct izmir_heap *h, jitter_int to, jitter_int from)
+{
+  struct izmir_heap_object *to_o = izmir_array_dereference (h, to);
+  struct izmir_heap_object *from_o = izmir_array_dereference (h, from);
+  size_t n = izmir_array_common_length (to_o, from_o);
+  memmove (izmir_heap_payload (to_o), izmir_heap_payload (from_o),
+           n * sizeof (jitter_int));
+
+  /* Looking for references among the elements would take as long as the copy
+     itself: just remember the destination. */
+  izmir_heap_remember (h, to_o);
+}
+
+void
+izmir_array_add (struct izmir_heap *h, jitter_int to, jitter_int a,
+                 jitter_int b)
+{
+  struct izmir_heap_object *to_o = izmir_array_dereference (h, to);
+  struct izmir_heap_object *a_o = izmir_array_dereference (h, a);
+  struct izmir_heap_object *b_o = izmir_array_dereference (h, b);
+  size_t n = izmir_array_common_length (to_o, a_o);
+  izmir_array_common_length (a_o, b_o);
+  izmir_array_kernels->add (izmir_heap_payload (to_o),
+                            izmir_heap_payload (a_o),
+                            izmir_heap_payload (b_o), n);
+
+  /* Sums and products of integers may happen to equal references, like
+     copied elements: remember the destination as izmir_array_copy does. */
+  izmir_heap_remember (h, to_o);
+}
+
+void
+izmir_array_multiply (struct izmir_heap *h, jitter_int to, jitter_int a,
+                      jitter_int b)
+{
+  struct izmir_heap_object *to_o = izmir_array_dereference (h, to);
+  struct izmir_heap_object *a_o = izmir_array_dereference (h, a);
+  struct izmir_heap_object *b_o = izmir_array_dereference (h, b);
+  size_t n = izmir_array_common_length (to_o, a_o);
+  izmir_array_common_length (a_o, b_o);
+  izmir_array_kernels->multiply (izmir_heap_payload (to_o),
+                                 izmir_heap_payload (a_o),
+                                 izmir_heap_payload (b_o), n);
+  izmir_heap_remember (h, to_o);
+}
+
+jitter_int
+izmir_array_sum (struct izmir_heap *h, jitter_int array)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  return izmir_array_kernels->sum (izmir_heap_payload (o),
+                                   izmir_array_object_length (o));
+}
+
+jitter_int
+izmir_array_minimum (struct izmir_heap *h, jitter_int array)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  size_t n = izmir_array_object_length (o);
+  if (n == 0)
+    izmir_fail ("minimum of an empty array");
+  return izmir_array_kernels->minimum (izmir_heap_payload (o), n);
+}
+
+jitter_int
+izmir_array_maximum (struct izmir_heap *h, jitter_int array)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  size_t n = izmir_array_object_length (o);
+  if (n == 0)
+    izmir_fail ("maximum of an empty array");
+  return izmir_array_kernels->maximum (izmir_heap_payload (o), n);
+}
+
+jitter_int
+izmir_array_dot (struct izmir_heap *h, jitter_int a, jitter_int b)
+{
+  struct izmir_heap_object *a_o = izmir_array_dereference (h, a);
+  struct izmir_heap_object *b_o = izmir_array_dereference (h, b);
+  size_t n = izmir_array_common_length (a_o, b_o);
+  return izmir_array_kernels->dot (izmir_heap_payload (a_o),
+                                   izmir_heap_payload (b_o), n);
+}
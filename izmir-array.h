@@ -0,0 +1,223 @@
+/* Izmir language: integer arrays and their bulk operations.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_ARRAY_H_
+#define IZMIR_ARRAY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <jitter/jitter.h>
+
+#include "izmir-heap.h"
+
+
+/* About arrays.
+ * ************************************************************************** */
+
+/* An izmir array is a heap object (see izmir-heap.h) whose payload is its
+   elements, and an array value is a reference to it.  Arrays are created
+   zeroed, and never change their length.
+
+   Reading or writing one element checks the index against the length.  Bulk
+   operations, working on whole arrays, check that their operands are arrays
+   of the same length once and then run a kernel with no check in its loop.
+   Kernels come in a portable version and, on x86-64, in SSE4.2 and AVX2
+   versions; the best one the processor supports is selected once per
+   process, unless another was requested.
+
+   Elements are integers, and may be references to other arrays.  References
+   stored by element assignment, fill and copy keep the arrays they refer to
+   alive; adding or multiplying references gives numbers.
+
+   Errors, such as using something which is not an array or an index out of
+   bounds, are reported with izmir_fail . */
+
+/* The length of the longest array: 2^27 elements, one GiB.  A longer array
+   would let one program, maybe sent to a server, take the whole memory of
+   the host. */
+#define IZMIR_ARRAY_MAX_LENGTH  ((jitter_int) 1 << 27)
+
+
+
+
+/* Kernel selection.
+ * ************************************************************************** */
+
+/* A set of bulk operation kernels. */
+enum izmir_array_kernel_set
+  {
+    /* The best set supported by the processor. */
+    izmir_array_kernel_set_automatic,
+
+    /* Plain C loops, which the compiler may still vectorize for the baseline
+       instruction set. */
+    izmir_array_kernel_set_portable,
+
+    /* SSE4.2 instructions, working on two elements at a time. */
+    izmir_array_kernel_set_sse4_2,
+
+    /* AVX2 instructions, working on four elements at a time. */
+    izmir_array_kernel_set_avx2
+  };
+
+/* The kernel set to use.  This is a process-wide setting, meant to be set
+   once from the command line before any VM state is initialized. */
+extern enum izmir_array_kernel_set izmir_array_requested_kernel_set;
+
+/* Select the kernels according to izmir_array_requested_kernel_set , the first
+   time this is called in the process; do nothing later.  Fail fatally if the
+   processor does not support the requested set.  This is safe to call from
+   several threads, and every VM state initialization calls it. */
+void
+izmir_array_initialize (void);
+
+/* Return the name of the kernel set in use, which is the one used in the
+   --array-kernels command-line option. */
+const char *
+izmir_array_kernel_set_name (void);
+
+
+
+
+/* Element access.
+ * ************************************************************************** */
+
+/* Fail reporting that the given value is not an array. */
+void
+izmir_array_fail_not_an_array (jitter_int value)
+  __attribute__ ((noreturn, cold));
+
+/* Fail reporting that the given index is out of the bounds of an array of the
+   given length. */
+void
+izmir_array_fail_index (jitter_int index, jitter_int length)
+  __attribute__ ((noreturn, cold));
+
+/* Return the array the given value refers to in the pointed heap, or fail if
+   it is not an array. */
+static inline struct izmir_heap_object *
+izmir_array_dereference (struct izmir_heap *h, jitter_int value)
+{
+  struct izmir_heap_object *o = izmir_heap_dereference (h, value);
+  if (__builtin_expect (o == NULL, false))
+    izmir_array_fail_not_an_array (value);
+  return o;
+}
+
+/* Return the length of the pointed array. */
+static inline jitter_int
+izmir_array_object_length (const struct izmir_heap_object *o)
+{
+  return o->size / sizeof (jitter_int);
+}
+
+/* Return the length of the array the given value refers to in the pointed
+   heap, or fail. */
+static inline jitter_int
+izmir_array_length (struct izmir_heap *h, jitter_int array)
+{
+  return izmir_array_object_length (izmir_array_dereference (h, array));
+}
+
+/* Return the element with the given index of the array the given value refers
+   to in the pointed heap, or fail. */
+static inline jitter_int
+izmir_array_element (struct izmir_heap *h, jitter_int array, jitter_int index)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  jitter_int length = izmir_array_object_length (o);
+  if (__builtin_expect ((jitter_uint) index >= (jitter_uint) length, false))
+    izmir_array_fail_index (index, length);
+  return izmir_heap_payload (o) [index];
+}
+
+/* Set the element with the given index of the array the given value refers
+   to in the pointed heap to the given value, or fail. */
+static inline void
+izmir_array_set_element (struct izmir_heap *h, jitter_int array,
+                         jitter_int index, jitter_int value)
+{
+  struct izmir_heap_object *o = izmir_array_dereference (h, array);
+  jitter_int length = izmir_array_object_length (o);
+  if (__builtin_expect ((jitter_uint) index >= (jitter_uint) length, false))
+    izmir_array_fail_index (index, length);
+  izmir_heap_payload (o) [index] = value;
+  izmir_heap_write_barrier (h, o, value);
+}
+
+
+
+
+/* Whole-array operations.
+ * ************************************************************************** */
+
+/* Return a reference to a new zeroed array of the given length in the pointed
+   heap, or fail if the length is negative or too large.  The stack height and
+   the top of the stack are the roots, as for izmir_heap_allocate . */
+jitter_int
+izmir_array_new (struct izmir_heap *h, jitter_int length,
+                 const char *stack_height, jitter_int top);
+
+/* Each of these bulk operations takes array references in the pointed heap,
+   and fails if an operand is not an array or if the lengths of two array
+   operands differ. */
+
+/* Set every element of the given array to the given value. */
+void
+izmir_array_fill (struct izmir_heap *h, jitter_int array, jitter_int value);
+
+/* Copy the elements of the second array into the first. */
+void
+izmir_array_copy (struct izmir_heap *h, jitter_int to, jitter_int from);
+
+/* Set each element of the first array to the sum or to the product of the
+   elements with the same index in the second and the third array.  Any of
+   the arrays may be the same. */
+void
+izmir_array_add (struct izmir_heap *h, jitter_int to, jitter_int a,
+                 jitter_int b);
+void
+izmir_array_multiply (struct izmir_heap *h, jitter_int to, jitter_int a,
+                      jitter_int b);
+
+/* Return the sum of the elements of the given array, wrapping around on
+   overflow like VM arithmetic. */
+jitter_int
+izmir_array_sum (struct izmir_heap *h, jitter_int array);
+
+/* Return the smallest or the largest element of the given array, or fail if
+   it is empty. */
+jitter_int
+izmir_array_minimum (struct izmir_heap *h, jitter_int array);
+jitter_int
+izmir_array_maximum (struct izmir_heap *h, jitter_int array);
+
+/* Return the dot product of the two given arrays, wrapping around on
+   overflow. */
+jitter_int
+izmir_array_dot (struct izmir_heap *h, jitter_int a, jitter_int b);
+
+
+#endif // #ifndef IZMIR_ARRAY_H_
@@ -0,0 +1,192 @@
+/* Izmir language: running one routine on many inputs at once.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-batch.h"
+#include "izmir-error.h"
+#include "izmir-output.h"
+#include "izmir-parallel.h"
+#include "izmir-profile.h"
+
+
+/* Input lists.
+ * ************************************************************************** */
+
+char **
+izmir_batch_read_list (const char *path, size_t *input_no)
+{
+  FILE *f = fopen (path, "r");
+  if (f == NULL)
+    jitter_fatal ("could not open input list %s", path);
+
+  size_t allocated_no = 16;
+  char **res = jitter_xmalloc (sizeof (char *) * allocated_no);
+  * input_no = 0;
+  char *line = NULL;
+  size_t line_size = 0;
+  ssize_t length;
+  while ((length = getline (& line, & line_size, f)) >= 0)
+    {
+      if (length > 0 && line [length - 1] == '\n')
+        line [-- length] = '\0';
+      if (length == 0)
+        continue;
+      if (* input_no == allocated_no)
+        {
+          allocated_no *= 2;
+          res = jitter_xrealloc (res, sizeof (char *) * allocated_no);
+        }
+      res [* input_no] = jitter_xmalloc (length + 1);
+      memcpy (res [(* input_no) ++], line, length + 1);
+    }
+  free (line);
+  if (ferror (f))
+    jitter_fatal ("could not read input list %s", path);
+  fclose (f);
+  return res;
+}
+
+void
+izmir_batch_destroy_list (char **input_paths, size_t input_no)
+{
+  size_t i;
+  for (i = 0; i < input_no; i ++)
+    free (input_paths [i]);
+  free (input_paths);
+}
+
+
+
+
+/* Batch runs.
+ * ************************************************************************** */
+
+/* The lock serializing state initialization and finalization, which update
+   data shared by every state of the VM. */
+static pthread_mutex_t izmir_batch_state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The data of a batch, shared by every thread running it. */
+struct izmir_batch
+{
+  /* The routine, and the input pathnames. */
+  izmirvm_routine routine;
+  char **input_paths;
+
+  /* The total number of executed instructions, updated atomically, or -1
+     without count profiling. */
+  long long instruction_no;
+
+  /* The number of runs stopped by an error, updated atomically. */
+  size_t failed_no;
+};
+
+/* Run the routine of the pointed batch on the input with the given index.
+   This is a parallel loop task. */
+static void
+izmir_batch_run_one (void *batch_as_void_star, size_t index)
+{
+  struct izmir_batch *b = batch_as_void_star;
+  const char *input_path = b->input_paths [index];
+  int in = open (input_path, O_RDONLY);
+  if (in < 0)
+    jitter_fatal ("could not open input %s: %s", input_path,
+                  strerror (errno));
+  size_t input_path_length = strlen (input_path);
+  char *output_path = jitter_xmalloc (input_path_length + 5);
+  memcpy (output_path, input_path, input_path_length);
+  strcpy (output_path + input_path_length, ".out");
+  int out = open (output_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (out < 0)
+    jitter_fatal ("could not open output %s: %s", output_path,
+                  strerror (errno));
+  free (output_path);
+
+  /* Redirect the state buffers, which start out on the standard streams,
+     before anything is read or printed. */
+  struct izmirvm_state s;
+  pthread_mutex_lock (& izmir_batch_state_lock);
+  izmirvm_state_initialize (& s);
+  pthread_mutex_unlock (& izmir_batch_state_lock);
+  s.izmirvm_state_runtime.input.fd = in;
+  s.izmirvm_state_runtime.output.fd = out;
+
+  /* An error stops this run only: the recovery point is per thread, so the
+     other runs go on.  What the run printed before the error is kept in its
+     output file, and the error is reported with the input name. */
+  struct izmir_recovery recovery;
+  if (setjmp (recovery.jump) == 0)
+    {
+      izmir_recovery_push (& recovery);
+      izmirvm_execute_routine (b->routine, & s);
+      izmir_recovery_pop (& recovery);
+    }
+  else
+    {
+      fprintf (stderr, "%s: %s\n", input_path, recovery.message);
+      __atomic_fetch_add (& b->failed_no, 1, __ATOMIC_RELAXED);
+    }
+
+  /* Flush outside the lock, so that finalization does not wait for I/O. */
+  izmir_output_flush (& s.izmirvm_state_runtime.output);
+  long long instruction_no = izmir_profile_executed_instruction_no (& s);
+  if (instruction_no >= 0)
+    __atomic_fetch_add (& b->instruction_no, instruction_no,
+                        __ATOMIC_RELAXED);
+  pthread_mutex_lock (& izmir_batch_state_lock);
+  izmirvm_state_finalize (& s);
+  pthread_mutex_unlock (& izmir_batch_state_lock);
+
+  close (in);
+  if (close (out) != 0)
+    jitter_fatal ("could not write output for %s", input_path);
+}
+
+long long
+izmir_batch_run (izmirvm_routine r, char **input_paths, size_t input_no,
+                 size_t thread_no, size_t *failed_no)
+{
+  struct izmir_batch b;
+  b.routine = r;
+  b.input_paths = input_paths;
+#if defined (JITTER_PROFILE_COUNT)
+  b.instruction_no = 0;
+#else
+  b.instruction_no = -1;
+#endif
+  b.failed_no = 0;
+  izmir_parallel_for (thread_no, input_no, izmir_batch_run_one, & b);
+  * failed_no = b.failed_no;
+  return b.instruction_no;
+}
@@ -0,0 +1,78 @@
+/* Izmir language: running one routine on many inputs at once.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_BATCH_H_
+#define IZMIR_BATCH_H_
+
+#include <stddef.h>
+
+#include "izmirvm-vm.h"
+
+
+/* About batches.
+ * ************************************************************************** */
+
+/* A batch runs the same VM routine once per input file, on several threads
+   at the same time.  The routine is specialized once, before the batch
+   starts, and its code is shared: each run owns an izmirvm state of its own,
+   with its own stacks and its own input and output buffers, so that runs see
+   nothing of each other.  Each run reads from its input file and prints to a
+   new file named like the input with ".out" appended.
+
+   Runs are handed out one at a time to whichever thread is free, so that
+   short and long inputs balance out.  An error within a run, such as
+   malformed input or a division by zero, stops that run only: it is reported
+   on stderr after the input pathname, the output printed before it is kept,
+   and the other runs go on. */
+
+
+
+
+/* Batch operations.
+ * ************************************************************************** */
+
+/* Return a malloc-allocated array of malloc-allocated strings holding the
+   non-empty lines of the file with the given pathname, each naming an input
+   file, and store their number into *input_no .  Fail fatally if the file
+   cannot be read. */
+char **
+izmir_batch_read_list (const char *path, size_t *input_no);
+
+/* Free the given array of the given length as returned by
+   izmir_batch_read_list , along with its elements. */
+void
+izmir_batch_destroy_list (char **input_paths, size_t input_no);
+
+/* Run the given routine, which must be executable already, once for each of
+   the given input pathnames, using up to thread_no threads including the
+   calling one.  Return the total number of VM instructions executed, or -1 if
+   this executable was built without count profiling, and store the number of
+   runs stopped by an error into *failed_no .  Fail fatally if an input or
+   output file cannot be opened. */
+long long
+izmir_batch_run (izmirvm_routine r, char **input_paths, size_t input_no,
+                 size_t thread_no, size_t *failed_no);
+
+
+#endif // #ifndef IZMIR_BATCH_H_
@@ -0,0 +1,407 @@
+/* Izmir language: compiled code cache.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-cache.h"
+#include "izmir-stack-depth.h"
+
+
+/* Cache file format.
+ * ************************************************************************** */
+
+/* The hash of izmirvm.jitter , as a string.  The build system defines this
+   from the actual file contents. */
+#ifndef IZMIRVM_JITTER_HASH
+# define IZMIRVM_JITTER_HASH "unknown"
+#endif
+
+/* The version of the cache file format.  Increment this whenever the format
+   of recorded code or the header changes, or whenever code generation changes
+   in a way which is not reflected in izmirvm.jitter . */
+#define IZMIR_CACHE_VERSION  4
+
+/* The magic number at the beginning of every cache file. */
+#define IZMIR_CACHE_MAGIC  "IZMIRCC"
+
+/* A cache file begins with this header, immediately followed by item_no
+   recorded items in the struct izmir_code_item format, by procedure_no
+   procedures in the struct izmir_code_procedure format, by the configuration
+   string including its final '\0' and by the program source.  The header size
+   is a multiple of 8, which keeps the items and procedures aligned in a
+   mapping.
+
+   The key is only a 64-bit hash: the configuration and the source are kept in
+   full and compared on every hit, so that two programs whose keys collide
+   never run each other's code. */
+struct izmir_cache_header
+{
+  /* IZMIR_CACHE_MAGIC , including its final '\0' . */
+  char magic [8];
+
+  /* IZMIR_CACHE_VERSION . */
+  uint32_t version;
+
+  /* sizeof (struct izmir_code_item) , as a sanity check. */
+  uint32_t item_size;
+
+  /* The key of this entry, to detect hash collisions on file names. */
+  uint64_t key;
+
+  /* The number of recorded items following the header. */
+  uint64_t item_no;
+
+  /* The number of labels in the recorded code. */
+  int64_t label_no;
+
+  /* The index of the first item of the main statement. */
+  uint64_t main_item_index;
+
+  /* The number of procedures following the items. */
+  uint64_t procedure_no;
+
+  /* The size in bytes of the configuration string following the procedures,
+     including its final '\0' . */
+  uint64_t configuration_size;
+
+  /* The size in bytes of the source following the configuration. */
+  uint64_t source_size;
+};
+
+/* Return a malloc-allocated string holding the pathname of the entry with the
+   given key in the given directory. */
+static char *
+izmir_cache_entry_path (const char *directory, izmir_cache_key key)
+{
+  size_t size = strlen (directory) + 64;
+  char *res = jitter_xmalloc (size);
+  snprintf (res, size, "%s/%016llx.izc", directory, (unsigned long long) key);
+  return res;
+}
+
+
+
+
+/* Cache keys.
+ * ************************************************************************** */
+
+/* Update the given FNV-1a hash with the given bytes, and return the result. */
+static uint64_t
+izmir_cache_hash (uint64_t hash, const void *bytes, size_t size)
+{
+  const unsigned char *p = bytes;
+  size_t i;
+  for (i = 0; i < size; i ++)
+    hash = (hash ^ p [i]) * 1099511628211ULL;
+  return hash;
+}
+
+izmir_cache_key
+izmir_cache_make_key (const char *source, size_t source_size,
+                      const char *configuration)
+{
+  uint64_t res = 14695981039346656037ULL;
+  uint32_t version = IZMIR_CACHE_VERSION;
+  uint64_t size = source_size;
+  /* Hash the source size as well as the source, so that the boundary between
+     the source and the strings following it is unambiguous. */
+  res = izmir_cache_hash (res, & version, sizeof (version));
+  res = izmir_cache_hash (res, IZMIRVM_JITTER_HASH,
+                          strlen (IZMIRVM_JITTER_HASH) + 1);
+  res = izmir_cache_hash (res, configuration, strlen (configuration) + 1);
+  res = izmir_cache_hash (res, & size, sizeof (size));
+  res = izmir_cache_hash (res, source, source_size);
+  return res;
+}
+
+
+
+
+/* Cache operations.
+ * ************************************************************************** */
+
+/* Return non-false if the given parameter item can be appended to a VM routine
+   as a parameter of the given kind for the pointed code. */
+static bool
+izmir_cache_check_parameter (const struct izmir_code *c,
+                             const struct izmir_code_item *item,
+                             enum jitter_meta_instruction_parameter_kind kind)
+{
+  bool register_ok = false, literal_ok = false, label_ok = false;
+  switch (kind)
+    {
+    case jitter_meta_instruction_parameter_kind_register:
+      register_ok = true;
+      break;
+    case jitter_meta_instruction_parameter_kind_literal_fixnum:
+      literal_ok = true;
+      break;
+    case jitter_meta_instruction_parameter_kind_literal_label:
+      label_ok = true;
+      break;
+    case jitter_meta_instruction_parameter_kind_register_or_literal_fixnum:
+      register_ok = literal_ok = true;
+      break;
+    case jitter_meta_instruction_parameter_kind_register_or_literal_label:
+      register_ok = label_ok = true;
+      break;
+    case jitter_meta_instruction_parameter_kind_literal_fixnum_or_literal_label:
+      literal_ok = label_ok = true;
+      break;
+    default:
+      /* A register, a fixnum literal or a label literal. */
+      register_ok = literal_ok = label_ok = true;
+    }
+
+  switch (item->case_)
+    {
+    case izmir_code_item_case_literal_parameter:
+      return literal_ok;
+    case izmir_code_item_case_register_parameter:
+      /* Registers are allocated densely from 0, and every register in use
+         occurs in some parameter; so no register index generated for the code
+         reaches its item number.  Checking this keeps a corrupt entry from
+         making the VM state allocate a huge number of slow registers. */
+      return (register_ok
+              && item->value >= 0
+              && (uint64_t) item->value < c->item_no);
+    case izmir_code_item_case_label_parameter:
+      return (label_ok
+              && item->value >= 0
+              && item->value < c->label_no);
+    default:
+      return false;
+    }
+}
+
+/* Return non-false if every item of the pointed code, mapped from a cache
+   entry, can be replayed by izmir_code_to_routine : every instruction exists
+   and is followed by as many parameters as it takes, of the right kinds, and
+   every label and register is within bounds.  Replaying would fail fatally on
+   such errors, where a corrupt entry should only be a miss. */
+static bool
+izmir_cache_check_items (const struct izmir_code *c)
+{
+  size_t i = 0;
+  while (i < c->item_no)
+    {
+      const struct izmir_code_item *item = c->items + i ++;
+      switch (item->case_)
+        {
+        case izmir_code_item_case_line:
+          continue;
+        case izmir_code_item_case_label:
+          if (item->value < 0 || item->value >= c->label_no)
+            return false;
+          continue;
+        case izmir_code_item_case_instruction:
+          break;
+        default:
+          /* Including parameters not following an instruction. */
+          return false;
+        }
+      if (item->value < 0 || item->value >= IZMIRVM_META_INSTRUCTION_NO)
+        return false;
+      const struct jitter_meta_instruction *mi
+        = izmirvm_meta_instructions + item->value;
+      size_t j;
+      for (j = 0; j < mi->parameter_no; j ++, i ++)
+        if (i == c->item_no
+            || ! izmir_cache_check_parameter (c, c->items + i,
+                                              mi->parameter_types [j].kind))
+          return false;
+    }
+  return true;
+}
+
+bool
+izmir_cache_load (const char *directory, izmir_cache_key key,
+                  const char *source, size_t source_size,
+                  const char *configuration, struct izmir_code *c)
+{
+  char *path = izmir_cache_entry_path (directory, key);
+  int fd = open (path, O_RDONLY);
+  free (path);
+  if (fd == -1)
+    return false;
+
+  /* Map the whole file.  The mapping survives closing the descriptor. */
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat (fd, & st) == 0
+      && st.st_size >= (off_t) sizeof (struct izmir_cache_header))
+    mapping = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  /* Validate the header before trusting anything in the file.  The sizes are
+     checked one at a time, each against what remains of the file, so that no
+     sum or product can overflow.  Every label is defined by an item, so there
+     cannot be more labels than items. */
+  const struct izmir_cache_header *header = mapping;
+  size_t size = st.st_size;
+  size_t rest = size - sizeof (struct izmir_cache_header);
+  size_t configuration_size = strlen (configuration) + 1;
+  bool valid
+    = (! memcmp (header->magic, IZMIR_CACHE_MAGIC, sizeof (header->magic))
+       && header->version == IZMIR_CACHE_VERSION
+       && header->item_size == sizeof (struct izmir_code_item)
+       && header->key == key
+       && header->label_no >= 0
+       && (uint64_t) header->label_no <= header->item_no
+       && header->item_no <= rest / sizeof (struct izmir_code_item));
+  if (valid)
+    {
+      rest -= header->item_no * sizeof (struct izmir_code_item);
+      valid = (header->procedure_no
+               <= rest / sizeof (struct izmir_code_procedure));
+    }
+  if (valid)
+    {
+      rest -= header->procedure_no * sizeof (struct izmir_code_procedure);
+      valid = (header->configuration_size == configuration_size
+               && header->source_size == source_size
+               && rest == configuration_size + source_size);
+    }
+
+  /* Compare the configuration and the source, in case of a key collision. */
+  const struct izmir_code_item *items
+    = (const struct izmir_code_item *) (header + 1);
+  const struct izmir_code_procedure *procedures
+    = (const struct izmir_code_procedure *) (items + header->item_no);
+  const char *text = (const char *) (procedures + header->procedure_no);
+  if (valid)
+    valid = (! memcmp (text, configuration, configuration_size)
+             && ! memcmp (text + configuration_size, source, source_size));
+  if (! valid)
+    {
+      munmap (mapping, size);
+      return false;
+    }
+
+  izmir_code_initialize (c);
+  c->items = (struct izmir_code_item *) items;
+  c->item_no = header->item_no;
+  c->label_no = header->label_no;
+  c->main_item_index = header->main_item_index;
+  c->procedures = (struct izmir_code_procedure *) procedures;
+  c->procedure_no = header->procedure_no;
+  c->mapping = mapping;
+  c->mapping_size = size;
+
+  /* Only replay items which are well formed.  The code runs without main stack
+     guards: only trust it if its stack depth can also be verified again,
+     exactly as if it had just been generated. */
+  if (! izmir_cache_check_items (c) || ! izmir_stack_depth_check (c))
+    {
+      izmir_code_finalize (c);
+      return false;
+    }
+  return true;
+}
+
+/* Write the given buffer of the given size to the given file descriptor,
+   retrying on partial writes.  Return non-false on success. */
+static bool
+izmir_cache_write_all (int fd, const void *buffer, size_t size)
+{
+  const char *p = buffer;
+  while (size > 0)
+    {
+      ssize_t written = write (fd, p, size);
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written <= 0)
+        return false;
+      p += written;
+      size -= written;
+    }
+  return true;
+}
+
+void
+izmir_cache_store (const char *directory, izmir_cache_key key,
+                   const char *source, size_t source_size,
+                   const char *configuration, const struct izmir_code *c)
+{
+  if (mkdir (directory, 0777) != 0 && errno != EEXIST)
+    {
+      fprintf (stderr, "warning: cannot create cache directory %s: %s\n",
+               directory, strerror (errno));
+      return;
+    }
+
+  char *path = izmir_cache_entry_path (directory, key);
+  size_t temporary_path_size = strlen (path) + 32;
+  char *temporary_path = jitter_xmalloc (temporary_path_size);
+  snprintf (temporary_path, temporary_path_size, "%s.%li.tmp", path,
+            (long) getpid ());
+
+  struct izmir_cache_header header;
+  memset (& header, 0, sizeof (header));
+  memcpy (header.magic, IZMIR_CACHE_MAGIC, sizeof (header.magic));
+  header.version = IZMIR_CACHE_VERSION;
+  header.item_size = sizeof (struct izmir_code_item);
+  header.key = key;
+  header.item_no = c->item_no;
+  header.label_no = c->label_no;
+  header.main_item_index = c->main_item_index;
+  header.procedure_no = c->procedure_no;
+  header.configuration_size = strlen (configuration) + 1;
+  header.source_size = source_size;
+
+  int fd = open (temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  bool success
+    = (fd != -1
+       && izmir_cache_write_all (fd, & header, sizeof (header))
+       && izmir_cache_write_all (fd, c->items,
+                                 sizeof (struct izmir_code_item) * c->item_no)
+       && izmir_cache_write_all (fd, c->procedures,
+                                 sizeof (struct izmir_code_procedure)
+                                 * c->procedure_no)
+       && izmir_cache_write_all (fd, configuration,
+                                 header.configuration_size)
+       && izmir_cache_write_all (fd, source, source_size));
+  if (fd != -1 && close (fd) != 0)
+    success = false;
+  if (success && rename (temporary_path, path) != 0)
+    success = false;
+  if (! success)
+    {
+      fprintf (stderr, "warning: cannot write cache entry %s: %s\n", path,
+               strerror (errno));
+      unlink (temporary_path);
+    }
+
+  free (temporary_path);
+  free (path);
+}
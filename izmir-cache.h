@@ -0,0 +1,103 @@
+/* Izmir language: compiled code cache.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_CACHE_H_
+#define IZMIR_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "izmir-code.h"
+
+
+/* About the code cache.
+ * ************************************************************************** */
+
+/* The cache keeps recorded code (see izmir-code.h) for programs already
+   compiled, in a directory containing one file per entry.  A cache hit skips
+   lexing, parsing, optimization and code generation: the file is mapped into
+   memory and replayed directly into a VM routine, which only remains to be
+   specialized and run.
+
+   Entries are keyed by a hash of the program source, of the options affecting
+   code generation and of the VM specification izmirvm.jitter , so that
+   changing the VM invalidates every entry even if meta-instruction identifiers
+   change.  Since the hash may collide, each entry also holds the source and
+   the options, which must match exactly.  Entries are also versioned: files
+   in an obsolete format, or which are truncated or otherwise unreadable, are
+   treated as misses.  So are entries with malformed items, such as
+   out-of-range labels or registers, and entries whose main stack depth does
+   not verify (see izmir-stack-depth.h),
+   since izmir runs the code without stack guards and a corrupt or hand-edited
+   entry, maybe in a shared directory, could otherwise write past the end of
+   the stack.
+
+   Routine options such as --slow-only and --no-optimization-rewriting are not
+   part of the key, since they are applied at replay time. */
+
+
+
+
+/* Cache keys.
+ * ************************************************************************** */
+
+/* A cache key. */
+typedef uint64_t izmir_cache_key;
+
+/* Return the key for the given source text of the given size, compiled with
+   the given configuration, which is a C string describing every option
+   affecting code generation. */
+izmir_cache_key
+izmir_cache_make_key (const char *source, size_t source_size,
+                      const char *configuration);
+
+
+
+
+/* Cache operations.
+ * ************************************************************************** */
+
+/* Look for an entry with the given key in the given cache directory, for the
+   given source text of the given size and configuration, from which the key
+   was made.  On a hit initialize the pointed code to be a read-only view of
+   the entry, mapped into memory, and return non-false.  On a miss return
+   false, leaving the code uninitialized. */
+bool
+izmir_cache_load (const char *directory, izmir_cache_key key,
+                  const char *source, size_t source_size,
+                  const char *configuration, struct izmir_code *c);
+
+/* Store the pointed code, compiled from the given source text of the given
+   size with the given configuration, in the given cache directory with the
+   given key, creating the directory if needed.  The entry is written under a
+   temporary name and then renamed, so that concurrent processes never see a
+   partial file.  A failure only prints a warning, since the cache is an
+   optimization. */
+void
+izmir_cache_store (const char *directory, izmir_cache_key key,
+                   const char *source, size_t source_size,
+                   const char *configuration, const struct izmir_code *c);
+
+
+#endif // #ifndef IZMIR_CACHE_H_
@@ -0,0 +1,856 @@
+/* Izmir language: register-based code generator.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-code-generator-register.h"
+#include "izmir-stack-depth.h"
+#include "izmir-static-environment.h"
+
+
+/* Operands.
+ * ************************************************************************** */
+
+/* Register instructions take their inputs as operands, each of which is either
+   a literal or a register.  A register operand may be a temporary, allocated
+   just to hold the operand value, which must be released after use. */
+struct izmir_operand
+{
+  /* True iff the operand is a literal. */
+  bool is_literal;
+
+  /* True iff the operand is a register allocated as a temporary. */
+  bool is_temporary;
+
+  /* The literal value or the register index, according to is_literal . */
+  jitter_int value;
+};
+
+/* Append the given operand as an instruction parameter. */
+static void
+izmir_append_operand (struct izmir_code *c, struct izmir_operand o)
+{
+  if (o.is_literal)
+    izmir_code_append_literal_parameter (c, o.value);
+  else
+    izmir_code_append_register_parameter (c, o.value);
+}
+
+/* Release the register held by the given operand, if it is a temporary. */
+static void
+izmir_release_operand (struct izmir_static_environment *e,
+                       struct izmir_operand o)
+{
+  if (o.is_temporary)
+    izmir_static_environment_release_temporary (e, o.value);
+}
+
+
+
+
+/* Expression code generation.
+ * ************************************************************************** */
+
+static void
+izmir_generate_register_expression_into (struct izmir_code *c,
+                                         struct izmir_static_environment *e,
+                                         struct izmir_expression *exp,
+                                         jitter_int target);
+
+static void
+izmir_generate_register_conditional (struct izmir_code *c,
+                                     struct izmir_static_environment *e,
+                                     struct izmir_expression *condition,
+                                     bool branch_if_true,
+                                     izmir_code_label target);
+
+/* Return an operand holding the value of the given expression, appending to
+   the pointed code any code needed to compute it.  Literals and variables
+   need no code at all. */
+static struct izmir_operand
+izmir_generate_register_operand (struct izmir_code *c,
+                                 struct izmir_static_environment *e,
+                                 struct izmir_expression *exp)
+{
+  struct izmir_operand res;
+  res.is_literal = false;
+  res.is_temporary = false;
+  switch (exp->case_)
+    {
+    case izmir_expression_case_undefined:
+      /* Any value will do; zero is as good as any other. */
+      res.is_literal = true;
+      res.value = 0;
+      break;
+    case izmir_expression_case_literal:
+      res.is_literal = true;
+      res.value = exp->literal;
+      break;
+    case izmir_expression_case_variable:
+      res.value = izmir_static_environment_register (e, exp->variable_slot);
+      break;
+    default:
+      res.is_temporary = true;
+      res.value = izmir_static_environment_fresh_temporary (e);
+      izmir_generate_register_expression_into (c, e, exp, res.value);
+    }
+  return res;
+}
+
+/* Like izmir_generate_register_operand , but return an operand which is
+   always a register, moving literals into a temporary.  Array instructions
+   take arrays as register operands only. */
+static struct izmir_operand
+izmir_generate_register_array_operand (struct izmir_code *c,
+                                       struct izmir_static_environment *e,
+                                       struct izmir_expression *exp)
+{
+  struct izmir_operand res = izmir_generate_register_operand (c, e, exp);
+  if (res.is_literal)
+    {
+      jitter_int temporary = izmir_static_environment_fresh_temporary (e);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, mov);
+      izmir_append_operand (c, res);
+      izmir_code_append_register_parameter (c, temporary);
+      res.is_literal = false;
+      res.is_temporary = true;
+      res.value = temporary;
+    }
+  return res;
+}
+
+/* Append to the pointed code the code pushing every register in use on the
+   main stack, except for the given one, which is about to be overwritten;
+   the given register may be negative. */
+static void
+izmir_generate_register_save_registers (struct izmir_code *c,
+                                        struct izmir_static_environment *e,
+                                        jitter_int except)
+{
+  jitter_int i;
+  for (i = IZMIR_FIRST_ALLOCATABLE_REGISTER; i < e->used_register_no; i ++)
+    if (i != except)
+      {
+        IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+        izmir_code_append_register_parameter (c, i);
+      }
+}
+
+/* Append to the pointed code the code popping the registers pushed by the
+   code from izmir_generate_register_save_registers with the same
+   exception. */
+static void
+izmir_generate_register_restore_registers (struct izmir_code *c,
+                                           struct izmir_static_environment *e,
+                                           jitter_int except)
+{
+  jitter_int i;
+  for (i = e->used_register_no - 1; i >= IZMIR_FIRST_ALLOCATABLE_REGISTER; i --)
+    if (i != except)
+      {
+        IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+        izmir_code_append_register_parameter (c, i);
+      }
+}
+
+/* Append to the pointed code the code for the given primitive
+   expression, which will store its result into the given register. */
+static void
+izmir_generate_register_primitive_into (struct izmir_code *c,
+                                        struct izmir_static_environment *e,
+                                        struct izmir_expression *exp,
+                                        jitter_int target)
+{
+  /* Multiplication, division and remainder by a literal power of two have
+     specialized instructions, with the exponent as a literal argument. */
+  int exponent;
+  if ((exp->primitive == izmir_primitive_times
+       || exp->primitive == izmir_primitive_divided
+       || exp->primitive == izmir_primitive_remainder)
+      && (exponent = izmir_power_of_two_exponent (exp->primitive_operand_1))
+         > 0)
+    {
+      struct izmir_operand o0
+        = izmir_generate_register_operand (c, e, exp->primitive_operand_0);
+      if (exp->primitive == izmir_primitive_times)
+        IZMIR_CODE_APPEND_INSTRUCTION (c, times_mpower_mof_mtwo);
+      else if (exp->primitive == izmir_primitive_divided)
+        IZMIR_CODE_APPEND_INSTRUCTION (c, divided_mpower_mof_mtwo);
+      else
+        IZMIR_CODE_APPEND_INSTRUCTION (c, remainder_mpower_mof_mtwo);
+      izmir_append_operand (c, o0);
+      izmir_code_append_literal_parameter (c, exponent);
+      izmir_code_append_register_parameter (c, target);
+      izmir_release_operand (e, o0);
+      return;
+    }
+
+  /* Input is the only nullary primitive. */
+  if (exp->primitive == izmir_primitive_input)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, input);
+      izmir_code_append_register_parameter (c, target);
+      return;
+    }
+
+  /* Creating an array allocates, and the collector only finds references on
+     the main stack: save the registers there first, as around calls. */
+  if (exp->primitive == izmir_primitive_array_new)
+    {
+      struct izmir_operand o0
+        = izmir_generate_register_operand (c, e, exp->primitive_operand_0);
+      izmir_generate_register_save_registers (c, e, target);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mnew);
+      izmir_append_operand (c, o0);
+      izmir_code_append_register_parameter (c, target);
+      izmir_generate_register_restore_registers (c, e, target);
+      izmir_release_operand (e, o0);
+      return;
+    }
+
+  /* The other array primitives take their first operand, and the second one
+     of dot, as registers. */
+  bool register_operand_0 = izmir_is_array_primitive (exp->primitive);
+  bool register_operand_1 = exp->primitive == izmir_primitive_array_dot;
+
+  /* In every other case compute the operands left to right, then emit the
+     instruction taking them and the target. */
+  struct izmir_operand o0
+    = (register_operand_0
+       ? izmir_generate_register_array_operand (c, e, exp->primitive_operand_0)
+       : izmir_generate_register_operand (c, e, exp->primitive_operand_0));
+  bool binary = exp->primitive_operand_1 != NULL;
+  struct izmir_operand o1;
+  if (binary)
+    o1 = (register_operand_1
+          ? izmir_generate_register_array_operand (c, e,
+                                                   exp->primitive_operand_1)
+          : izmir_generate_register_operand (c, e, exp->primitive_operand_1));
+  switch (exp->primitive)
+    {
+    case izmir_primitive_plus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, plus);
+      break;
+    case izmir_primitive_minus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, minus);
+      break;
+    case izmir_primitive_times:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, times);
+      break;
+    case izmir_primitive_divided:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, divided);
+      break;
+    case izmir_primitive_remainder:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, remainder);
+      break;
+    case izmir_primitive_unary_minus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, unary_mminus);
+      break;
+    case izmir_primitive_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, equal);
+      break;
+    case izmir_primitive_different:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, different);
+      break;
+    case izmir_primitive_less:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, less);
+      break;
+    case izmir_primitive_less_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, less_mor_mequal);
+      break;
+    case izmir_primitive_greater:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, greater);
+      break;
+    case izmir_primitive_greater_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, greater_mor_mequal);
+      break;
+    case izmir_primitive_logical_not:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, logical_mnot);
+      break;
+    case izmir_primitive_is_nonzero:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, is_mnonzero);
+      break;
+    case izmir_primitive_array_element:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_melement);
+      break;
+    case izmir_primitive_array_length:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mlength);
+      break;
+    case izmir_primitive_array_sum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_msum);
+      break;
+    case izmir_primitive_array_minimum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mminimum);
+      break;
+    case izmir_primitive_array_maximum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mmaximum);
+      break;
+    case izmir_primitive_array_dot:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mdot);
+      break;
+    default:
+      jitter_fatal ("invalid primitive: %i", (int) exp->primitive);
+    }
+  izmir_append_operand (c, o0);
+  if (binary)
+    izmir_append_operand (c, o1);
+  izmir_code_append_register_parameter (c, target);
+
+  /* Release temporaries in the opposite order of their allocation. */
+  if (binary)
+    izmir_release_operand (e, o1);
+  izmir_release_operand (e, o0);
+}
+
+/* Append to the pointed code the code pushing the given actuals on the main
+   stack, left to right. */
+static void
+izmir_generate_register_push_actuals (struct izmir_code *c,
+                                      struct izmir_static_environment *e,
+                                      struct izmir_expression **actuals,
+                                      size_t actual_no)
+{
+  size_t j;
+  for (j = 0; j < actual_no; j ++)
+    {
+      struct izmir_operand o
+        = izmir_generate_register_operand (c, e, actuals [j]);
+      if (o.is_literal)
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, pushconstant);
+          izmir_code_append_literal_parameter (c, o.value);
+        }
+      else
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+          izmir_code_append_register_parameter (c, o.value);
+        }
+      izmir_release_operand (e, o);
+    }
+}
+
+/* Append to the pointed code the code for a call to the procedure with the
+   given index with the given actuals, following the calling convention
+   described in izmirvm.jitter , and store the result into the given register;
+   a negative target means that the result is not needed. */
+static void
+izmir_generate_register_call (struct izmir_code *c,
+                              struct izmir_static_environment *e,
+                              size_t callee_index,
+                              struct izmir_expression **actuals,
+                              size_t actual_no,
+                              jitter_int target)
+{
+  izmir_code_label callee_label
+    = izmir_static_environment_procedure (e, callee_index);
+
+  /* Save the registers in use, which the callee may clobber.  The target
+     register is about to be overwritten, so there is no need to save it. */
+  izmir_generate_register_save_registers (c, e, target);
+
+  /* Push the actuals, left to right, and call. */
+  izmir_generate_register_push_actuals (c, e, actuals, actual_no);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, call);
+  izmir_code_append_label_parameter (c, callee_label);
+
+  /* Restore the saved registers, and fetch the result. */
+  izmir_generate_register_restore_registers (c, e, target);
+  if (target >= 0 && target != IZMIR_RESULT_REGISTER)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, mov);
+      izmir_code_append_register_parameter (c, IZMIR_RESULT_REGISTER);
+      izmir_code_append_register_parameter (c, target);
+    }
+}
+
+/* Append to the pointed code the code for a tail call to the procedure with
+   the given index with the given actuals, replacing the current procedure:
+   see izmir-static-environment.h .  No register needs saving, since the
+   current procedure is over. */
+static void
+izmir_generate_register_tail_call (struct izmir_code *c,
+                                   struct izmir_static_environment *e,
+                                   size_t callee_index,
+                                   struct izmir_expression **actuals,
+                                   size_t actual_no)
+{
+  izmir_generate_register_push_actuals (c, e, actuals, actual_no);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, tail_mcall);
+  izmir_code_append_label_parameter
+     (c, izmir_static_environment_procedure_tail (e, callee_index));
+}
+
+/* Append to the pointed code the code for the given expression, which
+   will store its result into the given register. */
+static void
+izmir_generate_register_expression_into (struct izmir_code *c,
+                                         struct izmir_static_environment *e,
+                                         struct izmir_expression *exp,
+                                         jitter_int target)
+{
+  switch (exp->case_)
+    {
+    case izmir_expression_case_undefined:
+    case izmir_expression_case_literal:
+    case izmir_expression_case_variable:
+      {
+        struct izmir_operand o = izmir_generate_register_operand (c, e, exp);
+        if (o.is_literal || o.value != target)
+          {
+            IZMIR_CODE_APPEND_INSTRUCTION (c, mov);
+            izmir_append_operand (c, o);
+            izmir_code_append_register_parameter (c, target);
+          }
+        break;
+      }
+    case izmir_expression_case_if_then_else:
+      {
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_code_label after_label = izmir_code_fresh_label (c);
+        izmir_generate_register_conditional (c, e, exp->if_then_else_condition,
+                                             false, else_label);
+        izmir_generate_register_expression_into
+           (c, e, exp->if_then_else_then_branch, target);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+        izmir_code_append_label_parameter (c, after_label);
+        izmir_code_append_label (c, else_label);
+        izmir_generate_register_expression_into
+           (c, e, exp->if_then_else_else_branch, target);
+        izmir_code_append_label (c, after_label);
+        break;
+      }
+    case izmir_expression_case_primitive:
+      izmir_generate_register_primitive_into (c, e, exp, target);
+      break;
+    case izmir_expression_case_call:
+      izmir_generate_register_call (c, e, exp->callee_index, exp->actuals,
+                                    exp->actual_no, target);
+      break;
+    default:
+      jitter_fatal ("expression case not supported yet: %i",
+                    (int) exp->case_);
+    }
+}
+
+
+
+
+/* Conditional code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the instruction for a register conditional
+   branch, taken when the given comparison primitive holds; the caller has to
+   append the parameters. */
+static void
+izmir_generate_register_comparison_branch (struct izmir_code *c,
+                                           enum izmir_primitive p)
+{
+  switch (p)
+    {
+    case izmir_primitive_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mequal);
+      break;
+    case izmir_primitive_different:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mdifferent);
+      break;
+    case izmir_primitive_less:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mless);
+      break;
+    case izmir_primitive_less_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mless_mor_mequal);
+      break;
+    case izmir_primitive_greater:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mgreater);
+      break;
+    case izmir_primitive_greater_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mgreater_mor_mequal);
+      break;
+    default:
+      jitter_fatal ("not a binary comparison primitive: %i", (int) p);
+    }
+}
+
+/* Append to the pointed code code branching to the given label when the
+   given condition is true, if branch_if_true is non-false, or when the
+   condition is false otherwise; the code falls through in the opposite case.
+   This is the register counterpart of izmir_generate_stack_conditional , with
+   the same strategy: comparisons become one fused compare-and-branch
+   instruction, and negations reverse the branch condition. */
+static void
+izmir_generate_register_conditional (struct izmir_code *c,
+                                     struct izmir_static_environment *e,
+                                     struct izmir_expression *condition,
+                                     bool branch_if_true,
+                                     izmir_code_label target)
+{
+  switch (condition->case_)
+    {
+    case izmir_expression_case_literal:
+      if ((condition->literal != 0) == branch_if_true)
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+          izmir_code_append_label_parameter (c, target);
+        }
+      return;
+
+    case izmir_expression_case_if_then_else:
+      {
+        /* This is how "and" and "or" are parsed: short-circuit them by
+           branching directly from each arm. */
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_code_label after_label = izmir_code_fresh_label (c);
+        izmir_generate_register_conditional
+           (c, e, condition->if_then_else_condition, false, else_label);
+        izmir_generate_register_conditional
+           (c, e, condition->if_then_else_then_branch, branch_if_true,
+            target);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+        izmir_code_append_label_parameter (c, after_label);
+        izmir_code_append_label (c, else_label);
+        izmir_generate_register_conditional
+           (c, e, condition->if_then_else_else_branch, branch_if_true,
+            target);
+        izmir_code_append_label (c, after_label);
+        return;
+      }
+
+    case izmir_expression_case_primitive:
+      switch (condition->primitive)
+        {
+        case izmir_primitive_logical_not:
+          izmir_generate_register_conditional
+             (c, e, condition->primitive_operand_0, ! branch_if_true, target);
+          return;
+        case izmir_primitive_is_nonzero:
+          izmir_generate_register_conditional
+             (c, e, condition->primitive_operand_0, branch_if_true, target);
+          return;
+        case izmir_primitive_equal:
+        case izmir_primitive_different:
+        case izmir_primitive_less:
+        case izmir_primitive_less_or_equal:
+        case izmir_primitive_greater:
+        case izmir_primitive_greater_or_equal:
+          {
+            struct izmir_operand o0
+              = izmir_generate_register_operand
+                   (c, e, condition->primitive_operand_0);
+            struct izmir_operand o1
+              = izmir_generate_register_operand
+                   (c, e, condition->primitive_operand_1);
+            izmir_generate_register_comparison_branch
+               (c,
+                (branch_if_true
+                 ? condition->primitive
+                 : izmir_reverse_comparison_primitive (condition->primitive)));
+            izmir_append_operand (c, o0);
+            izmir_append_operand (c, o1);
+            izmir_code_append_label_parameter (c, target);
+            izmir_release_operand (e, o1);
+            izmir_release_operand (e, o0);
+            return;
+          }
+        default:
+          break;
+        }
+      break;
+
+    default:
+      break;
+    }
+
+  /* In the general case compute the condition value, and test it. */
+  struct izmir_operand o = izmir_generate_register_operand (c, e, condition);
+  if (branch_if_true)
+    IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mnonzero);
+  else
+    IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mzero);
+  izmir_append_operand (c, o);
+  izmir_code_append_label_parameter (c, target);
+  izmir_release_operand (e, o);
+}
+
+
+
+
+/* Statement code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the code for the given statement. */
+static void
+izmir_generate_register_statement (struct izmir_code *c,
+                                   struct izmir_static_environment *e,
+                                   struct izmir_statement *st)
+{
+  size_t i;
+
+  /* Sequences, blocks and inlined statements have no code of their own, and
+     their components record their own lines. */
+  if (st->case_ != izmir_statement_case_sequence
+      && st->case_ != izmir_statement_case_block
+      && st->case_ != izmir_statement_case_inlined)
+    izmir_code_append_line (c, st->line);
+
+  switch (st->case_)
+    {
+    case izmir_statement_case_skip:
+      break;
+    case izmir_statement_case_block:
+      {
+        /* Bind every variable of the chain in a loop: see
+           izmir_block_inner_block . */
+        size_t block_no = 0, prefix_no;
+        struct izmir_statement *inner;
+        while (true)
+          {
+            izmir_static_environment_bind (e, st->block_slot);
+            block_no ++;
+            if ((inner = izmir_block_inner_block (st, & prefix_no)) == NULL)
+              break;
+            for (i = 0; i < prefix_no; i ++)
+              izmir_generate_register_statement
+                 (c, e, st->block_body->sequence_statements [i]);
+            st = inner;
+          }
+        izmir_generate_register_statement (c, e, st->block_body);
+        for (i = 0; i < block_no; i ++)
+          izmir_static_environment_unbind (e);
+        break;
+      }
+    case izmir_statement_case_assignment:
+      izmir_generate_register_expression_into
+         (c, e, st->assignment_expression,
+          izmir_static_environment_register (e, st->assignment_slot));
+      break;
+    case izmir_statement_case_print:
+      {
+        struct izmir_operand o
+          = izmir_generate_register_operand (c, e, st->print_expression);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, print_mregister);
+        izmir_append_operand (c, o);
+        izmir_release_operand (e, o);
+        break;
+      }
+    case izmir_statement_case_sequence:
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        izmir_generate_register_statement (c, e, st->sequence_statements [i]);
+      break;
+    case izmir_statement_case_if_then_else:
+      {
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_generate_register_conditional (c, e, st->if_then_else_condition,
+                                             false, else_label);
+        izmir_generate_register_statement (c, e, st->if_then_else_then_branch);
+        if (st->if_then_else_else_branch->case_ == izmir_statement_case_skip)
+          izmir_code_append_label (c, else_label);
+        else
+          {
+            izmir_code_label after_label = izmir_code_fresh_label (c);
+            IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+            izmir_code_append_label_parameter (c, after_label);
+            izmir_code_append_label (c, else_label);
+            izmir_generate_register_statement (c, e,
+                                               st->if_then_else_else_branch);
+            izmir_code_append_label (c, after_label);
+          }
+        break;
+      }
+    case izmir_statement_case_repeat_until:
+      {
+        /* The loop back-edge is a single conditional branch. */
+        izmir_code_label loop_label = izmir_code_fresh_label (c);
+        izmir_code_append_label (c, loop_label);
+        izmir_generate_register_statement (c, e, st->repeat_until_body);
+        izmir_code_append_line (c, st->line);
+        izmir_generate_register_conditional (c, e, st->repeat_until_guard,
+                                             false, loop_label);
+        break;
+      }
+    case izmir_statement_case_return:
+      /* Returning from the main statement ends the program, and its result is
+         ignored. */
+      if (e->procedure == NULL)
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, exitvm);
+          break;
+        }
+      if (izmir_tail_calls
+          && st->return_result->case_ == izmir_expression_case_call)
+        {
+          izmir_generate_register_tail_call (c, e,
+                                             st->return_result->callee_index,
+                                             st->return_result->actuals,
+                                             st->return_result->actual_no);
+          break;
+        }
+      izmir_generate_register_expression_into (c, e, st->return_result,
+                                               IZMIR_RESULT_REGISTER);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, return);
+      break;
+    case izmir_statement_case_call:
+      izmir_generate_register_call (c, e, st->callee_index, st->actuals,
+                                    st->actual_no, -1);
+      break;
+    case izmir_statement_case_element_assignment:
+      {
+        struct izmir_operand a
+          = izmir_generate_register_array_operand (c, e, st->element_array);
+        struct izmir_operand index
+          = izmir_generate_register_operand (c, e, st->element_index);
+        struct izmir_operand value
+          = izmir_generate_register_operand (c, e, st->element_value);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, array_mset);
+        izmir_append_operand (c, a);
+        izmir_append_operand (c, index);
+        izmir_append_operand (c, value);
+        izmir_release_operand (e, value);
+        izmir_release_operand (e, index);
+        izmir_release_operand (e, a);
+        break;
+      }
+    case izmir_statement_case_bulk:
+      {
+        /* Every operand is an array, except for the value of fill. */
+        struct izmir_operand operands [3];
+        for (i = 0; i < st->bulk_operand_no; i ++)
+          operands [i]
+            = ((st->bulk_operation == izmir_bulk_operation_fill && i == 1)
+               ? izmir_generate_register_operand (c, e, st->bulk_operands [i])
+               : izmir_generate_register_array_operand
+                    (c, e, st->bulk_operands [i]));
+        switch (st->bulk_operation)
+          {
+          case izmir_bulk_operation_fill:
+            IZMIR_CODE_APPEND_INSTRUCTION (c, array_mfill);
+            break;
+          case izmir_bulk_operation_copy:
+            IZMIR_CODE_APPEND_INSTRUCTION (c, array_mcopy);
+            break;
+          case izmir_bulk_operation_add:
+            IZMIR_CODE_APPEND_INSTRUCTION (c, array_madd);
+            break;
+          case izmir_bulk_operation_multiply:
+            IZMIR_CODE_APPEND_INSTRUCTION (c, array_mmultiply);
+            break;
+          default:
+            jitter_fatal ("invalid bulk operation: %i",
+                          (int) st->bulk_operation);
+          }
+        for (i = 0; i < st->bulk_operand_no; i ++)
+          izmir_append_operand (c, operands [i]);
+        for (i = st->bulk_operand_no; i > 0; i --)
+          izmir_release_operand (e, operands [i - 1]);
+        break;
+      }
+    case izmir_statement_case_inlined:
+      st->inlined_exit_label = izmir_code_fresh_label (c);
+      izmir_generate_register_statement (c, e, st->inlined_body);
+      izmir_code_append_label (c, st->inlined_exit_label);
+      break;
+    case izmir_statement_case_inlined_exit:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+      izmir_code_append_label_parameter
+         (c, st->inlined_exit_target->inlined_exit_label);
+      break;
+    default:
+      jitter_fatal ("statement case not supported yet: %i", (int) st->case_);
+    }
+}
+
+
+
+
+/* Program code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the code for the procedure with the given
+   index in the pointed program, whose procedure entry points are the given
+   labels. */
+static void
+izmir_generate_register_procedure (struct izmir_code *c,
+                                   struct izmir_program *p,
+                                   const izmir_code_label *procedure_labels,
+                                   size_t procedure_index)
+{
+  struct izmir_procedure *procedure = p->procedures [procedure_index];
+  struct izmir_static_environment e;
+  izmir_static_environment_initialize (& e, p, procedure_labels);
+  e.procedure = procedure;
+
+  /* Save the link, check for room on the main stack and pop the actuals into
+     the formals, last to first.  The depth to check for is filled in by
+     izmir_stack_depth_verify .  Tail calls enter right past the prolog. */
+  izmir_code_append_label (c, procedure_labels [procedure_index]);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, procedure_mprolog);
+  izmir_code_append_label
+     (c, izmir_static_environment_procedure_tail (& e, procedure_index));
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mreserve);
+  izmir_code_append_literal_parameter (c, 0);
+  size_t i;
+  for (i = 0; i < procedure->formal_no; i ++)
+    izmir_static_environment_bind (& e, i);
+  for (i = procedure->formal_no; i > 0; i --)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter
+         (c, izmir_static_environment_register (& e, i - 1));
+    }
+
+  /* Compile the body.  Falling off its end returns an undefined result. */
+  izmir_generate_register_statement (c, & e, procedure->body);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, return);
+
+  for (i = 0; i < procedure->formal_no; i ++)
+    izmir_static_environment_unbind (& e);
+  izmir_static_environment_finalize (& e);
+}
+
+void
+izmir_generate_program_register (struct izmir_code *c, struct izmir_program *p)
+{
+  izmir_code_label *procedure_labels = izmir_make_procedure_labels (c, p);
+
+  /* Compile the main statement first, so that execution starts from it, and
+     end it explicitly so that control never falls into a procedure.  The main
+     stack is empty here: set its limit, and check for room as at procedure
+     entry. */
+  size_t main_item_index = c->item_no;
+  struct izmir_static_environment e;
+  izmir_static_environment_initialize (& e, p, procedure_labels);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mset_mlimit);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mreserve);
+  izmir_code_append_literal_parameter (c, 0);
+  if (p->uses_arrays)
+    IZMIR_CODE_APPEND_INSTRUCTION (c, heap_mset_mstack_mbottom);
+  izmir_generate_register_statement (c, & e, p->main_statement);
+  izmir_static_environment_finalize (& e);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, exitvm);
+
+  izmir_generate_procedures (c, p, procedure_labels,
+                             izmir_generate_register_procedure);
+  izmir_stack_depth_verify (c, p, main_item_index, procedure_labels);
+  free (procedure_labels);
+}
@@ -0,0 +1,659 @@
+/* Izmir language: stack-based code generator.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-code-generator-stack.h"
+#include "izmir-stack-depth.h"
+#include "izmir-static-environment.h"
+
+
+/* Expression code generation.
+ * ************************************************************************** */
+
+static void
+izmir_generate_stack_expression (struct izmir_code *c,
+                                 struct izmir_static_environment *e,
+                                 struct izmir_expression *exp);
+
+static void
+izmir_generate_stack_conditional (struct izmir_code *c,
+                                  struct izmir_static_environment *e,
+                                  struct izmir_expression *condition,
+                                  bool branch_if_true,
+                                  izmir_code_label target);
+
+/* Append to the pointed code the code pushing every register in use on the
+   main stack. */
+static void
+izmir_generate_stack_save_registers (struct izmir_code *c,
+                                     struct izmir_static_environment *e)
+{
+  jitter_int i;
+  for (i = IZMIR_FIRST_ALLOCATABLE_REGISTER; i < e->used_register_no; i ++)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+      izmir_code_append_register_parameter (c, i);
+    }
+}
+
+/* Append to the pointed code the code popping the registers pushed by the
+   code from izmir_generate_stack_save_registers . */
+static void
+izmir_generate_stack_restore_registers (struct izmir_code *c,
+                                        struct izmir_static_environment *e)
+{
+  jitter_int i;
+  for (i = e->used_register_no - 1; i >= IZMIR_FIRST_ALLOCATABLE_REGISTER; i --)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter (c, i);
+    }
+}
+
+/* Append to the pointed code the code for the given primitive
+   expression, which will push its result on the main stack. */
+static void
+izmir_generate_stack_primitive (struct izmir_code *c,
+                                struct izmir_static_environment *e,
+                                struct izmir_expression *exp)
+{
+  /* Multiplication, division and remainder by a literal power of two have
+     specialized instructions, with the exponent as a literal argument. */
+  int exponent;
+  if ((exp->primitive == izmir_primitive_times
+       || exp->primitive == izmir_primitive_divided
+       || exp->primitive == izmir_primitive_remainder)
+      && (exponent = izmir_power_of_two_exponent (exp->primitive_operand_1))
+         > 0)
+    {
+      izmir_generate_stack_expression (c, e, exp->primitive_operand_0);
+      if (exp->primitive == izmir_primitive_times)
+        IZMIR_CODE_APPEND_INSTRUCTION (c, times_mpower_mof_mtwo_mstack);
+      else if (exp->primitive == izmir_primitive_divided)
+        IZMIR_CODE_APPEND_INSTRUCTION (c, divided_mpower_mof_mtwo_mstack);
+      else
+        IZMIR_CODE_APPEND_INSTRUCTION (c,
+                                            remainder_mpower_mof_mtwo_mstack);
+      izmir_code_append_literal_parameter (c, exponent);
+      return;
+    }
+
+  /* Creating an array allocates, and the collector only finds references on
+     the main stack: save the registers there first, as around calls, keeping
+     the result in the result register until they are restored. */
+  if (exp->primitive == izmir_primitive_array_new)
+    {
+      izmir_generate_stack_save_registers (c, e);
+      izmir_generate_stack_expression (c, e, exp->primitive_operand_0);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mnew_mstack);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter (c, IZMIR_RESULT_REGISTER);
+      izmir_generate_stack_restore_registers (c, e);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+      izmir_code_append_register_parameter (c, IZMIR_RESULT_REGISTER);
+      return;
+    }
+
+  /* In every other case compile the operands, left to right, then the
+     instruction consuming them. */
+  if (exp->primitive_operand_0 != NULL)
+    izmir_generate_stack_expression (c, e, exp->primitive_operand_0);
+  if (exp->primitive_operand_1 != NULL)
+    izmir_generate_stack_expression (c, e, exp->primitive_operand_1);
+  switch (exp->primitive)
+    {
+    case izmir_primitive_plus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, plus_mstack);
+      break;
+    case izmir_primitive_minus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, minus_mstack);
+      break;
+    case izmir_primitive_times:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, times_mstack);
+      break;
+    case izmir_primitive_divided:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, divided_mstack);
+      break;
+    case izmir_primitive_remainder:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, remainder_mstack);
+      break;
+    case izmir_primitive_unary_minus:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, unary_mminus_mstack);
+      break;
+    case izmir_primitive_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, equal_mstack);
+      break;
+    case izmir_primitive_different:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, different_mstack);
+      break;
+    case izmir_primitive_less:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, less_mstack);
+      break;
+    case izmir_primitive_less_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, less_mor_mequal_mstack);
+      break;
+    case izmir_primitive_greater:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, greater_mstack);
+      break;
+    case izmir_primitive_greater_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, greater_mor_mequal_mstack);
+      break;
+    case izmir_primitive_logical_not:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, logical_mnot_mstack);
+      break;
+    case izmir_primitive_is_nonzero:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, is_mnonzero_mstack);
+      break;
+    case izmir_primitive_input:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, input_mstack);
+      break;
+    case izmir_primitive_array_element:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_melement_mstack);
+      break;
+    case izmir_primitive_array_length:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mlength_mstack);
+      break;
+    case izmir_primitive_array_sum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_msum_mstack);
+      break;
+    case izmir_primitive_array_minimum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mminimum_mstack);
+      break;
+    case izmir_primitive_array_maximum:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mmaximum_mstack);
+      break;
+    case izmir_primitive_array_dot:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mdot_mstack);
+      break;
+    default:
+      jitter_fatal ("invalid primitive: %i", (int) exp->primitive);
+    }
+}
+
+/* Append to the pointed code the code for a call to the procedure with the
+   given index with the given actuals, following the calling convention
+   described in izmirvm.jitter .  The result is left in the result register. */
+static void
+izmir_generate_stack_call (struct izmir_code *c,
+                           struct izmir_static_environment *e,
+                           size_t callee_index,
+                           struct izmir_expression **actuals,
+                           size_t actual_no)
+{
+  izmir_code_label callee_label
+    = izmir_static_environment_procedure (e, callee_index);
+
+  /* Save the registers holding variables, which the callee may clobber. */
+  izmir_generate_stack_save_registers (c, e);
+
+  /* Push the actuals, left to right, and call. */
+  size_t j;
+  for (j = 0; j < actual_no; j ++)
+    izmir_generate_stack_expression (c, e, actuals [j]);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, call);
+  izmir_code_append_label_parameter (c, callee_label);
+
+  /* Restore the saved registers. */
+  izmir_generate_stack_restore_registers (c, e);
+}
+
+/* Append to the pointed code the code for a tail call to the procedure with
+   the given index with the given actuals, replacing the current procedure:
+   see izmir-static-environment.h .  No register needs saving, since the
+   current procedure is over. */
+static void
+izmir_generate_stack_tail_call (struct izmir_code *c,
+                                struct izmir_static_environment *e,
+                                size_t callee_index,
+                                struct izmir_expression **actuals,
+                                size_t actual_no)
+{
+  size_t j;
+  for (j = 0; j < actual_no; j ++)
+    izmir_generate_stack_expression (c, e, actuals [j]);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, tail_mcall);
+  izmir_code_append_label_parameter
+     (c, izmir_static_environment_procedure_tail (e, callee_index));
+}
+
+/* Append to the pointed code the code for the given expression, which
+   will push its result on the main stack. */
+static void
+izmir_generate_stack_expression (struct izmir_code *c,
+                                 struct izmir_static_environment *e,
+                                 struct izmir_expression *exp)
+{
+  switch (exp->case_)
+    {
+    case izmir_expression_case_undefined:
+      /* Any value will do; zero is as good as any other. */
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushconstant);
+      izmir_code_append_literal_parameter (c, 0);
+      break;
+    case izmir_expression_case_literal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushconstant);
+      izmir_code_append_literal_parameter (c, exp->literal);
+      break;
+    case izmir_expression_case_variable:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+      izmir_code_append_register_parameter
+         (c, izmir_static_environment_register (e, exp->variable_slot));
+      break;
+    case izmir_expression_case_if_then_else:
+      {
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_code_label after_label = izmir_code_fresh_label (c);
+        izmir_generate_stack_conditional (c, e, exp->if_then_else_condition,
+                                          false, else_label);
+        izmir_generate_stack_expression (c, e, exp->if_then_else_then_branch);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+        izmir_code_append_label_parameter (c, after_label);
+        izmir_code_append_label (c, else_label);
+        izmir_generate_stack_expression (c, e, exp->if_then_else_else_branch);
+        izmir_code_append_label (c, after_label);
+        break;
+      }
+    case izmir_expression_case_primitive:
+      izmir_generate_stack_primitive (c, e, exp);
+      break;
+    case izmir_expression_case_call:
+      izmir_generate_stack_call (c, e, exp->callee_index, exp->actuals,
+                                 exp->actual_no);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, pushregister);
+      izmir_code_append_register_parameter (c, IZMIR_RESULT_REGISTER);
+      break;
+    default:
+      jitter_fatal ("expression case not supported yet: %i",
+                    (int) exp->case_);
+    }
+}
+
+
+
+
+/* Conditional code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code a stack conditional branch to the given
+   label, taken when the given comparison primitive holds on the two
+   topmost stack elements. */
+static void
+izmir_generate_stack_comparison_branch (struct izmir_code *c,
+                                        enum izmir_primitive p,
+                                        izmir_code_label target)
+{
+  switch (p)
+    {
+    case izmir_primitive_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mequal_mstack);
+      break;
+    case izmir_primitive_different:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mdifferent_mstack);
+      break;
+    case izmir_primitive_less:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mless_mstack);
+      break;
+    case izmir_primitive_less_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mless_mor_mequal_mstack);
+      break;
+    case izmir_primitive_greater:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mgreater_mstack);
+      break;
+    case izmir_primitive_greater_or_equal:
+      IZMIR_CODE_APPEND_INSTRUCTION
+         (c, branch_mif_mgreater_mor_mequal_mstack);
+      break;
+    default:
+      jitter_fatal ("not a binary comparison primitive: %i", (int) p);
+    }
+  izmir_code_append_label_parameter (c, target);
+}
+
+/* Append to the pointed code code branching to the given label when the
+   given condition is true, if branch_if_true is non-false, or when the
+   condition is false otherwise; the code falls through in the opposite case.
+   Comparisons compile to a single fused compare-and-branch instruction, and
+   negations are compiled away by reversing the branch condition, so that no
+   boolean is ever materialized on the stack just to be tested. */
+static void
+izmir_generate_stack_conditional (struct izmir_code *c,
+                                  struct izmir_static_environment *e,
+                                  struct izmir_expression *condition,
+                                  bool branch_if_true,
+                                  izmir_code_label target)
+{
+  switch (condition->case_)
+    {
+    case izmir_expression_case_literal:
+      if ((condition->literal != 0) == branch_if_true)
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+          izmir_code_append_label_parameter (c, target);
+        }
+      return;
+
+    case izmir_expression_case_if_then_else:
+      {
+        /* This is how "and" and "or" are parsed: short-circuit them by
+           branching directly from each arm. */
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_code_label after_label = izmir_code_fresh_label (c);
+        izmir_generate_stack_conditional
+           (c, e, condition->if_then_else_condition, false, else_label);
+        izmir_generate_stack_conditional
+           (c, e, condition->if_then_else_then_branch, branch_if_true,
+            target);
+        IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+        izmir_code_append_label_parameter (c, after_label);
+        izmir_code_append_label (c, else_label);
+        izmir_generate_stack_conditional
+           (c, e, condition->if_then_else_else_branch, branch_if_true,
+            target);
+        izmir_code_append_label (c, after_label);
+        return;
+      }
+
+    case izmir_expression_case_primitive:
+      switch (condition->primitive)
+        {
+        case izmir_primitive_logical_not:
+          izmir_generate_stack_conditional
+             (c, e, condition->primitive_operand_0, ! branch_if_true, target);
+          return;
+        case izmir_primitive_is_nonzero:
+          izmir_generate_stack_conditional
+             (c, e, condition->primitive_operand_0, branch_if_true, target);
+          return;
+        case izmir_primitive_equal:
+        case izmir_primitive_different:
+        case izmir_primitive_less:
+        case izmir_primitive_less_or_equal:
+        case izmir_primitive_greater:
+        case izmir_primitive_greater_or_equal:
+          izmir_generate_stack_expression
+             (c, e, condition->primitive_operand_0);
+          izmir_generate_stack_expression
+             (c, e, condition->primitive_operand_1);
+          izmir_generate_stack_comparison_branch
+             (c,
+              (branch_if_true
+               ? condition->primitive
+               : izmir_reverse_comparison_primitive (condition->primitive)),
+              target);
+          return;
+        default:
+          break;
+        }
+      break;
+
+    default:
+      break;
+    }
+
+  /* In the general case compute the condition value, and test it. */
+  izmir_generate_stack_expression (c, e, condition);
+  if (branch_if_true)
+    IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mnonzero_mstack);
+  else
+    IZMIR_CODE_APPEND_INSTRUCTION (c, branch_mif_mzero_mstack);
+  izmir_code_append_label_parameter (c, target);
+}
+
+
+
+
+/* Statement code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the code for the given statement. */
+static void
+izmir_generate_stack_statement (struct izmir_code *c,
+                                struct izmir_static_environment *e,
+                                struct izmir_statement *st)
+{
+  size_t i;
+
+  /* Sequences, blocks and inlined statements have no code of their own, and
+     their components record their own lines. */
+  if (st->case_ != izmir_statement_case_sequence
+      && st->case_ != izmir_statement_case_block
+      && st->case_ != izmir_statement_case_inlined)
+    izmir_code_append_line (c, st->line);
+
+  switch (st->case_)
+    {
+    case izmir_statement_case_skip:
+      break;
+    case izmir_statement_case_block:
+      {
+        /* Bind every variable of the chain in a loop: see
+           izmir_block_inner_block . */
+        size_t block_no = 0, prefix_no;
+        struct izmir_statement *inner;
+        while (true)
+          {
+            izmir_static_environment_bind (e, st->block_slot);
+            block_no ++;
+            if ((inner = izmir_block_inner_block (st, & prefix_no)) == NULL)
+              break;
+            for (i = 0; i < prefix_no; i ++)
+              izmir_generate_stack_statement
+                 (c, e, st->block_body->sequence_statements [i]);
+            st = inner;
+          }
+        izmir_generate_stack_statement (c, e, st->block_body);
+        for (i = 0; i < block_no; i ++)
+          izmir_static_environment_unbind (e);
+        break;
+      }
+    case izmir_statement_case_assignment:
+      izmir_generate_stack_expression (c, e, st->assignment_expression);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter
+         (c, izmir_static_environment_register (e, st->assignment_slot));
+      break;
+    case izmir_statement_case_print:
+      izmir_generate_stack_expression (c, e, st->print_expression);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, print);
+      break;
+    case izmir_statement_case_sequence:
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        izmir_generate_stack_statement (c, e, st->sequence_statements [i]);
+      break;
+    case izmir_statement_case_if_then_else:
+      {
+        izmir_code_label else_label = izmir_code_fresh_label (c);
+        izmir_generate_stack_conditional (c, e, st->if_then_else_condition,
+                                          false, else_label);
+        izmir_generate_stack_statement (c, e, st->if_then_else_then_branch);
+        if (st->if_then_else_else_branch->case_ == izmir_statement_case_skip)
+          izmir_code_append_label (c, else_label);
+        else
+          {
+            izmir_code_label after_label = izmir_code_fresh_label (c);
+            IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+            izmir_code_append_label_parameter (c, after_label);
+            izmir_code_append_label (c, else_label);
+            izmir_generate_stack_statement (c, e,
+                                            st->if_then_else_else_branch);
+            izmir_code_append_label (c, after_label);
+          }
+        break;
+      }
+    case izmir_statement_case_repeat_until:
+      {
+        /* The loop back-edge is a single conditional branch. */
+        izmir_code_label loop_label = izmir_code_fresh_label (c);
+        izmir_code_append_label (c, loop_label);
+        izmir_generate_stack_statement (c, e, st->repeat_until_body);
+        izmir_code_append_line (c, st->line);
+        izmir_generate_stack_conditional (c, e, st->repeat_until_guard,
+                                          false, loop_label);
+        break;
+      }
+    case izmir_statement_case_return:
+      /* Returning from the main statement ends the program, and its result is
+         ignored. */
+      if (e->procedure == NULL)
+        {
+          IZMIR_CODE_APPEND_INSTRUCTION (c, exitvm);
+          break;
+        }
+      if (izmir_tail_calls
+          && st->return_result->case_ == izmir_expression_case_call)
+        {
+          izmir_generate_stack_tail_call (c, e,
+                                          st->return_result->callee_index,
+                                          st->return_result->actuals,
+                                          st->return_result->actual_no);
+          break;
+        }
+      izmir_generate_stack_expression (c, e, st->return_result);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter (c, IZMIR_RESULT_REGISTER);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, return);
+      break;
+    case izmir_statement_case_call:
+      izmir_generate_stack_call (c, e, st->callee_index, st->actuals,
+                                 st->actual_no);
+      break;
+    case izmir_statement_case_element_assignment:
+      izmir_generate_stack_expression (c, e, st->element_array);
+      izmir_generate_stack_expression (c, e, st->element_index);
+      izmir_generate_stack_expression (c, e, st->element_value);
+      IZMIR_CODE_APPEND_INSTRUCTION (c, array_mset_mstack);
+      break;
+    case izmir_statement_case_bulk:
+      for (i = 0; i < st->bulk_operand_no; i ++)
+        izmir_generate_stack_expression (c, e, st->bulk_operands [i]);
+      switch (st->bulk_operation)
+        {
+        case izmir_bulk_operation_fill:
+          IZMIR_CODE_APPEND_INSTRUCTION (c, array_mfill_mstack);
+          break;
+        case izmir_bulk_operation_copy:
+          IZMIR_CODE_APPEND_INSTRUCTION (c, array_mcopy_mstack);
+          break;
+        case izmir_bulk_operation_add:
+          IZMIR_CODE_APPEND_INSTRUCTION (c, array_madd_mstack);
+          break;
+        case izmir_bulk_operation_multiply:
+          IZMIR_CODE_APPEND_INSTRUCTION (c, array_mmultiply_mstack);
+          break;
+        default:
+          jitter_fatal ("invalid bulk operation: %i",
+                        (int) st->bulk_operation);
+        }
+      break;
+    case izmir_statement_case_inlined:
+      st->inlined_exit_label = izmir_code_fresh_label (c);
+      izmir_generate_stack_statement (c, e, st->inlined_body);
+      izmir_code_append_label (c, st->inlined_exit_label);
+      break;
+    case izmir_statement_case_inlined_exit:
+      IZMIR_CODE_APPEND_INSTRUCTION (c, branch);
+      izmir_code_append_label_parameter
+         (c, st->inlined_exit_target->inlined_exit_label);
+      break;
+    default:
+      jitter_fatal ("statement case not supported yet: %i", (int) st->case_);
+    }
+}
+
+
+
+
+/* Program code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the code for the procedure with the given
+   index in the pointed program, whose procedure entry points are the given
+   labels. */
+static void
+izmir_generate_stack_procedure (struct izmir_code *c, struct izmir_program *p,
+                                const izmir_code_label *procedure_labels,
+                                size_t procedure_index)
+{
+  struct izmir_procedure *procedure = p->procedures [procedure_index];
+  struct izmir_static_environment e;
+  izmir_static_environment_initialize (& e, p, procedure_labels);
+  e.procedure = procedure;
+
+  /* Save the link, check for room on the main stack and pop the actuals into
+     the formals, last to first.  The depth to check for is filled in by
+     izmir_stack_depth_verify .  Tail calls enter right past the prolog. */
+  izmir_code_append_label (c, procedure_labels [procedure_index]);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, procedure_mprolog);
+  izmir_code_append_label
+     (c, izmir_static_environment_procedure_tail (& e, procedure_index));
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mreserve);
+  izmir_code_append_literal_parameter (c, 0);
+  size_t i;
+  for (i = 0; i < procedure->formal_no; i ++)
+    izmir_static_environment_bind (& e, i);
+  for (i = procedure->formal_no; i > 0; i --)
+    {
+      IZMIR_CODE_APPEND_INSTRUCTION (c, popregister);
+      izmir_code_append_register_parameter
+         (c, izmir_static_environment_register (& e, i - 1));
+    }
+
+  /* Compile the body.  Falling off its end returns an undefined result. */
+  izmir_generate_stack_statement (c, & e, procedure->body);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, return);
+
+  for (i = 0; i < procedure->formal_no; i ++)
+    izmir_static_environment_unbind (& e);
+  izmir_static_environment_finalize (& e);
+}
+
+void
+izmir_generate_program_stack (struct izmir_code *c, struct izmir_program *p)
+{
+  izmir_code_label *procedure_labels = izmir_make_procedure_labels (c, p);
+
+  /* Compile the main statement first, so that execution starts from it, and
+     end it explicitly so that control never falls into a procedure.  The main
+     stack is empty here: set its limit, and check for room as at procedure
+     entry. */
+  size_t main_item_index = c->item_no;
+  struct izmir_static_environment e;
+  izmir_static_environment_initialize (& e, p, procedure_labels);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mset_mlimit);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, mainstack_mreserve);
+  izmir_code_append_literal_parameter (c, 0);
+  if (p->uses_arrays)
+    IZMIR_CODE_APPEND_INSTRUCTION (c, heap_mset_mstack_mbottom);
+  izmir_generate_stack_statement (c, & e, p->main_statement);
+  izmir_static_environment_finalize (& e);
+  IZMIR_CODE_APPEND_INSTRUCTION (c, exitvm);
+
+  izmir_generate_procedures (c, p, procedure_labels,
+                             izmir_generate_stack_procedure);
+  izmir_stack_depth_verify (c, p, main_item_index, procedure_labels);
+  free (procedure_labels);
+}
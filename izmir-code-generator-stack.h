@@ -0,0 +1,41 @@
+/* Izmir language: stack-based code generator.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_CODE_GENERATOR_STACK_H_
+#define IZMIR_CODE_GENERATOR_STACK_H_
+
+#include "izmir-syntax.h"
+#include "izmir-code.h"
+
+
+/* Stack-based code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the stack-based translation of the pointed
+   program.  Expressions are evaluated on the main stack; variables live in
+   registers, and are only moved to and from the stack. */
+void
+izmir_generate_program_stack (struct izmir_code *c, struct izmir_program *p);
+
+
+#endif // #ifndef IZMIR_CODE_GENERATOR_STACK_H_
@@ -0,0 +1,269 @@
+/* Izmir language: recorded VM code.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdbool.h>
+#include <sys/mman.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+#include <jitter/jitter-mutable-routine.h>
+
+#include "izmir-code.h"
+
+
+/* Recording code.
+ * ************************************************************************** */
+
+void
+izmir_code_initialize (struct izmir_code *c)
+{
+  c->items = NULL;
+  c->item_no = 0;
+  c->item_allocated_no = 0;
+  c->label_no = 0;
+  c->line = 0;
+  c->main_item_index = 0;
+  c->procedures = NULL;
+  c->procedure_no = 0;
+  c->mapping = NULL;
+  c->mapping_size = 0;
+}
+
+void
+izmir_code_finalize (struct izmir_code *c)
+{
+  if (c->mapping != NULL)
+    munmap (c->mapping, c->mapping_size);
+  else
+    {
+      free (c->items);
+      free (c->procedures);
+    }
+}
+
+/* Append an item with the given case and value to the pointed code, which must
+   not be mapped from a file. */
+static void
+izmir_code_append_item (struct izmir_code *c, enum izmir_code_item_case case_,
+                        int64_t value)
+{
+  if (__builtin_expect (c->item_no == c->item_allocated_no, false))
+    {
+      if (c->mapping != NULL)
+        jitter_fatal ("appending to recorded code loaded from a file");
+      c->item_allocated_no = 2 * c->item_allocated_no + 64;
+      c->items = jitter_xrealloc (c->items,
+                                  sizeof (struct izmir_code_item)
+                                  * c->item_allocated_no);
+    }
+  struct izmir_code_item *item = c->items + c->item_no ++;
+  item->case_ = case_;
+  item->unused = 0;
+  item->value = value;
+}
+
+void
+izmir_code_append_instruction (struct izmir_code *c,
+                               enum izmirvm_meta_instruction_id id)
+{
+  izmir_code_append_item (c, izmir_code_item_case_instruction, id);
+}
+
+void
+izmir_code_append_literal_parameter (struct izmir_code *c, jitter_int value)
+{
+  izmir_code_append_item (c, izmir_code_item_case_literal_parameter, value);
+}
+
+void
+izmir_code_append_register_parameter (struct izmir_code *c,
+                                      jitter_int register_index)
+{
+  izmir_code_append_item (c, izmir_code_item_case_register_parameter,
+                          register_index);
+}
+
+void
+izmir_code_append_label_parameter (struct izmir_code *c, izmir_code_label l)
+{
+  izmir_code_append_item (c, izmir_code_item_case_label_parameter, l);
+}
+
+void
+izmir_code_append_line (struct izmir_code *c, int line)
+{
+  if (line == c->line)
+    return;
+  c->line = line;
+
+  /* A line item immediately followed by another has no instructions. */
+  if (c->item_no > 0
+      && c->items [c->item_no - 1].case_ == izmir_code_item_case_line)
+    c->items [c->item_no - 1].value = line;
+  else
+    izmir_code_append_item (c, izmir_code_item_case_line, line);
+}
+
+izmir_code_label
+izmir_code_fresh_label (struct izmir_code *c)
+{
+  return c->label_no ++;
+}
+
+void
+izmir_code_append_label (struct izmir_code *c, izmir_code_label l)
+{
+  izmir_code_append_item (c, izmir_code_item_case_label, l);
+}
+
+void
+izmir_code_append_code (struct izmir_code *c, const struct izmir_code *other,
+                        izmir_code_label shared_label_no)
+{
+  izmir_code_label offset = c->label_no - shared_label_no;
+  size_t i;
+  for (i = 0; i < other->item_no; i ++)
+    {
+      const struct izmir_code_item *item = other->items + i;
+      int64_t value = item->value;
+      switch (item->case_)
+        {
+        case izmir_code_item_case_line:
+          izmir_code_append_line (c, value);
+          continue;
+        case izmir_code_item_case_label_parameter:
+        case izmir_code_item_case_label:
+          if (value >= shared_label_no)
+            value += offset;
+          break;
+        default:
+          break;
+        }
+      izmir_code_append_item (c, item->case_, value);
+    }
+  c->label_no += other->label_no - shared_label_no;
+}
+
+
+
+
+/* Replaying code.
+ * ************************************************************************** */
+
+/* Record the given line as the source line of every instruction appended to
+   the pointed routine since the last call.  At least one instruction must
+   have been appended: if the routine did not grow, rewriting has merged the
+   new instructions into its last one, which now belongs to the given line. */
+static void
+izmir_code_update_lines (struct izmir_code_lines *lines, izmirvm_routine r,
+                         int line)
+{
+  size_t instruction_no = jitter_mutable_routine_instruction_no (r);
+  if (instruction_no > lines->line_allocated_no)
+    {
+      lines->line_allocated_no = 2 * instruction_no;
+      lines->lines = jitter_xrealloc (lines->lines,
+                                      sizeof (int) * lines->line_allocated_no);
+    }
+  if (lines->line_no >= instruction_no && instruction_no > 0)
+    lines->line_no = instruction_no - 1;
+  for (; lines->line_no < instruction_no; lines->line_no ++)
+    lines->lines [lines->line_no] = line;
+}
+
+void
+izmir_code_to_routine (const struct izmir_code *c, izmirvm_routine r,
+                       struct izmir_code_lines *lines)
+{
+  /* The line of the instructions being appended, and whether any was
+     appended since the last update of lines . */
+  int line = 0;
+  bool appended = false;
+  if (lines != NULL)
+    {
+      lines->lines = NULL;
+      lines->line_no = 0;
+      lines->line_allocated_no = 0;
+    }
+
+  /* Make one VM label for each recorded label, in advance. */
+  izmirvm_label *labels
+    = jitter_xmalloc (sizeof (izmirvm_label) * (c->label_no + 1));
+  izmir_code_label l;
+  for (l = 0; l < c->label_no; l ++)
+    labels [l] = izmirvm_fresh_label (r);
+
+  size_t i;
+  for (i = 0; i < c->item_no; i ++)
+    {
+      const struct izmir_code_item *item = c->items + i;
+      switch (item->case_)
+        {
+        case izmir_code_item_case_instruction:
+          if (item->value < 0 || item->value >= IZMIRVM_META_INSTRUCTION_NO)
+            jitter_fatal ("invalid recorded instruction %li",
+                          (long) item->value);
+          /* Every previous instruction is complete, and already rewritten. */
+          if (lines != NULL && appended)
+            izmir_code_update_lines (lines, r, line);
+          appended = true;
+          jitter_mutable_routine_append_meta_instruction
+             (r, izmirvm_meta_instructions + item->value);
+          break;
+        case izmir_code_item_case_literal_parameter:
+          izmirvm_routine_append_signed_literal_parameter (r, item->value);
+          break;
+        case izmir_code_item_case_register_parameter:
+          IZMIRVM_ROUTINE_APPEND_REGISTER_PARAMETER (r, r, item->value);
+          break;
+        case izmir_code_item_case_label_parameter:
+        case izmir_code_item_case_label:
+          if (item->value < 0 || item->value >= c->label_no)
+            jitter_fatal ("invalid recorded label %li", (long) item->value);
+          if (item->case_ == izmir_code_item_case_label)
+            izmirvm_routine_append_label (r, labels [item->value]);
+          else
+            izmirvm_routine_append_label_parameter (r, labels [item->value]);
+          break;
+        case izmir_code_item_case_line:
+          /* The instructions before the line change keep the old line. */
+          if (lines != NULL && appended)
+            izmir_code_update_lines (lines, r, line);
+          appended = false;
+          line = item->value;
+          break;
+        default:
+          jitter_fatal ("invalid recorded code item case %u",
+                        (unsigned) item->case_);
+        }
+    }
+  if (lines != NULL && appended)
+    izmir_code_update_lines (lines, r, line);
+  free (labels);
+}
+
+void
+izmir_code_lines_finalize (struct izmir_code_lines *lines)
+{
+  free (lines->lines);
+}
@@ -0,0 +1,247 @@
+/* Izmir language: recorded VM code.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_CODE_H_
+#define IZMIR_CODE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <jitter/jitter.h>
+
+#include "izmirvm-vm.h"
+
+
+/* About recorded code.
+ * ************************************************************************** */
+
+/* Code generators do not append instructions to a VM routine directly: they
+   record them into a struct izmir_code , a flat array of items mirroring the
+   calls which would build the routine.  Recorded code is then replayed into a
+   routine with izmir_code_to_routine .
+
+   The indirection costs little, and makes compiled code a plain data
+   structure which does not depend on the address space of the process which
+   generated it: it can be saved to a file and loaded back without parsing or
+   compiling the source again (see izmir-cache.h).
+
+   Labels in recorded code are small integers, allocated in order from zero
+   and only turned into VM labels at replay time.
+
+   Recorded code also says which source line each instruction comes from.
+   Lines do not affect the routine, but can be collected at replay time to
+   attribute native code to the source (see izmir-perf-map.h). */
+
+
+
+
+/* Recorded code data structures.
+ * ************************************************************************** */
+
+/* A label within recorded code. */
+typedef jitter_int izmir_code_label;
+
+/* The case of an item of recorded code. */
+enum izmir_code_item_case
+  {
+    /* The beginning of an instruction; the value is a meta-instruction
+       identifier, as in enum izmirvm_meta_instruction_id . */
+    izmir_code_item_case_instruction,
+
+    /* A literal argument for the current instruction. */
+    izmir_code_item_case_literal_parameter,
+
+    /* A register argument for the current instruction; the value is the index
+       of a register in the r class. */
+    izmir_code_item_case_register_parameter,
+
+    /* A label argument for the current instruction. */
+    izmir_code_item_case_label_parameter,
+
+    /* The definition of a label, at the current point. */
+    izmir_code_item_case_label,
+
+    /* The source line of the following instructions. */
+    izmir_code_item_case_line
+  };
+
+/* An item of recorded code.  The fields have fixed sizes so that the layout of
+   an item in memory is also the layout of a recorded item in a cache file. */
+struct izmir_code_item
+{
+  /* The item case, as an enum izmir_code_item_case value. */
+  uint32_t case_;
+
+  /* Unused, for alignment.  Always zero. */
+  uint32_t unused;
+
+  /* The item value, whose meaning depends on the case. */
+  int64_t value;
+};
+
+/* A procedure in recorded code, as the stack depth verifier needs it (see
+   izmir-stack-depth.h).  As for items, the fields have fixed sizes so that
+   this is also the layout in a cache file. */
+struct izmir_code_procedure
+{
+  /* The label of the procedure entry point, and of its tail entry point right
+     past the prolog. */
+  int64_t entry_label;
+  int64_t tail_entry_label;
+
+  /* The number of formals, which are on the main stack at entry. */
+  int64_t formal_no;
+};
+
+/* Recorded code. */
+struct izmir_code
+{
+  /* The items, in order.  The array is malloc-allocated, unless mapping is
+     non-NULL. */
+  struct izmir_code_item *items;
+
+  /* The number of used elements in items . */
+  size_t item_no;
+
+  /* The number of allocated elements in items , or zero if items is not
+     malloc-allocated. */
+  size_t item_allocated_no;
+
+  /* The number of labels allocated so far. */
+  izmir_code_label label_no;
+
+  /* The value of the last line item, or zero if there is none. */
+  int64_t line;
+
+  /* The index of the first item of the main statement, and the procedures,
+     as recorded by izmir_stack_depth_verify so that the code can be verified
+     again after being loaded from a file.  The array is malloc-allocated,
+     unless mapping is non-NULL, and may be NULL before verification. */
+  size_t main_item_index;
+  struct izmir_code_procedure *procedures;
+  size_t procedure_no;
+
+  /* If non-NULL, the beginning of a read-only memory mapping which items
+     points within, to be unmapped at finalization; see izmir-cache.c . */
+  void *mapping;
+
+  /* The size of the mapping in bytes, when mapping is non-NULL. */
+  size_t mapping_size;
+};
+
+
+
+
+/* Recording code.
+ * ************************************************************************** */
+
+/* Initialize the pointed recorded code to be empty. */
+void
+izmir_code_initialize (struct izmir_code *c);
+
+/* Release the resources of the pointed recorded code, which must not be used
+   again unless re-initialized. */
+void
+izmir_code_finalize (struct izmir_code *c);
+
+/* Append the beginning of an instruction with the given meta-instruction
+   identifier to the pointed code.  It is usually more convenient to use
+   IZMIR_CODE_APPEND_INSTRUCTION . */
+void
+izmir_code_append_instruction (struct izmir_code *c,
+                               enum izmirvm_meta_instruction_id id);
+
+/* Append the beginning of the instruction with the given mangled name to the
+   pointed code.  This is the analogous of IZMIRVM_ROUTINE_APPEND_INSTRUCTION ,
+   and checks at compile time that the instruction exists. */
+#define IZMIR_CODE_APPEND_INSTRUCTION(c, instruction_mangled_name)         \
+  izmir_code_append_instruction                                           \
+     ((c), izmirvm_meta_instruction_id_ ## instruction_mangled_name)
+
+/* Append a literal argument, a register argument (for the r class) or a label
+   argument for the current instruction to the pointed code. */
+void
+izmir_code_append_literal_parameter (struct izmir_code *c, jitter_int value);
+void
+izmir_code_append_register_parameter (struct izmir_code *c,
+                                      jitter_int register_index);
+void
+izmir_code_append_label_parameter (struct izmir_code *c, izmir_code_label l);
+
+/* Set the source line of the instructions appended next to the pointed code.
+   Nothing is recorded if the line does not change. */
+void
+izmir_code_append_line (struct izmir_code *c, int line);
+
+/* Return a fresh label for the pointed code, not yet defined. */
+izmir_code_label
+izmir_code_fresh_label (struct izmir_code *c);
+
+/* Define the given label at the current point of the pointed code. */
+void
+izmir_code_append_label (struct izmir_code *c, izmir_code_label l);
+
+/* Append every item of the pointed code other to the pointed code c .  Labels
+   of other less than shared_label_no are labels of c , and are kept; the
+   others become fresh labels of c , allocated in order.  Line items are
+   appended with izmir_code_append_line .  This joins pieces of a program
+   recorded separately, each starting with shared_label_no as its
+   label_no . */
+void
+izmir_code_append_code (struct izmir_code *c, const struct izmir_code *other,
+                        izmir_code_label shared_label_no);
+
+
+
+
+/* Replaying code.
+ * ************************************************************************** */
+
+/* The source lines of the unspecialized instructions in a VM routine. */
+struct izmir_code_lines
+{
+  /* The source line of each instruction, in routine order, or zero where
+     unknown.  The array is malloc-allocated. */
+  int *lines;
+
+  /* The number of used elements in lines . */
+  size_t line_no;
+
+  /* The number of allocated elements in lines . */
+  size_t line_allocated_no;
+};
+
+/* Append the pointed recorded code to the pointed VM routine.  If lines is not
+   NULL initialize the pointed structure with the source line of each
+   instruction in the routine, after rewriting; a superinstruction gets the
+   line of the last instruction it replaces. */
+void
+izmir_code_to_routine (const struct izmir_code *c, izmirvm_routine r,
+                       struct izmir_code_lines *lines);
+
+/* Release the resources of the pointed source line table. */
+void
+izmir_code_lines_finalize (struct izmir_code_lines *lines);
+
+
+#endif // #ifndef IZMIR_CODE_H_
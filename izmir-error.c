@@ -0,0 +1,75 @@
+/* Izmir language: errors which a caller may recover from.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-error.h"
+
+
+/* Recovery points.
+ * ************************************************************************** */
+
+/* The innermost recovery point of the current thread, or NULL. */
+static __thread struct izmir_recovery *izmir_innermost_recovery = NULL;
+
+void
+izmir_recovery_push (struct izmir_recovery *r)
+{
+  r->previous = izmir_innermost_recovery;
+  izmir_innermost_recovery = r;
+}
+
+void
+izmir_recovery_pop (struct izmir_recovery *r)
+{
+  if (izmir_innermost_recovery != r)
+    jitter_fatal ("popping a recovery point out of order");
+  izmir_innermost_recovery = r->previous;
+}
+
+
+
+
+/* Failure.
+ * ************************************************************************** */
+
+void
+izmir_fail (const char *format, ...)
+{
+  struct izmir_recovery *r = izmir_innermost_recovery;
+  char local_message [IZMIR_ERROR_MAX_MESSAGE_SIZE];
+  char *message = (r != NULL) ? r->message : local_message;
+  va_list ap;
+  va_start (ap, format);
+  vsnprintf (message, IZMIR_ERROR_MAX_MESSAGE_SIZE, format, ap);
+  va_end (ap);
+
+  if (r == NULL)
+    jitter_fatal ("%s", message);
+  izmir_innermost_recovery = r->previous;
+  longjmp (r->jump, 1);
+}
@@ -0,0 +1,107 @@
+/* Izmir language: errors which a caller may recover from.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_ERROR_H_
+#define IZMIR_ERROR_H_
+
+#include <setjmp.h>
+
+
+/* About errors.
+ * ************************************************************************** */
+
+/* Errors in a user program or in its input, such as a syntax error, an
+   undefined variable, a division by zero or a malformed input integer, are
+   reported with izmir_fail .  By default izmir_fail is fatal, exactly like
+   jitter_fatal ; but a caller which wants to survive such errors, like the
+   server, may set a recovery point first, and izmir_fail then jumps back to it
+   with the error message.
+
+   Recovery points are per thread, and nest: a function holding resources
+   which would otherwise leak can set its own recovery point, release the
+   resources and fail again with the same message.  Errors which mean that
+   izmir itself is broken, rather than the user program, are still reported
+   with jitter_fatal . */
+
+/* The size of the longest error message kept in a recovery point, including
+   the final '\0'; longer messages are truncated. */
+#define IZMIR_ERROR_MAX_MESSAGE_SIZE  512
+
+
+
+
+/* Recovery points.
+ * ************************************************************************** */
+
+/* A recovery point. */
+struct izmir_recovery
+{
+  /* Where to jump back to, as set with setjmp by the owner. */
+  jmp_buf jump;
+
+  /* The enclosing recovery point of the same thread, or NULL. */
+  struct izmir_recovery *previous;
+
+  /* The error message, set right before jumping back. */
+  char message [IZMIR_ERROR_MAX_MESSAGE_SIZE];
+};
+
+/* Make the pointed recovery point, whose jump buffer was just set with setjmp
+   returning zero, the innermost one of the calling thread.  The usual pattern
+   is:
+     struct izmir_recovery r;
+     if (setjmp (r.jump) == 0)
+       {
+         izmir_recovery_push (& r);
+         ...
+         izmir_recovery_pop (& r);
+       }
+     else
+       ... the error message is r.message ...
+   Local variables modified after setjmp must be volatile to be read after an
+   error. */
+void
+izmir_recovery_push (struct izmir_recovery *r);
+
+/* Make the pointed recovery point, which must be the innermost one of the
+   calling thread, no longer active.  There is no need to call this after an
+   error, since jumping back already does. */
+void
+izmir_recovery_pop (struct izmir_recovery *r);
+
+
+
+
+/* Failure.
+ * ************************************************************************** */
+
+/* Report an error in the user program or in its input, with a message formatted
+   like by printf .  Jump back to the innermost recovery point of the calling
+   thread if there is one, or otherwise fail fatally. */
+void
+izmir_fail (const char *format, ...)
+  __attribute__ ((noreturn, format (printf, 1, 2)));
+
+
+#endif // #ifndef IZMIR_ERROR_H_
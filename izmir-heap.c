@@ -0,0 +1,343 @@
+/* Izmir language: the garbage-collected heap of VM states.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-heap.h"
+
+
+/* Tuning.
+ * ************************************************************************** */
+
+/* The number of handles added to the handle table when it has no free ones
+   left, at the least; the table at least doubles otherwise. */
+#define IZMIR_HEAP_MINIMUM_HANDLE_GROWTH  1024
+
+
+
+
+/* Handles.
+ * ************************************************************************** */
+
+/* Make the handle with the given index free. */
+static void
+izmir_heap_release_handle (struct izmir_heap *h, jitter_uint index)
+{
+  h->objects [index] = NULL;
+  h->free_handles [h->free_handle_no ++] = index;
+}
+
+/* Grow the handle table of the pointed heap, which has no free handles. */
+static void
+izmir_heap_grow_handles (struct izmir_heap *h)
+{
+  size_t old_handle_no = h->handle_no;
+  size_t growth = old_handle_no;
+  if (growth < IZMIR_HEAP_MINIMUM_HANDLE_GROWTH)
+    growth = IZMIR_HEAP_MINIMUM_HANDLE_GROWTH;
+  h->handle_no += growth;
+  h->objects = jitter_xrealloc (h->objects,
+                                h->handle_no
+                                * sizeof (struct izmir_heap_object *));
+  h->free_handles = jitter_xrealloc (h->free_handles,
+                                     h->handle_no * sizeof (jitter_uint));
+
+  /* Push the new handles so that the lowest index is popped first. */
+  size_t i;
+  for (i = h->handle_no; i > old_handle_no; i --)
+    izmir_heap_release_handle (h, i - 1);
+}
+
+
+
+
+/* Collection.
+ * ************************************************************************** */
+
+/* Push the pointed object on the mark stack of the pointed heap. */
+static void
+izmir_heap_push_mark (struct izmir_heap *h, struct izmir_heap_object *o)
+{
+  if (h->mark_stack_no == h->mark_stack_allocated_no)
+    {
+      h->mark_stack_allocated_no = 2 * h->mark_stack_allocated_no + 256;
+      h->mark_stack = jitter_xrealloc (h->mark_stack,
+                                       h->mark_stack_allocated_no
+                                       * sizeof (struct izmir_heap_object *));
+    }
+  h->mark_stack [h->mark_stack_no ++] = o;
+}
+
+/* Mark the object the given value refers to, if any, as reachable, and push
+   it on the mark stack unless it was marked already; only mark nursery
+   objects if nursery_only is non-false. */
+static void
+izmir_heap_mark_value (struct izmir_heap *h, jitter_int value,
+                       bool nursery_only)
+{
+  struct izmir_heap_object *o = izmir_heap_dereference (h, value);
+  if (o != NULL
+      && ! (o->flags & IZMIR_HEAP_FLAG_MARKED)
+      && (! nursery_only || izmir_heap_in_nursery (h, o)))
+    {
+      o->flags |= IZMIR_HEAP_FLAG_MARKED;
+      izmir_heap_push_mark (h, o);
+    }
+}
+
+/* Mark the objects referred to by the given words, as izmir_heap_mark_value
+   does. */
+static void
+izmir_heap_mark_words (struct izmir_heap *h, const jitter_int *words,
+                       size_t word_no, bool nursery_only)
+{
+  size_t i;
+  for (i = 0; i < word_no; i ++)
+    izmir_heap_mark_value (h, words [i], nursery_only);
+}
+
+/* Mark every object reachable from the roots, see izmir_heap_allocate_slow ,
+   and in a minor collection from the remembered set; only mark nursery
+   objects if nursery_only is non-false. */
+static void
+izmir_heap_mark (struct izmir_heap *h, const char *stack_height,
+                 jitter_int top, bool nursery_only)
+{
+  if (h->stack_bottom == NULL)
+    jitter_fatal ("heap allocation before heap-set-stack-bottom");
+
+  /* The main stack grows towards higher addresses, and the height points to
+     the element under the top, which is kept apart. */
+  const jitter_int *bottom = (const jitter_int *) h->stack_bottom;
+  const jitter_int *height = (const jitter_int *) stack_height;
+  if (height > bottom)
+    izmir_heap_mark_words (h, bottom + 1, height - bottom, nursery_only);
+  izmir_heap_mark_value (h, top, nursery_only);
+
+  size_t i;
+  if (nursery_only)
+    for (i = 0; i < h->remembered_no; i ++)
+      izmir_heap_mark_words (h, izmir_heap_payload (h->remembered [i]),
+                             h->remembered [i]->size / sizeof (jitter_int),
+                             true);
+
+  /* Scan the payloads of marked objects until no new object is found. */
+  while (h->mark_stack_no > 0)
+    {
+      struct izmir_heap_object *o = h->mark_stack [-- h->mark_stack_no];
+      izmir_heap_mark_words (h, izmir_heap_payload (o),
+                             o->size / sizeof (jitter_int), nursery_only);
+    }
+}
+
+/* Copy every reachable nursery object to the old generation, release the
+   handles of the others and empty the nursery. */
+static void
+izmir_heap_collect_minor (struct izmir_heap *h, const char *stack_height,
+                          jitter_int top)
+{
+  izmir_heap_mark (h, stack_height, top, true);
+
+  /* Objects are laid out one after the other, so the nursery can be walked
+     linearly. */
+  char *p = h->nursery;
+  while (p < h->next)
+    {
+      struct izmir_heap_object *o = (struct izmir_heap_object *) p;
+      size_t total_size = IZMIR_HEAP_OBJECT_TOTAL_SIZE (o->size);
+      if (o->flags & IZMIR_HEAP_FLAG_MARKED)
+        {
+          struct izmir_heap_object *copy = jitter_xmalloc (total_size);
+          memcpy (copy, o, total_size);
+          copy->flags = 0;
+          h->objects [o->handle_index] = copy;
+          h->old_size += total_size;
+        }
+      else
+        izmir_heap_release_handle (h, o->handle_index);
+      p += total_size;
+    }
+
+  /* Every reachable nursery object is now old, so no old object refers to the
+     nursery any longer. */
+  size_t i;
+  for (i = 0; i < h->remembered_no; i ++)
+    h->remembered [i]->flags &= ~ (jitter_uint) IZMIR_HEAP_FLAG_REMEMBERED;
+  h->remembered_no = 0;
+
+  /* Keep the invariant that the free part of the nursery is zeroed. */
+  memset (h->nursery, 0, h->next - h->nursery);
+  h->next = h->nursery;
+  h->minor_collection_no ++;
+}
+
+/* Free every unreachable old object and release its handle.  The nursery
+   and the remembered set must be empty. */
+static void
+izmir_heap_collect_major (struct izmir_heap *h, const char *stack_height,
+                          jitter_int top)
+{
+  izmir_heap_mark (h, stack_height, top, false);
+
+  size_t i;
+  for (i = 0; i < h->handle_no; i ++)
+    {
+      struct izmir_heap_object *o = h->objects [i];
+      if (o == NULL)
+        continue;
+      else if (o->flags & IZMIR_HEAP_FLAG_MARKED)
+        o->flags &= ~ (jitter_uint) IZMIR_HEAP_FLAG_MARKED;
+      else
+        {
+          h->old_size -= IZMIR_HEAP_OBJECT_TOTAL_SIZE (o->size);
+          free (o);
+          izmir_heap_release_handle (h, i);
+        }
+    }
+
+  h->major_threshold = 2 * h->old_size;
+  if (h->major_threshold < IZMIR_HEAP_MINIMUM_MAJOR_THRESHOLD)
+    h->major_threshold = IZMIR_HEAP_MINIMUM_MAJOR_THRESHOLD;
+  h->major_collection_no ++;
+}
+
+/* Collect the nursery, and the old generation as well if it grew past its
+   threshold, or would with an additional object of the given total size. */
+static void
+izmir_heap_collect (struct izmir_heap *h, size_t additional_size,
+                    const char *stack_height, jitter_int top)
+{
+  izmir_heap_collect_minor (h, stack_height, top);
+  if (h->old_size + additional_size > h->major_threshold)
+    izmir_heap_collect_major (h, stack_height, top);
+}
+
+
+
+
+/* Heap operations.
+ * ************************************************************************** */
+
+void
+izmir_heap_initialize (struct izmir_heap *h)
+{
+  h->nursery = NULL;
+  h->next = NULL;
+  h->limit = NULL;
+  h->objects = NULL;
+  h->handle_no = 0;
+  h->free_handles = NULL;
+  h->free_handle_no = 0;
+  h->remembered = NULL;
+  h->remembered_no = 0;
+  h->remembered_allocated_no = 0;
+  h->mark_stack = NULL;
+  h->mark_stack_no = 0;
+  h->mark_stack_allocated_no = 0;
+  h->old_size = 0;
+  h->major_threshold = IZMIR_HEAP_MINIMUM_MAJOR_THRESHOLD;
+  h->stack_bottom = NULL;
+  h->minor_collection_no = 0;
+  h->major_collection_no = 0;
+}
+
+void
+izmir_heap_finalize (struct izmir_heap *h)
+{
+  size_t i;
+  for (i = 0; i < h->handle_no; i ++)
+    if (h->objects [i] != NULL && ! izmir_heap_in_nursery (h, h->objects [i]))
+      free (h->objects [i]);
+  free (h->objects);
+  free (h->free_handles);
+  free (h->remembered);
+  free (h->mark_stack);
+  free (h->nursery);
+}
+
+void
+izmir_heap_remember (struct izmir_heap *h, struct izmir_heap_object *o)
+{
+  if (izmir_heap_in_nursery (h, o) || (o->flags & IZMIR_HEAP_FLAG_REMEMBERED))
+    return;
+  if (h->remembered_no == h->remembered_allocated_no)
+    {
+      h->remembered_allocated_no = 2 * h->remembered_allocated_no + 64;
+      h->remembered = jitter_xrealloc (h->remembered,
+                                       h->remembered_allocated_no
+                                       * sizeof (struct izmir_heap_object *));
+    }
+  h->remembered [h->remembered_no ++] = o;
+  o->flags |= IZMIR_HEAP_FLAG_REMEMBERED;
+}
+
+jitter_int
+izmir_heap_allocate_slow (struct izmir_heap *h, size_t size,
+                          const char *stack_height, jitter_int top)
+{
+  size_t total_size = IZMIR_HEAP_OBJECT_TOTAL_SIZE (size);
+  struct izmir_heap_object *o;
+  if (h->nursery == NULL)
+    {
+      h->nursery = jitter_xmalloc (IZMIR_HEAP_NURSERY_SIZE);
+      memset (h->nursery, 0, IZMIR_HEAP_NURSERY_SIZE);
+      h->next = h->nursery;
+      h->limit = h->nursery + IZMIR_HEAP_NURSERY_SIZE;
+    }
+  if (size > IZMIR_HEAP_LARGE_OBJECT_SIZE)
+    {
+      /* Large objects are the ones a program may ask for too much memory
+         with: let the caller fail, rather than failing fatally. */
+      if (size > (size_t) -1 / 2)
+        return 0;
+      if (h->old_size + total_size > h->major_threshold)
+        izmir_heap_collect (h, total_size, stack_height, top);
+      o = calloc (1, total_size);
+      if (o == NULL)
+        return 0;
+      h->old_size += total_size;
+    }
+  else
+    {
+      if ((size_t) (h->limit - h->next) < total_size)
+        izmir_heap_collect (h, 0, stack_height, top);
+      o = (struct izmir_heap_object *) h->next;
+      h->next += total_size;
+    }
+
+  /* Collecting may have released handles, so only grow the table now. */
+  if (h->free_handle_no == 0)
+    izmir_heap_grow_handles (h);
+  jitter_uint index = h->free_handles [-- h->free_handle_no];
+  o->handle_index = index;
+  o->size = size;
+  o->flags = 0;
+  h->objects [index] = o;
+  return IZMIR_HEAP_REFERENCE_BIAS + index;
+}
@@ -0,0 +1,260 @@
+/* Izmir language: the garbage-collected heap of VM states.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_HEAP_H_
+#define IZMIR_HEAP_H_
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <jitter/jitter.h>
+
+
+/* About the heap.
+ * ************************************************************************** */
+
+/* Every izmirvm state owns a heap of objects, each holding a payload of
+   integers.  The heap has two generations:
+   - new objects are allocated in the nursery, a fixed-size region, by bumping
+     a pointer, which is inline and costs a few instructions;
+   - when the nursery is full a minor collection copies the objects still
+     reachable into the old generation, where each object is allocated
+     separately, and empties the nursery;
+   - when the old generation has grown enough since the last time, a major
+     collection marks the reachable old objects and sweeps away the others.
+   Objects too large for the nursery go straight to the old generation.
+
+   VM values are untagged integers, so a collector cannot tell a reference
+   from a number which happens to look like one.  Objects are therefore
+   reached through handles: a reference is the index of a handle plus a large
+   bias, and the handle table holds the current address of each object.  The
+   collectors treat every word which looks like a reference as one, which at
+   worst keeps some garbage alive, but only ever update the handle table, so
+   that moving an object never changes a value the program can see.
+
+   The roots are the main stack elements pushed since the heap-set-stack-bottom
+   instruction ran, at the beginning of the routine, along with the top of the
+   stack.  Code generators must save any register holding a reference on the
+   main stack before allocating, as they already do before calls.  Payloads are
+   scanned like roots, so that a reference stored into an object keeps the
+   object it refers to alive.  A minor collection does not scan the whole old
+   generation, but only the old objects which may refer to nursery objects: the
+   write barrier remembers every old object into which something looking like
+   a reference is stored. */
+
+/* The size of the nursery, in bytes. */
+#define IZMIR_HEAP_NURSERY_SIZE  (1024 * 1024)
+
+/* Objects whose payload is larger than this many bytes are allocated in the
+   old generation directly. */
+#define IZMIR_HEAP_LARGE_OBJECT_SIZE  (IZMIR_HEAP_NURSERY_SIZE / 16)
+
+/* The smallest size of the old generation, in bytes, which triggers a major
+   collection.  After each major collection the threshold becomes twice the
+   size of the surviving objects, if larger, so that the time spent marking
+   and sweeping stays proportional to allocation. */
+#define IZMIR_HEAP_MINIMUM_MAJOR_THRESHOLD  (4 * 1024 * 1024)
+
+/* The reference to the handle with index 0.  References are handle indices
+   plus this bias, so that small integers never look like references. */
+#define IZMIR_HEAP_REFERENCE_BIAS                                 \
+  ((jitter_uint) 1 << (sizeof (jitter_int) * CHAR_BIT - 2))
+
+
+
+
+/* Heap data structures.
+ * ************************************************************************** */
+
+/* The header of a heap object, immediately followed by its payload. */
+struct izmir_heap_object
+{
+  /* The index of the handle referring to this object. */
+  jitter_uint handle_index;
+
+  /* The size of the payload, in bytes. */
+  jitter_uint size;
+
+  /* A bitwise or of the IZMIR_HEAP_FLAG_ constants below. */
+  jitter_uint flags;
+};
+
+/* The flag set on the objects which the current collection found
+   reachable. */
+#define IZMIR_HEAP_FLAG_MARKED      1
+
+/* The flag set on the old objects in the remembered set of their heap. */
+#define IZMIR_HEAP_FLAG_REMEMBERED  2
+
+/* The total size of an object with the given payload size, in bytes, rounded
+   up so that the next object is aligned like a jitter_int . */
+#define IZMIR_HEAP_OBJECT_TOTAL_SIZE(payload_size)                      \
+  ((sizeof (struct izmir_heap_object) + (payload_size)                  \
+    + sizeof (jitter_int) - 1)                                          \
+   & ~ (size_t) (sizeof (jitter_int) - 1))
+
+/* A heap. */
+struct izmir_heap
+{
+  /* The malloc-allocated nursery, or NULL before the first allocation; the
+     first free byte in it; and the byte past its end.  The free part is
+     always zeroed, so that new objects start out as zeros. */
+  char *nursery;
+  char *next;
+  char *limit;
+
+  /* A malloc-allocated array holding the object referred to by each handle,
+     or NULL for free handles, and its number of elements. */
+  struct izmir_heap_object **objects;
+  size_t handle_no;
+
+  /* A malloc-allocated stack of the indices of free handles, with room for
+     handle_no elements, and the number of its used elements. */
+  jitter_uint *free_handles;
+  size_t free_handle_no;
+
+  /* The total size of the objects in the old generation, and the size beyond
+     which the next major collection happens, in bytes. */
+  size_t old_size;
+  size_t major_threshold;
+
+  /* A malloc-allocated array of the old objects into which a reference may
+     have been stored since the last minor collection, its number of used
+     elements and its number of allocated elements. */
+  struct izmir_heap_object **remembered;
+  size_t remembered_no;
+  size_t remembered_allocated_no;
+
+  /* The malloc-allocated stack of marked objects whose payload is still to be
+     scanned, its number of used elements and its number of allocated
+     elements.  It is only used within collections. */
+  struct izmir_heap_object **mark_stack;
+  size_t mark_stack_no;
+  size_t mark_stack_allocated_no;
+
+  /* The main stack height at the beginning of the running routine, or NULL
+     if it was not set. */
+  const char *stack_bottom;
+
+  /* The number of minor and major collections so far. */
+  size_t minor_collection_no;
+  size_t major_collection_no;
+};
+
+
+
+
+/* Heap operations.
+ * ************************************************************************** */
+
+/* Initialize the pointed heap to be empty.  No memory is allocated until the
+   first object is. */
+void
+izmir_heap_initialize (struct izmir_heap *h);
+
+/* Release every object of the pointed heap, and the heap itself. */
+void
+izmir_heap_finalize (struct izmir_heap *h);
+
+/* Allocate an object with the given payload size in bytes in the pointed
+   heap, collecting garbage first if needed, and return a reference to it.  The
+   roots are the main stack elements from the stack bottom of the heap
+   exclusive to the given stack height inclusive, and the given top of the
+   stack.  If there is no memory for an object too large for the nursery
+   return 0, which is never a reference, and leave failing to the caller.
+   This is the out-of-line part of izmir_heap_allocate . */
+jitter_int
+izmir_heap_allocate_slow (struct izmir_heap *h, size_t size,
+                          const char *stack_height, jitter_int top);
+
+/* Like izmir_heap_allocate_slow , but bump the nursery pointer inline when
+   the object fits. */
+static inline jitter_int
+izmir_heap_allocate (struct izmir_heap *h, size_t size,
+                     const char *stack_height, jitter_int top)
+{
+  size_t total_size = IZMIR_HEAP_OBJECT_TOTAL_SIZE (size);
+  if (__builtin_expect (size <= IZMIR_HEAP_LARGE_OBJECT_SIZE
+                        && (size_t) (h->limit - h->next) >= total_size
+                        && h->free_handle_no > 0, true))
+    {
+      struct izmir_heap_object *o = (struct izmir_heap_object *) h->next;
+      h->next += total_size;
+      jitter_uint index = h->free_handles [-- h->free_handle_no];
+      o->handle_index = index;
+      o->size = size;
+      h->objects [index] = o;
+      return IZMIR_HEAP_REFERENCE_BIAS + index;
+    }
+  return izmir_heap_allocate_slow (h, size, stack_height, top);
+}
+
+/* Return the object the given value refers to in the pointed heap, or NULL
+   if the value is not a reference to a live object. */
+static inline struct izmir_heap_object *
+izmir_heap_dereference (const struct izmir_heap *h, jitter_int value)
+{
+  jitter_uint index = (jitter_uint) value - IZMIR_HEAP_REFERENCE_BIAS;
+  return (index < h->handle_no) ? h->objects [index] : NULL;
+}
+
+/* Return non-false iff the pointed object is in the nursery of the pointed
+   heap. */
+static inline bool
+izmir_heap_in_nursery (const struct izmir_heap *h,
+                       const struct izmir_heap_object *o)
+{
+  return ((const char *) o >= h->nursery
+          && (const char *) o < h->nursery + IZMIR_HEAP_NURSERY_SIZE);
+}
+
+/* Add the pointed object, if old, to the remembered set of the pointed heap,
+   unless it is there already.  This must be called after storing anything
+   which may be a reference into the object, except when the write barrier
+   below has been called. */
+void
+izmir_heap_remember (struct izmir_heap *h, struct izmir_heap_object *o);
+
+/* Record that the given value was just stored into the pointed object.  This
+   is the write barrier, and the common case of a value which cannot be a
+   reference costs a subtraction and a comparison. */
+static inline void
+izmir_heap_write_barrier (struct izmir_heap *h, struct izmir_heap_object *o,
+                          jitter_int value)
+{
+  if (__builtin_expect ((jitter_uint) value - IZMIR_HEAP_REFERENCE_BIAS
+                        < h->handle_no, false))
+    izmir_heap_remember (h, o);
+}
+
+/* Return a pointer to the payload of the pointed object. */
+static inline jitter_int *
+izmir_heap_payload (struct izmir_heap_object *o)
+{
+  return (jitter_int *) (o + 1);
+}
+
+
+#endif // #ifndef IZMIR_HEAP_H_
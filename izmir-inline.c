@@ -0,0 +1,1207 @@
+/* Izmir language: call-site inlining of small procedures.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-inline.h"
+#include "izmir-resolve.h"
+
+
+/* Inliner state.
+ * ************************************************************************** */
+
+/* The maximum number of inlined bodies nested within one another at any point
+   of the rewritten program. */
+#define IZMIR_INLINE_MAX_DEPTH  4
+
+/* The maximum size of the rewritten program, in multiples of its original
+   size; see izmir_inline_program . */
+#define IZMIR_INLINE_MAX_GROWTH  2
+
+/* The state of inlining over a whole program. */
+struct izmir_inliner
+{
+  /* The program being rewritten. */
+  struct izmir_program *program;
+
+  /* The maximum size of an inlined body, in AST nodes. */
+  size_t budget;
+
+  /* The body of each procedure as it was before inlining, which inlined
+     copies are made from, and its size in AST nodes.  These arrays are
+     malloc-allocated, and indexed like the procedures. */
+  struct izmir_statement **bodies;
+  size_t *body_sizes;
+
+  /* For each procedure, non-false iff its body is being rewritten or copied
+     at the current point.  This array is malloc-allocated, and indexed like
+     the procedures. */
+  bool *expanding;
+
+  /* The number of inlined bodies being copied at the current point. */
+  size_t depth;
+
+  /* The size of the program in AST nodes, counting every body inlined so far
+     at its original size, and the size no inlining may take it past. */
+  size_t size;
+  size_t size_limit;
+
+  /* The number of fresh variables made so far. */
+  unsigned long fresh_variable_no;
+
+  /* Non-false iff at least one call was inlined. */
+  bool inlined;
+};
+
+/* Return non-false iff a call to the procedure with the given index may be
+   inlined at the current point. */
+static bool
+izmir_inliner_can_inline (const struct izmir_inliner *inl,
+                          size_t procedure_index)
+{
+  return (inl->body_sizes [procedure_index] <= inl->budget
+          && ! inl->expanding [procedure_index]
+          && inl->depth < IZMIR_INLINE_MAX_DEPTH
+          && (inl->size + inl->body_sizes [procedure_index]
+              <= inl->size_limit));
+}
+
+/* Return a fresh variable for a copy of the given variable of the procedure
+   with the given name.  Identifiers never contain a dollar sign, so the fresh
+   variable cannot clash with any variable of the program. */
+static izmir_variable
+izmir_inliner_fresh_variable (struct izmir_inliner *inl,
+                              const char *procedure_name,
+                              const char *variable)
+{
+  size_t size = strlen (procedure_name) + strlen (variable) + 32;
+  char *name = jitter_xmalloc (size);
+  snprintf (name, size, "%s$%s$%lu", procedure_name, variable,
+            ++ inl->fresh_variable_no);
+  izmir_variable res = izmir_program_intern (inl->program, name);
+  free (name);
+  return res;
+}
+
+
+
+
+/* AST sizes and properties.
+ * ************************************************************************** */
+
+/* Return the number of nodes in the pointed expression. */
+static size_t
+izmir_expression_size (const struct izmir_expression *e)
+{
+  size_t i, res = 1;
+  switch (e->case_)
+    {
+    case izmir_expression_case_if_then_else:
+      res += (izmir_expression_size (e->if_then_else_condition)
+              + izmir_expression_size (e->if_then_else_then_branch)
+              + izmir_expression_size (e->if_then_else_else_branch));
+      break;
+    case izmir_expression_case_primitive:
+      if (e->primitive_operand_0 != NULL)
+        res += izmir_expression_size (e->primitive_operand_0);
+      if (e->primitive_operand_1 != NULL)
+        res += izmir_expression_size (e->primitive_operand_1);
+      break;
+    case izmir_expression_case_call:
+      for (i = 0; i < e->actual_no; i ++)
+        res += izmir_expression_size (e->actuals [i]);
+      break;
+    default:
+      break;
+    }
+  return res;
+}
+
+/* Return the number of nodes in the pointed statement, not counting
+   sequences, which generate no code of their own. */
+static size_t
+izmir_statement_size (const struct izmir_statement *st)
+{
+  size_t i, res = 1;
+  switch (st->case_)
+    {
+    case izmir_statement_case_block:
+      {
+        /* Walk the chain with a loop: see izmir_block_inner_block . */
+        size_t prefix_no;
+        const struct izmir_statement *inner;
+        while ((inner = izmir_block_inner_block (st, & prefix_no)) != NULL)
+          {
+            for (i = 0; i < prefix_no; i ++)
+              res += izmir_statement_size
+                        (st->block_body->sequence_statements [i]);
+            res ++;
+            st = inner;
+          }
+        res += izmir_statement_size (st->block_body);
+        break;
+      }
+    case izmir_statement_case_assignment:
+      res += izmir_expression_size (st->assignment_expression);
+      break;
+    case izmir_statement_case_print:
+      res += izmir_expression_size (st->print_expression);
+      break;
+    case izmir_statement_case_sequence:
+      res = 0;
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        res += izmir_statement_size (st->sequence_statements [i]);
+      break;
+    case izmir_statement_case_if_then_else:
+      res += (izmir_expression_size (st->if_then_else_condition)
+              + izmir_statement_size (st->if_then_else_then_branch)
+              + izmir_statement_size (st->if_then_else_else_branch));
+      break;
+    case izmir_statement_case_repeat_until:
+      res += (izmir_statement_size (st->repeat_until_body)
+              + izmir_expression_size (st->repeat_until_guard));
+      break;
+    case izmir_statement_case_return:
+      res += izmir_expression_size (st->return_result);
+      break;
+    case izmir_statement_case_call:
+      for (i = 0; i < st->actual_no; i ++)
+        res += izmir_expression_size (st->actuals [i]);
+      break;
+    case izmir_statement_case_element_assignment:
+      res += (izmir_expression_size (st->element_array)
+              + izmir_expression_size (st->element_index)
+              + izmir_expression_size (st->element_value));
+      break;
+    case izmir_statement_case_bulk:
+      for (i = 0; i < st->bulk_operand_no; i ++)
+        res += izmir_expression_size (st->bulk_operands [i]);
+      break;
+    default:
+      break;
+    }
+  return res;
+}
+
+/* Return non-false iff the pointed statement may assign the given variable,
+   or use it as the array of an element assignment when elements is
+   non-false. */
+static bool
+izmir_statement_modifies (const struct izmir_statement *st,
+                          izmir_variable v, bool elements)
+{
+  size_t i;
+  switch (st->case_)
+    {
+    case izmir_statement_case_block:
+      {
+        /* Walk the chain with a loop: see izmir_block_inner_block . */
+        size_t prefix_no;
+        const struct izmir_statement *inner;
+        while ((inner = izmir_block_inner_block (st, & prefix_no)) != NULL)
+          {
+            for (i = 0; i < prefix_no; i ++)
+              if (izmir_statement_modifies
+                     (st->block_body->sequence_statements [i], v, elements))
+                return true;
+            st = inner;
+          }
+        return izmir_statement_modifies (st->block_body, v, elements);
+      }
+    case izmir_statement_case_assignment:
+      return st->assignment_variable == v;
+    case izmir_statement_case_sequence:
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        if (izmir_statement_modifies (st->sequence_statements [i], v,
+                                      elements))
+          return true;
+      return false;
+    case izmir_statement_case_if_then_else:
+      return (izmir_statement_modifies (st->if_then_else_then_branch, v,
+                                        elements)
+              || izmir_statement_modifies (st->if_then_else_else_branch, v,
+                                           elements));
+    case izmir_statement_case_repeat_until:
+      return izmir_statement_modifies (st->repeat_until_body, v, elements);
+    case izmir_statement_case_element_assignment:
+      return elements && st->element_array->variable == v;
+    default:
+      return false;
+    }
+}
+
+/* Return non-false iff every execution of the pointed statement ends with a
+   return, so that control never reaches its end. */
+static bool
+izmir_statement_always_returns (const struct izmir_statement *st)
+{
+  size_t i;
+  switch (st->case_)
+    {
+    case izmir_statement_case_return:
+      return true;
+    case izmir_statement_case_block:
+      {
+        /* Walk the chain with a loop: see izmir_block_inner_block . */
+        size_t prefix_no;
+        const struct izmir_statement *inner;
+        while ((inner = izmir_block_inner_block (st, & prefix_no)) != NULL)
+          {
+            for (i = 0; i < prefix_no; i ++)
+              if (izmir_statement_always_returns
+                     (st->block_body->sequence_statements [i]))
+                return true;
+            st = inner;
+          }
+        return izmir_statement_always_returns (st->block_body);
+      }
+    case izmir_statement_case_sequence:
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        if (izmir_statement_always_returns (st->sequence_statements [i]))
+          return true;
+      return false;
+    case izmir_statement_case_if_then_else:
+      return (izmir_statement_always_returns (st->if_then_else_then_branch)
+              && izmir_statement_always_returns
+                    (st->if_then_else_else_branch));
+    case izmir_statement_case_repeat_until:
+      return izmir_statement_always_returns (st->repeat_until_body);
+    default:
+      return false;
+    }
+}
+
+
+
+
+/* AST construction.
+ * ************************************************************************** */
+
+/* Return a fresh expression with the given case in the program arena, with
+   its fields uninitialized. */
+static struct izmir_expression *
+izmir_inliner_make_expression (struct izmir_inliner *inl,
+                               enum izmir_expression_case case_)
+{
+  struct izmir_expression *res
+    = izmir_program_allocate (inl->program, sizeof (struct izmir_expression));
+  res->case_ = case_;
+  return res;
+}
+
+/* Return a fresh expression reading the given variable. */
+static struct izmir_expression *
+izmir_inliner_make_variable (struct izmir_inliner *inl, izmir_variable v)
+{
+  struct izmir_expression *res
+    = izmir_inliner_make_expression (inl, izmir_expression_case_variable);
+  res->variable = v;
+  return res;
+}
+
+/* Return a fresh statement with the given case and line in the program
+   arena, with its fields uninitialized. */
+static struct izmir_statement *
+izmir_inliner_make_statement (struct izmir_inliner *inl,
+                              enum izmir_statement_case case_, int line)
+{
+  struct izmir_statement *res
+    = izmir_program_allocate (inl->program, sizeof (struct izmir_statement));
+  res->case_ = case_;
+  res->line = line;
+  return res;
+}
+
+/* Return a fresh assignment of the pointed expression to the given
+   variable. */
+static struct izmir_statement *
+izmir_inliner_make_assignment (struct izmir_inliner *inl, izmir_variable v,
+                               struct izmir_expression *e, int line)
+{
+  struct izmir_statement *res
+    = izmir_inliner_make_statement (inl, izmir_statement_case_assignment,
+                                    line);
+  res->assignment_variable = v;
+  res->assignment_expression = e;
+  return res;
+}
+
+/* Return a fresh block declaring the given variable around the pointed
+   body. */
+static struct izmir_statement *
+izmir_inliner_make_block (struct izmir_inliner *inl, izmir_variable v,
+                          struct izmir_statement *body, int line)
+{
+  struct izmir_statement *res
+    = izmir_inliner_make_statement (inl, izmir_statement_case_block, line);
+  res->block_variable = v;
+  res->block_body = body;
+  return res;
+}
+
+/* A statement list being built, as an array in the program arena. */
+struct izmir_statement_list
+{
+  /* The statements, in execution order. */
+  struct izmir_statement **statements;
+
+  /* The number of used elements in statements . */
+  size_t statement_no;
+
+  /* The number of allocated elements in statements . */
+  size_t allocated_no;
+};
+
+/* Initialize the pointed statement list to be empty. */
+static void
+izmir_statement_list_initialize (struct izmir_statement_list *l)
+{
+  l->statements = NULL;
+  l->statement_no = 0;
+  l->allocated_no = 0;
+}
+
+/* Add the pointed statement at the end of the pointed list, unless it is a
+   skip statement. */
+static void
+izmir_statement_list_append (struct izmir_inliner *inl,
+                             struct izmir_statement_list *l,
+                             struct izmir_statement *st)
+{
+  if (st->case_ == izmir_statement_case_skip)
+    return;
+  if (l->statement_no == l->allocated_no)
+    {
+      size_t old_allocated_no = l->allocated_no;
+      l->allocated_no = 2 * l->allocated_no + 4;
+      l->statements
+        = izmir_arena_reallocate (& inl->program->arena, l->statements,
+                                  (sizeof (struct izmir_statement *)
+                                   * old_allocated_no),
+                                  (sizeof (struct izmir_statement *)
+                                   * l->allocated_no));
+    }
+  l->statements [l->statement_no ++] = st;
+}
+
+/* Return a statement executing every statement of the pointed list in
+   order: a skip statement, the only statement or a sequence. */
+static struct izmir_statement *
+izmir_statement_list_to_statement (struct izmir_inliner *inl,
+                                   struct izmir_statement_list *l, int line)
+{
+  if (l->statement_no == 0)
+    return izmir_inliner_make_statement (inl, izmir_statement_case_skip,
+                                         line);
+  if (l->statement_no == 1)
+    return l->statements [0];
+  struct izmir_statement *res
+    = izmir_inliner_make_statement (inl, izmir_statement_case_sequence, line);
+  res->sequence_statements = l->statements;
+  res->sequence_statement_no = l->statement_no;
+  return res;
+}
+
+
+
+
+/* Copying context.
+ * ************************************************************************** */
+
+/* A variable of a procedure body being copied, and the expression which
+   replaces each of its uses in the copy.  Renamings form a linked list on the
+   C stack or in the program arena, innermost first. */
+struct izmir_renaming
+{
+  /* The variable as named in the body. */
+  izmir_variable variable;
+
+  /* The replacement: a fresh variable, or an actual which is a variable of
+     the caller or a literal. */
+  const struct izmir_expression *replacement;
+
+  /* The renaming of the enclosing variables, or NULL. */
+  const struct izmir_renaming *next;
+};
+
+/* Return the replacement of the given variable according to the pointed
+   renamings, or NULL if the variable keeps its name. */
+static const struct izmir_expression *
+izmir_renaming_lookup (const struct izmir_renaming *r, izmir_variable v)
+{
+  for (; r != NULL; r = r->next)
+    if (r->variable == v)
+      return r->replacement;
+  return NULL;
+}
+
+/* How a return statement is copied. */
+enum izmir_return_case
+  {
+    /* A return ends the program, without evaluating its result, as in the
+       main statement. */
+    izmir_return_case_exit,
+
+    /* A return returns from the procedure being rewritten. */
+    izmir_return_case_return,
+
+    /* A return sets the result of an inlined call, and leaves the inlined
+       statement. */
+    izmir_return_case_inlined
+  };
+
+/* Where the returns of a statement being copied go. */
+struct izmir_return_context
+{
+  /* What a return becomes. */
+  enum izmir_return_case case_;
+
+  /* The remaining fields are only used for inlined returns. */
+
+  /* The variable receiving the result, or NULL if the result is not used. */
+  izmir_variable result;
+
+  /* The inlined statement which returns leave, whose body is set once the
+     whole call is inlined. */
+  struct izmir_statement *inlined;
+
+  /* Non-false iff some return was made into an inlined exit. */
+  bool exited;
+
+  /* When the result is not used, a fresh variable receiving results which
+     must be computed anyway for their effects, or NULL if none is needed. */
+  izmir_variable discarded;
+};
+
+/* The context of a statement being copied. */
+struct izmir_copy
+{
+  /* The procedure whose body is being copied into a caller, or NULL when
+     rewriting a procedure or the main statement itself. */
+  const struct izmir_procedure *procedure;
+
+  /* How returns are copied. */
+  struct izmir_return_context *returns;
+};
+
+/* The calls moved out of the expressions of one statement, to be inlined
+   right before it. */
+struct izmir_hoisting
+{
+  /* Non-false iff a call met at this point in evaluation order may be moved:
+     nothing with effects was evaluated before it, except for moved calls. */
+  bool possible;
+
+  /* The statements running the moved calls, in order, each one setting its
+     fresh result variable. */
+  struct izmir_statement_list prelude;
+
+  /* The fresh result variables of the moved calls, as an array in the
+     program arena. */
+  izmir_variable *results;
+
+  /* The number of used and allocated elements in results . */
+  size_t result_no;
+  size_t result_allocated_no;
+};
+
+/* Initialize the pointed hoisting to have moved no calls.  If possible is
+   false no call may be moved. */
+static void
+izmir_hoisting_initialize (struct izmir_hoisting *h, bool possible)
+{
+  h->possible = possible;
+  izmir_statement_list_initialize (& h->prelude);
+  h->results = NULL;
+  h->result_no = 0;
+  h->result_allocated_no = 0;
+}
+
+/* Add to the pointed hoisting the pointed statement, which runs an inlined
+   call leaving its value in the given fresh variable. */
+static void
+izmir_hoisting_append (struct izmir_inliner *inl, struct izmir_hoisting *h,
+                       struct izmir_statement *st, izmir_variable result)
+{
+  if (h->result_no == h->result_allocated_no)
+    {
+      size_t old_allocated_no = h->result_allocated_no;
+      h->result_allocated_no = 2 * h->result_allocated_no + 4;
+      h->results
+        = izmir_arena_reallocate (& inl->program->arena, h->results,
+                                  sizeof (izmir_variable) * old_allocated_no,
+                                  (sizeof (izmir_variable)
+                                   * h->result_allocated_no));
+    }
+  h->results [h->result_no ++] = result;
+  izmir_statement_list_append (inl, & h->prelude, st);
+}
+
+/* Return the pointed statement within blocks declaring the result variables
+   of the pointed hoisting. */
+static struct izmir_statement *
+izmir_hoisting_declare (struct izmir_inliner *inl, struct izmir_hoisting *h,
+                        struct izmir_statement *st)
+{
+  size_t i;
+  for (i = h->result_no; i > 0; i --)
+    st = izmir_inliner_make_block (inl, h->results [i - 1], st, st->line);
+  return st;
+}
+
+/* Return a statement running the moved calls of the pointed hoisting and then
+   the pointed statement, which uses their results. */
+static struct izmir_statement *
+izmir_hoisting_wrap (struct izmir_inliner *inl, struct izmir_hoisting *h,
+                     struct izmir_statement *st)
+{
+  if (h->result_no == 0)
+    return st;
+  izmir_statement_list_append (inl, & h->prelude, st);
+  return izmir_hoisting_declare
+            (inl, h, izmir_statement_list_to_statement (inl, & h->prelude,
+                                                        st->line));
+}
+
+
+
+
+/* Copying with inlining.
+ * ************************************************************************** */
+
+static struct izmir_statement *
+izmir_inline_statement (struct izmir_inliner *inl,
+                        const struct izmir_copy *copy,
+                        const struct izmir_renaming *r,
+                        const struct izmir_statement *st, bool tail);
+
+static struct izmir_statement *
+izmir_inline_call (struct izmir_inliner *inl, size_t callee_index,
+                   struct izmir_expression **actuals,
+                   struct izmir_return_context *returns, bool tail, int line);
+
+static struct izmir_statement *
+izmir_inline_call_into (struct izmir_inliner *inl, size_t callee_index,
+                        struct izmir_expression **actuals,
+                        izmir_variable result, int line);
+
+/* Return a copy of the pointed expression, occurring at the given line, with
+   variables replaced according to the pointed renamings.  Calls are inlined
+   into the pointed hoisting as long as it permits, in evaluation order. */
+static struct izmir_expression *
+izmir_inline_expression (struct izmir_inliner *inl,
+                         const struct izmir_renaming *r,
+                         const struct izmir_expression *e,
+                         struct izmir_hoisting *h, int line)
+{
+  struct izmir_expression *res
+    = izmir_inliner_make_expression (inl, e->case_);
+  size_t i;
+  switch (e->case_)
+    {
+    case izmir_expression_case_undefined:
+      break;
+    case izmir_expression_case_literal:
+      res->literal = e->literal;
+      break;
+    case izmir_expression_case_variable:
+      {
+        const struct izmir_expression *replacement
+          = izmir_renaming_lookup (r, e->variable);
+        * res = (replacement != NULL) ? * replacement : * e;
+        break;
+      }
+    case izmir_expression_case_if_then_else:
+      {
+        /* Only the condition is evaluated unconditionally. */
+        struct izmir_hoisting no_hoisting;
+        izmir_hoisting_initialize (& no_hoisting, false);
+        res->if_then_else_condition
+          = izmir_inline_expression (inl, r, e->if_then_else_condition, h,
+                                     line);
+        res->if_then_else_then_branch
+          = izmir_inline_expression (inl, r, e->if_then_else_then_branch,
+                                     & no_hoisting, line);
+        res->if_then_else_else_branch
+          = izmir_inline_expression (inl, r, e->if_then_else_else_branch,
+                                     & no_hoisting, line);
+        break;
+      }
+    case izmir_expression_case_primitive:
+      res->primitive = e->primitive;
+      res->primitive_operand_0
+        = ((e->primitive_operand_0 != NULL)
+           ? izmir_inline_expression (inl, r, e->primitive_operand_0, h, line)
+           : NULL);
+      res->primitive_operand_1
+        = ((e->primitive_operand_1 != NULL)
+           ? izmir_inline_expression (inl, r, e->primitive_operand_1, h, line)
+           : NULL);
+      break;
+    case izmir_expression_case_call:
+      res->callee = e->callee;
+      res->callee_index = e->callee_index;
+      res->actual_no = e->actual_no;
+      res->actuals
+        = izmir_program_allocate (inl->program,
+                                  (sizeof (struct izmir_expression *)
+                                   * e->actual_no));
+      for (i = 0; i < e->actual_no; i ++)
+        res->actuals [i] = izmir_inline_expression (inl, r, e->actuals [i], h,
+                                                    line);
+      if (h->possible && izmir_inliner_can_inline (inl, e->callee_index))
+        {
+          izmir_variable result
+            = izmir_inliner_fresh_variable (inl, e->callee, "result");
+          izmir_hoisting_append (inl, h,
+                                 izmir_inline_call_into (inl, e->callee_index,
+                                                         res->actuals, result,
+                                                         line),
+                                 result);
+          return izmir_inliner_make_variable (inl, result);
+        }
+      break;
+    default:
+      jitter_fatal ("invalid expression case: %i", (int) e->case_);
+    }
+
+  /* Nothing may be moved before what was not moved, if it has effects. */
+  if (izmir_has_effects (res))
+    h->possible = false;
+  return res;
+}
+
+/* Return the variable set by an assignment to the given variable according
+   to the pointed renamings. */
+static izmir_variable
+izmir_inline_assigned_variable (const struct izmir_renaming *r,
+                                izmir_variable v)
+{
+  const struct izmir_expression *replacement = izmir_renaming_lookup (r, v);
+  if (replacement == NULL)
+    return v;
+  if (replacement->case_ != izmir_expression_case_variable)
+    jitter_fatal ("assigning substituted variable %s", v);
+  return replacement->variable;
+}
+
+/* Return a statement doing what a return of the pointed result, already
+   copied, does in the pointed copy.  If tail is non-false the return is the
+   last thing the inlined body does, and need not jump anywhere. */
+static struct izmir_statement *
+izmir_inline_return (struct izmir_inliner *inl, const struct izmir_copy *copy,
+                     struct izmir_expression *result, bool tail, int line)
+{
+  struct izmir_return_context *returns = copy->returns;
+  if (returns->case_ != izmir_return_case_inlined)
+    {
+      struct izmir_statement *res
+        = izmir_inliner_make_statement (inl, izmir_statement_case_return,
+                                        line);
+      res->return_result = result;
+      return res;
+    }
+
+  struct izmir_statement_list l;
+  izmir_statement_list_initialize (& l);
+  if (returns->result != NULL)
+    izmir_statement_list_append
+       (inl, & l, izmir_inliner_make_assignment (inl, returns->result, result,
+                                                 line));
+  else if (izmir_has_effects (result))
+    {
+      if (returns->discarded == NULL)
+        returns->discarded
+          = izmir_inliner_fresh_variable (inl, copy->procedure->procedure_name,
+                                          "result");
+      izmir_statement_list_append
+         (inl, & l, izmir_inliner_make_assignment (inl, returns->discarded,
+                                                   result, line));
+    }
+  if (! tail)
+    {
+      struct izmir_statement *exit
+        = izmir_inliner_make_statement (inl,
+                                        izmir_statement_case_inlined_exit,
+                                        line);
+      exit->inlined_exit_target = returns->inlined;
+      returns->exited = true;
+      izmir_statement_list_append (inl, & l, exit);
+    }
+  return izmir_statement_list_to_statement (inl, & l, line);
+}
+
+/* Return a copy of the given actuals, occurring at the given line, with
+   variables replaced according to the pointed renamings and calls inlined
+   into the pointed hoisting. */
+static struct izmir_expression **
+izmir_inline_actuals (struct izmir_inliner *inl,
+                      const struct izmir_renaming *r,
+                      struct izmir_expression * const *actuals,
+                      size_t actual_no, struct izmir_hoisting *h, int line)
+{
+  struct izmir_expression **res
+    = izmir_program_allocate (inl->program,
+                              sizeof (struct izmir_expression *) * actual_no);
+  size_t i;
+  for (i = 0; i < actual_no; i ++)
+    res [i] = izmir_inline_expression (inl, r, actuals [i], h, line);
+  return res;
+}
+
+/* Return non-false iff the pointed expression is a call which may be inlined
+   where it is. */
+static bool
+izmir_inline_is_candidate (const struct izmir_inliner *inl,
+                           const struct izmir_expression *e)
+{
+  return (e->case_ == izmir_expression_case_call
+          && izmir_inliner_can_inline (inl, e->callee_index));
+}
+
+/* Return a copy of the pointed block statement, as izmir_inline_statement
+   does, walking its chain with a loop: see izmir_block_inner_block .  The copy
+   of each inner block is made before its body, which is filled in by the next
+   iteration. */
+static struct izmir_statement *
+izmir_inline_block (struct izmir_inliner *inl, const struct izmir_copy *copy,
+                    const struct izmir_renaming *r,
+                    const struct izmir_statement *st, bool tail)
+{
+  struct izmir_statement *res
+    = izmir_inliner_make_block (inl, NULL, NULL, st->line);
+  struct izmir_statement *block = res;
+  while (true)
+    {
+      /* Block variables of a copied body get fresh names.  The renamings
+         outlive each iteration, so they go in the arena. */
+      block->block_variable = st->block_variable;
+      if (copy->procedure != NULL)
+        {
+          block->block_variable
+            = izmir_inliner_fresh_variable (inl,
+                                            copy->procedure->procedure_name,
+                                            st->block_variable);
+          struct izmir_renaming *renaming
+            = izmir_program_allocate (inl->program,
+                                      sizeof (struct izmir_renaming));
+          renaming->variable = st->block_variable;
+          renaming->replacement
+            = izmir_inliner_make_variable (inl, block->block_variable);
+          renaming->next = r;
+          r = renaming;
+        }
+
+      size_t prefix_no;
+      const struct izmir_statement *inner
+        = izmir_block_inner_block (st, & prefix_no);
+      if (inner == NULL)
+        {
+          block->block_body
+            = izmir_inline_statement (inl, copy, r, st->block_body, tail);
+          return res;
+        }
+      struct izmir_statement_list l;
+      izmir_statement_list_initialize (& l);
+      size_t i;
+      for (i = 0; i < prefix_no; i ++)
+        izmir_statement_list_append
+           (inl, & l,
+            izmir_inline_statement (inl, copy, r,
+                                    st->block_body->sequence_statements [i],
+                                    false));
+      struct izmir_statement *inner_block
+        = izmir_inliner_make_block (inl, NULL, NULL, inner->line);
+      izmir_statement_list_append (inl, & l, inner_block);
+      block->block_body
+        = izmir_statement_list_to_statement (inl, & l, st->block_body->line);
+      block = inner_block;
+      st = inner;
+    }
+}
+
+/* Return a copy of the pointed statement in the pointed context, with
+   variables replaced according to the pointed renamings and calls inlined.
+   The statement is the last thing which its inlined body does if tail is
+   non-false. */
+static struct izmir_statement *
+izmir_inline_statement (struct izmir_inliner *inl,
+                        const struct izmir_copy *copy,
+                        const struct izmir_renaming *r,
+                        const struct izmir_statement *st, bool tail)
+{
+  int line = st->line;
+  struct izmir_hoisting h;
+  izmir_hoisting_initialize (& h, true);
+  struct izmir_statement *res;
+  size_t i;
+  switch (st->case_)
+    {
+    case izmir_statement_case_skip:
+      return izmir_inliner_make_statement (inl, izmir_statement_case_skip,
+                                           line);
+
+    case izmir_statement_case_block:
+      return izmir_inline_block (inl, copy, r, st, tail);
+
+    case izmir_statement_case_assignment:
+      {
+        /* A call assigned to a variable sets it directly from the inlined
+           returns. */
+        izmir_variable v
+          = izmir_inline_assigned_variable (r, st->assignment_variable);
+        const struct izmir_expression *e = st->assignment_expression;
+        if (izmir_inline_is_candidate (inl, e))
+          res = izmir_inline_call_into
+                   (inl, e->callee_index,
+                    izmir_inline_actuals (inl, r, e->actuals, e->actual_no,
+                                          & h, line),
+                    v, line);
+        else
+          res = izmir_inliner_make_assignment
+                   (inl, v, izmir_inline_expression (inl, r, e, & h, line),
+                    line);
+        return izmir_hoisting_wrap (inl, & h, res);
+      }
+
+    case izmir_statement_case_print:
+      res = izmir_inliner_make_statement (inl, izmir_statement_case_print,
+                                          line);
+      res->print_expression
+        = izmir_inline_expression (inl, r, st->print_expression, & h, line);
+      return izmir_hoisting_wrap (inl, & h, res);
+
+    case izmir_statement_case_sequence:
+      {
+        struct izmir_statement_list l;
+        izmir_statement_list_initialize (& l);
+        for (i = 0; i < st->sequence_statement_no; i ++)
+          izmir_statement_list_append
+             (inl, & l,
+              izmir_inline_statement (inl, copy, r,
+                                      st->sequence_statements [i],
+                                      (tail
+                                       && i + 1 == st->sequence_statement_no)));
+        return izmir_statement_list_to_statement (inl, & l, line);
+      }
+
+    case izmir_statement_case_if_then_else:
+      res = izmir_inliner_make_statement
+               (inl, izmir_statement_case_if_then_else, line);
+      res->if_then_else_condition
+        = izmir_inline_expression (inl, r, st->if_then_else_condition, & h,
+                                   line);
+      res->if_then_else_then_branch
+        = izmir_inline_statement (inl, copy, r, st->if_then_else_then_branch,
+                                  tail);
+      res->if_then_else_else_branch
+        = izmir_inline_statement (inl, copy, r, st->if_then_else_else_branch,
+                                  tail);
+      return izmir_hoisting_wrap (inl, & h, res);
+
+    case izmir_statement_case_repeat_until:
+      {
+        /* The guard is evaluated right after the body, so calls moved out of
+           it run at the end of the body. */
+        res = izmir_inliner_make_statement
+                 (inl, izmir_statement_case_repeat_until, line);
+        struct izmir_statement *body
+          = izmir_inline_statement (inl, copy, r, st->repeat_until_body,
+                                    false);
+        res->repeat_until_guard
+          = izmir_inline_expression (inl, r, st->repeat_until_guard, & h,
+                                     line);
+        if (h.result_no > 0)
+          {
+            struct izmir_statement_list l;
+            izmir_statement_list_initialize (& l);
+            izmir_statement_list_append (inl, & l, body);
+            for (i = 0; i < h.prelude.statement_no; i ++)
+              izmir_statement_list_append (inl, & l,
+                                           h.prelude.statements [i]);
+            body = izmir_statement_list_to_statement (inl, & l, line);
+          }
+        res->repeat_until_body = body;
+        return izmir_hoisting_declare (inl, & h, res);
+      }
+
+    case izmir_statement_case_return:
+      {
+        /* The result of a return from the main statement is not evaluated. */
+        const struct izmir_expression *e = st->return_result;
+        if (copy->returns->case_ == izmir_return_case_exit)
+          h.possible = false;
+
+        /* A call returned from a procedure, or from an inlined body, is
+           inlined with the same returns. */
+        if (copy->returns->case_ != izmir_return_case_exit
+            && izmir_inline_is_candidate (inl, e))
+          res = izmir_inline_call (inl, e->callee_index,
+                                   izmir_inline_actuals (inl, r, e->actuals,
+                                                         e->actual_no, & h,
+                                                         line),
+                                   copy->returns, tail, line);
+        else
+          res = izmir_inline_return (inl, copy,
+                                     izmir_inline_expression (inl, r, e, & h,
+                                                              line),
+                                     tail, line);
+        return izmir_hoisting_wrap (inl, & h, res);
+      }
+
+    case izmir_statement_case_call:
+      {
+        struct izmir_expression **actuals
+          = izmir_inline_actuals (inl, r, st->actuals, st->actual_no, & h,
+                                  line);
+        if (izmir_inliner_can_inline (inl, st->callee_index))
+          res = izmir_inline_call_into (inl, st->callee_index, actuals, NULL,
+                                        line);
+        else
+          {
+            res = izmir_inliner_make_statement (inl, izmir_statement_case_call,
+                                                line);
+            res->callee = st->callee;
+            res->callee_index = st->callee_index;
+            res->actuals = actuals;
+            res->actual_no = st->actual_no;
+          }
+        return izmir_hoisting_wrap (inl, & h, res);
+      }
+
+    case izmir_statement_case_element_assignment:
+      res = izmir_inliner_make_statement
+               (inl, izmir_statement_case_element_assignment, line);
+      res->element_array
+        = izmir_inline_expression (inl, r, st->element_array, & h, line);
+      res->element_index
+        = izmir_inline_expression (inl, r, st->element_index, & h, line);
+      res->element_value
+        = izmir_inline_expression (inl, r, st->element_value, & h, line);
+      return izmir_hoisting_wrap (inl, & h, res);
+
+    case izmir_statement_case_bulk:
+      res = izmir_inliner_make_statement (inl, izmir_statement_case_bulk,
+                                          line);
+      res->bulk_operation = st->bulk_operation;
+      res->bulk_operands
+        = izmir_inline_actuals (inl, r, st->bulk_operands, st->bulk_operand_no,
+                                & h, line);
+      res->bulk_operand_no = st->bulk_operand_no;
+      return izmir_hoisting_wrap (inl, & h, res);
+
+    default:
+      jitter_fatal ("invalid statement case: %i", (int) st->case_);
+    }
+}
+
+/* Return a statement running a copy of the body of the procedure with the
+   given index, in place of a call to it at the given line with the given
+   actuals, already copied.  Returns in the body are copied according to the
+   pointed context; the call is the last thing its inlined body does if tail
+   is non-false. */
+static struct izmir_statement *
+izmir_inline_call (struct izmir_inliner *inl, size_t callee_index,
+                   struct izmir_expression **actuals,
+                   struct izmir_return_context *returns, bool tail, int line)
+{
+  const struct izmir_procedure *callee
+    = inl->program->procedures [callee_index];
+  const struct izmir_statement *body = inl->bodies [callee_index];
+
+  /* Substitute literal and variable actuals for the formals which the body
+   never modifies, and bind the other formals to fresh variables. */
+  struct izmir_renaming *renamings
+    = izmir_program_allocate (inl->program, (sizeof (struct izmir_renaming)
+                                             * callee->formal_no));
+  const struct izmir_renaming *r = NULL;
+  size_t i;
+  for (i = 0; i < callee->formal_no; i ++)
+    {
+      izmir_variable formal = callee->formals [i];
+      struct izmir_expression *actual = actuals [i];
+      renamings [i].variable = formal;
+      renamings [i].next = r;
+      if ((actual->case_ == izmir_expression_case_literal
+           && ! izmir_statement_modifies (body, formal, true))
+          || (actual->case_ == izmir_expression_case_variable
+              && ! izmir_statement_modifies (body, formal, false)))
+        renamings [i].replacement = actual;
+      else
+        renamings [i].replacement
+          = izmir_inliner_make_variable
+               (inl, izmir_inliner_fresh_variable (inl, callee->procedure_name,
+                                                   formal));
+      r = renamings + i;
+    }
+
+  /* Copy the body.  Falling off its end returns an undefined result. */
+  struct izmir_copy copy = { callee, returns };
+  struct izmir_statement_list l;
+  izmir_statement_list_initialize (& l);
+  inl->expanding [callee_index] = true;
+  inl->depth ++;
+  inl->size += inl->body_sizes [callee_index];
+  if (izmir_statement_always_returns (body))
+    izmir_statement_list_append (inl, & l,
+                                 izmir_inline_statement (inl, & copy, r, body,
+                                                         tail));
+  else
+    {
+      izmir_statement_list_append (inl, & l,
+                                   izmir_inline_statement (inl, & copy, r,
+                                                           body, false));
+      izmir_statement_list_append
+         (inl, & l,
+          izmir_inline_return
+             (inl, & copy,
+              izmir_inliner_make_expression (inl,
+                                             izmir_expression_case_undefined),
+              tail, line));
+    }
+  inl->depth --;
+  inl->expanding [callee_index] = false;
+  inl->inlined = true;
+
+  /* Bind the fresh formals around the body, first to last so that actuals
+     are evaluated in order. */
+  struct izmir_statement *res = izmir_statement_list_to_statement (inl, & l,
+                                                                   line);
+  for (i = callee->formal_no; i > 0; i --)
+    if (renamings [i - 1].replacement != actuals [i - 1])
+      {
+        izmir_variable v = renamings [i - 1].replacement->variable;
+        izmir_statement_list_initialize (& l);
+        izmir_statement_list_append
+           (inl, & l, izmir_inliner_make_assignment (inl, v, actuals [i - 1],
+                                                     line));
+        izmir_statement_list_append (inl, & l, res);
+        res = izmir_inliner_make_block
+                 (inl, v, izmir_statement_list_to_statement (inl, & l, line),
+                  line);
+      }
+  return res;
+}
+
+/* Return a statement running a copy of the body of the procedure with the
+   given index in place of a call to it at the given line with the given
+   actuals, already copied, and setting the given variable to its result, or
+   dropping the result if the variable is NULL. */
+static struct izmir_statement *
+izmir_inline_call_into (struct izmir_inliner *inl, size_t callee_index,
+                        struct izmir_expression **actuals,
+                        izmir_variable result, int line)
+{
+  struct izmir_return_context returns;
+  returns.case_ = izmir_return_case_inlined;
+  returns.result = result;
+  returns.inlined
+    = izmir_inliner_make_statement (inl, izmir_statement_case_inlined, line);
+  returns.exited = false;
+  returns.discarded = NULL;
+  struct izmir_statement *res
+    = izmir_inline_call (inl, callee_index, actuals, & returns, true, line);
+
+  /* Without exits the inlined statement would only cost a label. */
+  if (returns.exited)
+    {
+      returns.inlined->inlined_body = res;
+      res = returns.inlined;
+    }
+  if (returns.discarded != NULL)
+    res = izmir_inliner_make_block (inl, returns.discarded, res, line);
+  return res;
+}
+
+
+
+
+/* Program inlining.
+ * ************************************************************************** */
+
+void
+izmir_inline_program (struct izmir_program *p, size_t budget)
+{
+  if (budget == 0 || p->procedure_no == 0)
+    return;
+
+  struct izmir_inliner inl;
+  inl.program = p;
+  inl.budget = budget;
+  inl.bodies
+    = jitter_xmalloc (sizeof (struct izmir_statement *) * p->procedure_no);
+  inl.body_sizes = jitter_xmalloc (sizeof (size_t) * p->procedure_no);
+  inl.expanding = jitter_xmalloc (sizeof (bool) * p->procedure_no);
+  inl.depth = 0;
+  inl.size = izmir_statement_size (p->main_statement);
+  inl.fresh_variable_no = 0;
+  inl.inlined = false;
+  size_t i;
+  for (i = 0; i < p->procedure_no; i ++)
+    {
+      inl.bodies [i] = p->procedures [i]->body;
+      inl.body_sizes [i] = izmir_statement_size (inl.bodies [i]);
+      inl.expanding [i] = false;
+      inl.size += inl.body_sizes [i];
+    }
+  inl.size_limit = inl.size * IZMIR_INLINE_MAX_GROWTH;
+
+  /* Rewrite every body from the original bodies, leaving them alone until
+     the end, and never inline a procedure into itself. */
+  struct izmir_statement **bodies
+    = jitter_xmalloc (sizeof (struct izmir_statement *) * p->procedure_no);
+  struct izmir_return_context returns;
+  returns.case_ = izmir_return_case_return;
+  struct izmir_copy copy = { NULL, & returns };
+  for (i = 0; i < p->procedure_no; i ++)
+    {
+      inl.expanding [i] = true;
+      bodies [i] = izmir_inline_statement (& inl, & copy, NULL, inl.bodies [i],
+                                           false);
+      inl.expanding [i] = false;
+    }
+  returns.case_ = izmir_return_case_exit;
+  struct izmir_statement *main_statement
+    = izmir_inline_statement (& inl, & copy, NULL, p->main_statement, false);
+
+  /* Resolve again, to give slots to the new variables. */
+  if (inl.inlined)
+    {
+      for (i = 0; i < p->procedure_no; i ++)
+        p->procedures [i]->body = bodies [i];
+      p->main_statement = main_statement;
+      izmir_resolve_program (p);
+    }
+
+  free (bodies);
+  free (inl.expanding);
+  free (inl.body_sizes);
+  free (inl.bodies);
+}
@@ -0,0 +1,74 @@
+/* Izmir language: call-site inlining of small procedures.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_INLINE_H_
+#define IZMIR_INLINE_H_
+
+#include <stddef.h>
+
+#include "izmir-syntax.h"
+
+
+/* Inlining.
+ * ************************************************************************** */
+
+/* The default inlining budget, in AST nodes. */
+#define IZMIR_INLINE_DEFAULT_BUDGET  40
+
+/* Replace calls to small procedures in the pointed program AST with copies of
+   the procedure bodies, so that no call, argument passing or return remains
+   where a procedure is only a few operations long, and so that optimization
+   (see izmir-optimize.h), which must run afterwards, can fold constants across
+   what used to be a procedure boundary.
+
+   A procedure is small when its body, as parsed, has at most the given budget
+   of AST nodes; a budget of zero disables inlining.  A call is inlined where
+   it is a statement, the whole expression of an assignment or of a return, or
+   anywhere else within an expression evaluated once and unconditionally by a
+   statement, provided that everything evaluated before it has no effects; the
+   inlined body then runs right before the statement and leaves the result in
+   a fresh variable.  Calls within inlined bodies are inlined in turn, up to a
+   fixed depth, but never into a copy of the same procedure: recursive
+   procedures are expanded at most once on each path.  Since each level of
+   nesting may multiply the size of a body, the whole program is also limited
+   to a fixed multiple of its original size in AST nodes: procedures are
+   rewritten in order and then the main statement, and a call is no longer
+   inlined once its body would take the program past the limit.
+
+   Each formal becomes a fresh block variable initialized with its actual,
+   except that a literal or a variable actual for a formal which the body
+   never assigns is substituted into the body directly.  Block variables of
+   the body are renamed as well, so that they cannot clash with the caller's.
+   A return becomes an assignment of the result, followed by an inlined exit
+   statement jumping past the inlined body unless the return is the last thing
+   the body does.
+
+   The program must have been resolved (see izmir-resolve.h), and is resolved
+   again when anything was inlined.  Every new node is allocated in the
+   program arena. */
+void
+izmir_inline_program (struct izmir_program *p, size_t budget);
+
+
+#endif // #ifndef IZMIR_INLINE_H_
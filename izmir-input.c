@@ -0,0 +1,253 @@
+/* Izmir language: buffered integer input for the input instructions.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-error.h"
+#include "izmir-input.h"
+
+
+/* Buffer management.
+ * ************************************************************************** */
+
+/* The size of the longest token which is even considered as an integer.  This
+   leaves room for leading zeros, and bounds how much of a malformed token is
+   buffered. */
+#define IZMIR_INPUT_MAX_TOKEN_SIZE  64
+
+/* Return the offset in the input of the next unread byte in the pointed
+   input. */
+static long long
+izmir_input_offset (const struct izmir_input *in)
+{
+  return in->base_offset + (in->position - in->base);
+}
+
+/* Prepare the pointed input for its first read, mapping the standard input if
+   it is a regular file or otherwise allocating a read buffer. */
+static void
+izmir_input_set_up (struct izmir_input *in)
+{
+  in->set_up = true;
+
+  /* Start mapping from the current offset, in case some of the file was
+     already consumed. */
+  struct stat st;
+  off_t offset = lseek (in->fd, 0, SEEK_CUR);
+  if (offset >= 0
+      && fstat (in->fd, & st) == 0
+      && S_ISREG (st.st_mode)
+      && st.st_size > offset)
+    {
+      void *mapping = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, in->fd,
+                            0);
+      if (mapping != MAP_FAILED)
+        {
+          madvise (mapping, st.st_size, MADV_SEQUENTIAL);
+          in->mapping = mapping;
+          in->mapping_size = st.st_size;
+          in->base = mapping;
+          in->base_offset = 0;
+          in->position = in->base + offset;
+          in->limit = in->base + st.st_size;
+          in->end_of_file = true;
+          return;
+        }
+    }
+
+  /* Mapping was not possible: read. */
+  in->size = IZMIR_INPUT_DEFAULT_SIZE;
+  in->buffer = jitter_xmalloc (in->size);
+  in->base = in->buffer;
+  in->base_offset = (offset >= 0) ? offset : 0;
+  in->position = in->buffer;
+  in->limit = in->buffer;
+}
+
+/* Read more input into the pointed input buffer, after the unread bytes which
+   are first moved to the beginning.  Return false if nothing more could be
+   read because the input is over. */
+static bool
+izmir_input_refill (struct izmir_input *in)
+{
+  if (in->end_of_file)
+    return false;
+
+  size_t unread_size = in->limit - in->position;
+  in->base_offset += in->position - in->base;
+  memmove (in->buffer, in->position, unread_size);
+  in->position = in->buffer;
+  in->limit = in->buffer + unread_size;
+
+  /* About to block: let the user see what was printed so far. */
+  if (in->output != NULL)
+    izmir_output_flush (in->output);
+  fflush (stdout);
+
+  ssize_t read_size;
+  do
+    read_size = read (in->fd, in->buffer + unread_size,
+                      in->size - unread_size);
+  while (read_size < 0 && errno == EINTR);
+  if (read_size < 0)
+    izmir_fail ("input: could not read: %s", strerror (errno));
+  if (read_size == 0)
+    {
+      in->end_of_file = true;
+      return false;
+    }
+  in->limit += read_size;
+  return true;
+}
+
+
+
+
+/* Input operations.
+ * ************************************************************************** */
+
+void
+izmir_input_initialize (struct izmir_input *in, struct izmir_output *output)
+{
+  in->position = NULL;
+  in->limit = NULL;
+  in->buffer = NULL;
+  in->size = 0;
+  in->mapping = NULL;
+  in->mapping_size = 0;
+  in->base = NULL;
+  in->base_offset = 0;
+  in->fd = 0;
+  in->set_up = false;
+  in->end_of_file = false;
+  in->output = output;
+}
+
+/* Release the buffer or the mapping of the pointed input, if any. */
+static void
+izmir_input_release (struct izmir_input *in)
+{
+  if (in->mapping != NULL)
+    munmap (in->mapping, in->mapping_size);
+  free (in->buffer);
+  in->mapping = NULL;
+  in->buffer = NULL;
+}
+
+void
+izmir_input_finalize (struct izmir_input *in)
+{
+  if (! in->set_up)
+    return;
+
+  /* Give back what was not parsed, where the file offset can be moved; on
+     pipes and terminals this fails harmlessly. */
+  if (in->fd >= 0)
+    lseek (in->fd, izmir_input_offset (in), SEEK_SET);
+  izmir_input_release (in);
+}
+
+void
+izmir_input_set_memory (struct izmir_input *in, const char *text, size_t size)
+{
+  if (in->set_up)
+    izmir_input_release (in);
+  in->base = text;
+  in->base_offset = 0;
+  in->position = text;
+  in->limit = text + size;
+  in->fd = -1;
+  in->set_up = true;
+  in->end_of_file = true;
+}
+
+jitter_int
+izmir_input_read_slow (struct izmir_input *in)
+{
+  if (! in->set_up)
+    izmir_input_set_up (in);
+
+  /* Skip whitespace, refilling as needed. */
+  while (true)
+    {
+      while (in->position < in->limit && izmir_input_is_space (* in->position))
+        in->position ++;
+      if (in->position < in->limit)
+        break;
+      if (! izmir_input_refill (in))
+        izmir_fail ("input: end of input at byte %lli",
+                    izmir_input_offset (in));
+    }
+
+  /* Find the end of the token, refilling until the token is whole or too
+     long to be an integer. */
+  const char *end;
+  while (true)
+    {
+      end = in->position;
+      while (end < in->limit && ! izmir_input_is_space (* end)
+             && end - in->position <= IZMIR_INPUT_MAX_TOKEN_SIZE)
+        end ++;
+      if (end < in->limit || end - in->position > IZMIR_INPUT_MAX_TOKEN_SIZE)
+        break;
+      if (! izmir_input_refill (in))
+        {
+          /* The token ends the input.  Refilling moved it. */
+          end = in->limit;
+          break;
+        }
+    }
+
+  /* Parse the token, checking for overflow.  The magnitude of a negative
+     integer may be one more than the largest positive integer. */
+  const char *p = in->position;
+  bool negative = (* p == '-');
+  if (* p == '-' || * p == '+')
+    p ++;
+  jitter_uint maximum = ((jitter_uint) -1 >> 1) + negative;
+  jitter_uint n = 0;
+  if (p == end)
+    izmir_fail ("input: invalid integer at byte %lli",
+                izmir_input_offset (in));
+  for (; p < end; p ++)
+    {
+      unsigned digit = (unsigned char) * p - '0';
+      if (digit >= 10)
+        izmir_fail ("input: invalid integer at byte %lli",
+                    izmir_input_offset (in));
+      if (n > (maximum - digit) / 10)
+        izmir_fail ("input: integer out of range at byte %lli",
+                    izmir_input_offset (in));
+      n = n * 10 + digit;
+    }
+  in->position = end;
+  return negative ? (jitter_int) - n : (jitter_int) n;
+}
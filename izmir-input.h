@@ -0,0 +1,190 @@
+/* Izmir language: buffered integer input for the input instructions.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_INPUT_H_
+#define IZMIR_INPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <jitter/jitter.h>
+
+#include "izmir-output.h"
+
+
+/* About input.
+ * ************************************************************************** */
+
+/* Like output (see izmir-output.h), every izmirvm state owns one input
+   buffer, from which the input instructions parse decimal integers without
+   going through stdio.  The standard input is read in large blocks, or mapped
+   into memory at once when it is a regular file.  The buffer is only set up
+   by the first input instruction, so that states which never read do not
+   touch the standard input; only one state per process should read it.  A
+   state may read from another file descriptor instead, set in the fd field
+   after initialization and before the first read, or from memory.
+
+   The input is a sequence of integers separated by whitespace, each an
+   optional sign followed by decimal digits.  Reading fails with izmir_fail ,
+   with a message giving the byte offset, if the input ends before the next integer,
+   if the next token is not an integer or if it does not fit in a jitter_int .
+
+   Before blocking on a read the state output is flushed, along with stdout ,
+   so that an interactive user sees every prompt.  Input which is already
+   buffered is parsed without flushing. */
+
+/* The default read buffer size in bytes. */
+#define IZMIR_INPUT_DEFAULT_SIZE  65536
+
+/* The size of the longest token which the inline fast path parses: a sign and
+   eighteen digits, which always fit in a 64-bit jitter_int .  Longer tokens
+   are left to the slow path, which checks for overflow. */
+#define IZMIR_INPUT_FAST_TOKEN_SIZE  19
+
+
+
+
+/* Input data structures.
+ * ************************************************************************** */
+
+/* An input buffer. */
+struct izmir_input
+{
+  /* The first unread byte, and the byte past the last buffered one. */
+  const char *position;
+  const char *limit;
+
+  /* The malloc-allocated read buffer, or NULL if the input is mapped or not
+     set up yet. */
+  char *buffer;
+
+  /* The allocated size of buffer , in bytes. */
+  size_t size;
+
+  /* The mapping of the whole input file, or NULL if the input is read. */
+  void *mapping;
+
+  /* The size of mapping , in bytes. */
+  size_t mapping_size;
+
+  /* The beginning of the buffered data, which is buffer or mapping , and its
+     offset in the input, for error messages. */
+  const char *base;
+  long long base_offset;
+
+  /* The file descriptor to read from, or -1 when reading from memory. */
+  int fd;
+
+  /* Non-false iff the buffer was set up. */
+  bool set_up;
+
+  /* Non-false iff nothing is left to read beyond limit . */
+  bool end_of_file;
+
+  /* The output to flush before blocking on a read, or NULL. */
+  struct izmir_output *output;
+};
+
+
+
+
+/* Input operations.
+ * ************************************************************************** */
+
+/* Initialize the pointed input to read from the standard input, flushing the
+   pointed output, which may be NULL, before blocking. */
+void
+izmir_input_initialize (struct izmir_input *in, struct izmir_output *output);
+
+/* Finalize the pointed input.  When the standard input is seekable leave its
+   file offset right after the last parsed integer, so that any other reader
+   sees the rest. */
+void
+izmir_input_finalize (struct izmir_input *in);
+
+/* Make the pointed input read the given bytes instead of a file, from the
+   beginning.  The bytes are not copied, and must stay alive as long as the
+   input reads them.  Anything read so far is forgotten. */
+void
+izmir_input_set_memory (struct izmir_input *in, const char *text, size_t size);
+
+/* Read and return the next integer from the pointed input in the general
+   case, refilling the buffer as needed, or fail.  This is the
+   out-of-line part of izmir_input_read . */
+jitter_int
+izmir_input_read_slow (struct izmir_input *in);
+
+/* Return non-false iff the given character is whitespace. */
+static inline bool
+izmir_input_is_space (char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* Read and return the next integer from the pointed input, or fail.
+   The inline part handles tokens of at most IZMIR_INPUT_FAST_TOKEN_SIZE
+   bytes, followed by whitespace, away from the end of the buffer. */
+static inline jitter_int
+izmir_input_read (struct izmir_input *in)
+{
+  /* Only parse here if there is room for a whole token and the whitespace
+     following it. */
+  const char *p = in->position;
+  while ((size_t) (in->limit - p) > IZMIR_INPUT_FAST_TOKEN_SIZE + 1
+         && izmir_input_is_space (* p))
+    p ++;
+  if (__builtin_expect ((size_t) (in->limit - p)
+                        <= IZMIR_INPUT_FAST_TOKEN_SIZE + 1, false))
+    goto slow;
+
+  /* Parse the sign, with no branch, and at most eighteen digits. */
+  const char *token = p;
+  bool negative = (* p == '-');
+  p += negative | (* p == '+');
+  const char *digits = p;
+  const char *digit_limit = digits + (IZMIR_INPUT_FAST_TOKEN_SIZE - 1);
+  jitter_uint n = 0;
+  unsigned digit;
+  while (p < digit_limit && (digit = (unsigned char) * p - '0') < 10)
+    {
+      n = n * 10 + digit;
+      p ++;
+    }
+
+  /* Anything unusual, such as an empty, long or malformed token, is left to
+     the slow path, which reports errors. */
+  if (__builtin_expect (p == digits || ! izmir_input_is_space (* p), false))
+    {
+      p = token;
+      goto slow;
+    }
+  in->position = p;
+  return negative ? - (jitter_int) n : (jitter_int) n;
+
+ slow:
+  in->position = p;
+  return izmir_input_read_slow (in);
+}
+
+
+#endif // #ifndef IZMIR_INPUT_H_
@@ -0,0 +1,219 @@
+/* Izmir language: dispatch-model launcher.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+/* This is the izmir (or izmirvm) executable which users run.  It does no work
+   itself: it chooses one of the executables izmir-DISPATCH built alongside it,
+   one per Jitter dispatch model, and replaces itself with it, passing every
+   argument through except --dispatch=DISPATCH options.
+
+   Without a --dispatch option, or with --dispatch=auto , the launcher takes
+   the first dispatch model in IZMIR_LAUNCHER_DISPATCHES whose executable is
+   present.  The build system lists there only the models which Jitter
+   supports on this machine, best first; skipping missing executables lets a
+   partial build still work, with a slower dispatch. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* Configuration.
+ * ************************************************************************** */
+
+/* The name of the program to launch, without the dispatch suffix.  The build
+   system defines this. */
+#ifndef IZMIR_LAUNCHER_PROGRAM
+# define IZMIR_LAUNCHER_PROGRAM "izmir"
+#endif
+
+/* A comma-separated list of the dispatch models which were built, best first.
+   The build system defines this. */
+#ifndef IZMIR_LAUNCHER_DISPATCHES
+# define IZMIR_LAUNCHER_DISPATCHES "no-threading,minimal-threading,direct-threading,switch"
+#endif
+
+/* The prefix of the option selecting a dispatch model. */
+#define IZMIR_LAUNCHER_OPTION "--dispatch="
+
+
+
+
+/* Utility.
+ * ************************************************************************** */
+
+/* Print an error message prefixed by the program name, and exit with
+   failure. */
+static void
+izmir_launcher_fail (const char *message, const char *argument)
+  __attribute__ ((noreturn));
+static void
+izmir_launcher_fail (const char *message, const char *argument)
+{
+  fprintf (stderr, "%s: %s%s\n", IZMIR_LAUNCHER_PROGRAM, message, argument);
+  exit (EXIT_FAILURE);
+}
+
+/* Return a malloc-allocated copy of the directory containing this executable,
+   including a final slash, or an empty string if it cannot be found; in the
+   second case the chosen executable will be searched in the PATH. */
+static char *
+izmir_launcher_directory (const char *argv0)
+{
+  char buffer [4096];
+  ssize_t size = readlink ("/proc/self/exe", buffer, sizeof (buffer) - 1);
+  const char *path;
+  if (size > 0)
+    {
+      buffer [size] = '\0';
+      path = buffer;
+    }
+  else
+    path = argv0;
+
+  const char *last_slash = strrchr (path, '/');
+  size_t directory_size = (last_slash == NULL) ? 0 : last_slash - path + 1;
+  char *res = malloc (directory_size + 1);
+  if (res == NULL)
+    izmir_launcher_fail ("out of memory", "");
+  memcpy (res, path, directory_size);
+  res [directory_size] = '\0';
+  return res;
+}
+
+/* Return a malloc-allocated string holding the pathname of the executable for
+   the given dispatch model, of the given length, in the given directory. */
+static char *
+izmir_launcher_executable (const char *directory, const char *dispatch,
+                           size_t dispatch_length)
+{
+  size_t size = (strlen (directory) + strlen (IZMIR_LAUNCHER_PROGRAM)
+                 + 1 + dispatch_length + 1);
+  char *res = malloc (size);
+  if (res == NULL)
+    izmir_launcher_fail ("out of memory", "");
+  snprintf (res, size, "%s%s-%.*s", directory, IZMIR_LAUNCHER_PROGRAM,
+            (int) dispatch_length, dispatch);
+  return res;
+}
+
+/* Return non-false iff the given dispatch model, of the given length, is in
+   IZMIR_LAUNCHER_DISPATCHES . */
+static bool
+izmir_launcher_is_built (const char *dispatch, size_t dispatch_length)
+{
+  const char *p = IZMIR_LAUNCHER_DISPATCHES;
+  while (* p != '\0')
+    {
+      size_t length = strcspn (p, ",");
+      if (length == dispatch_length && ! strncmp (p, dispatch, length))
+        return true;
+      p += length;
+      if (* p == ',')
+        p ++;
+    }
+  return false;
+}
+
+
+
+
+/* Main function.
+ * ************************************************************************** */
+
+int
+main (int argc, char **argv)
+{
+  /* Find the requested dispatch model, and remove dispatch options from the
+     arguments.  Options after "--" belong to the program. */
+  const char *requested = "auto";
+  char **arguments = malloc (sizeof (char *) * (argc + 1));
+  if (arguments == NULL)
+    izmir_launcher_fail ("out of memory", "");
+  int argument_no = 1;
+  bool handle_options = true;
+  int i;
+  for (i = 1; i < argc; i ++)
+    {
+      if (handle_options && ! strcmp (argv [i], "--"))
+        handle_options = false;
+      if (handle_options
+          && ! strncmp (argv [i], IZMIR_LAUNCHER_OPTION,
+                        strlen (IZMIR_LAUNCHER_OPTION)))
+        requested = argv [i] + strlen (IZMIR_LAUNCHER_OPTION);
+      else
+        arguments [argument_no ++] = argv [i];
+    }
+  arguments [argument_no] = NULL;
+
+  /* --dispatch=list prints the dispatch models which were built. */
+  if (! strcmp (requested, "list"))
+    {
+      const char *p;
+      for (p = IZMIR_LAUNCHER_DISPATCHES; * p != '\0'; p ++)
+        putchar ((* p == ',') ? '\n' : * p);
+      putchar ('\n');
+      return EXIT_SUCCESS;
+    }
+
+  char *directory = izmir_launcher_directory (argv [0]);
+  char *executable = NULL;
+  if (! strcmp (requested, "auto"))
+    {
+      /* Take the best model whose executable is present. */
+      const char *p = IZMIR_LAUNCHER_DISPATCHES;
+      while (* p != '\0' && executable == NULL)
+        {
+          size_t length = strcspn (p, ",");
+          char *candidate = izmir_launcher_executable (directory, p, length);
+          if (* directory == '\0' || access (candidate, X_OK) == 0)
+            executable = candidate;
+          else
+            free (candidate);
+          p += length;
+          if (* p == ',')
+            p ++;
+        }
+      if (executable == NULL)
+        izmir_launcher_fail ("no executable found for any dispatch model in ",
+                             IZMIR_LAUNCHER_DISPATCHES);
+    }
+  else if (izmir_launcher_is_built (requested, strlen (requested)))
+    executable = izmir_launcher_executable (directory, requested,
+                                            strlen (requested));
+  else
+    izmir_launcher_fail ("dispatch model not built: ", requested);
+
+  /* Replace this process with the chosen executable.  An empty directory means
+     that our own location is unknown, and then the PATH is searched. */
+  arguments [0] = executable;
+  if (* directory == '\0')
+    execvp (executable, arguments);
+  else
+    execv (executable, arguments);
+  fprintf (stderr, "%s: cannot execute %s: %s\n", IZMIR_LAUNCHER_PROGRAM,
+           executable, strerror (errno));
+  return EXIT_FAILURE;
+}
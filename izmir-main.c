@@ -21,16 +21,41 @@
    You should have received a copy of the GNU General Public License
    along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <errno.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <jitter/jitter-fatal.h>
-
+#include <jitter/jitter-malloc.h>
+#include <jitter/jitter-mutable-routine.h>
+#include <jitter/jitter-print.h>
+#include <jitter/jitter-routine.h>
+
+#include "izmir-array.h"
+#include "izmir-batch.h"
+#include "izmir-cache.h"
+#include "izmir-code-generator-register.h"
+#include "izmir-code-generator-stack.h"
+#include "izmir-code.h"
+#include "izmir-error.h"
+#include "izmir-inline.h"
+#include "izmir-input.h"
+#include "izmir-optimize.h"
+#include "izmir-output.h"
+#include "izmir-parallel.h"
 #include "izmir-parser.h"
+#include "izmir-perf-map.h"
+#include "izmir-profile.h"
+#include "izmir-resolve.h"
+#include "izmir-server.h"
+#include "izmir-static-environment.h"
 #include "izmir-syntax.h"
+#include "izmirvm-vm.h"
 
 /* Why this source file parses argc and argv directly.
  * ************************************************************************** */
@@ -80,7 +105,97 @@ static void izmir_help_section(const char *title) {
 static void izmir_help(void) {
   printf("Usage: %s [OPTION...] FILE.izmir\n", izmir_program_name);
   printf("   or: %s [OPTION...] -\n", izmir_program_name);
-  printf("Print the İzmirVM translation of an İzmir-language program.");
+  printf("   or: %s [OPTION...] --server[=SOCKET]\n", izmir_program_name);
+  printf("Run an İzmir-language program on İzmirVM, in the same process.\n");
+
+  izmir_help_section("Routine options");
+  printf("      --print, --print-routine     print the İzmirVM routine in "
+         "textual form\n");
+  printf("      --disassemble                disassemble the specialized "
+         "routine\n");
+  printf("      --cross-disassemble          like --disassemble, using the "
+         "cross-disassembler\n");
+  printf("      --print-locations            print VM data locations\n");
+  printf("      --dry-run                    do not run the routine\n");
+  printf("      --time                       print phase times in seconds and "
+         "the\n"
+         "                                     executed instruction count, as "
+         "CSV on\n"
+         "                                     stderr\n");
+  printf("      --profile-specialized        print a profile of specialized "
+         "instructions\n");
+  printf("      --profile-unspecialized      print a profile of unspecialized "
+         "instructions\n");
+  printf("      --profile-json=FILE          write both profiles to FILE as "
+         "JSON\n");
+  printf("      --perf-map                   describe native code for perf in "
+         "/tmp/perf-PID.map\n");
+  printf("      --slow-literals-only         disable fast literals\n");
+  printf("      --slow-registers-only        disable fast registers\n");
+  printf("      --slow-only                  disable fast literals and "
+         "registers\n");
+
+  izmir_help_section("Output options");
+  printf("      --output-buffer-size=SIZE    flush printed numbers every SIZE "
+         "bytes;\n"
+         "                                     0 prints each with printf "
+         "(default %i)\n",
+         IZMIR_OUTPUT_DEFAULT_SIZE);
+  printf("      --output-fd=FD               write printed numbers to file "
+         "descriptor\n"
+         "                                     FD with writev, bypassing "
+         "stdio\n");
+
+  izmir_help_section("Array options");
+  printf("      --array-kernels=SET          run bulk array operations with "
+         "SET: auto,\n"
+         "                                     portable, sse4.2 or avx2 "
+         "(default auto)\n");
+
+  izmir_help_section("Batch options");
+  printf("      --inputs=LIST                run once per input file named in "
+         "LIST,\n"
+         "                                     one per line, printing to "
+         "INPUT.out\n");
+  printf("      --threads=N                  run inputs on N threads; 0 uses "
+         "one per\n"
+         "                                     processor (default 1)\n");
+
+  izmir_help_section("Server options");
+  printf("      --server                     compile and run length-prefixed "
+         "programs\n"
+         "                                     from stdin, replying on "
+         "stdout\n");
+  printf("      --server=SOCKET              the same, over connections to "
+         "a Unix\n"
+         "                                     socket\n");
+
+  izmir_help_section("Code generation options");
+  printf("      --register                   generate register-based code "
+         "(default)\n");
+  printf("      --stack                      generate stack-based code\n");
+  printf("      --no-optimization-rewriting  disable VM rewrite rules and "
+         "superinstructions\n");
+  printf("      --no-tail-calls              compile calls in tail position as "
+         "ordinary\n"
+         "                                     calls\n");
+  printf("      --inline-budget=N            inline procedures of at most N AST "
+         "nodes;\n"
+         "                                     0 disables inlining (default "
+         "%i)\n",
+         IZMIR_INLINE_DEFAULT_BUDGET);
+  printf("  -O0                              do not optimize the program before "
+         "code generation\n");
+  printf("  -O1                              inline, fold constants and simplify "
+         "the\n"
+         "                                     program (default)\n");
+  printf("  -j, --jobs=N                     compile procedures with N threads; "
+         "0 uses\n"
+         "                                     one per processor (default 1)\n");
+  printf("      --cache-dir=DIR              reuse code compiled by previous runs "
+         "from DIR\n");
+  printf("      --no-cache                   always compile the program "
+         "(default)\n");
 
   izmir_help_section("Common GNU-style options");
   printf("      --help                       give this help list and exit\n");
@@ -156,12 +271,21 @@ struct izmir_command_line {
   bool profile_specialized;
   bool profile_unspecialized;
 
+  /* The file where to write profiling information as JSON, or NULL. */
+  char *profile_json_path;
+
   /* True iff we should print data locations. */
   bool print_locations;
 
   /* True iff we should not actually run the VM routine. */
   bool dry_run;
 
+  /* True iff we should print the time spent in each phase. */
+  bool time;
+
+  /* True iff we should write a perf map for the native code. */
+  bool perf_map;
+
   /* True iff we should disable fast literals, for benchmarking a worst-case
      scenario or for comparing with some other implementation. */
   bool slow_literals_only;
@@ -172,9 +296,45 @@ struct izmir_command_line {
   /* True iff we should enable optimization rewriting. */
   bool optimization_rewriting;
 
+  /* The level of AST optimization, 0 for none. */
+  int optimization_level;
+
+  /* True iff calls in tail position are compiled as tail calls. */
+  bool tail_calls;
+
+  /* The size of the largest procedure body to inline, in AST nodes, or 0 not
+     to inline. */
+  size_t inline_budget;
+
   /* Which code generator is being used. */
   enum izmir_code_generator code_generator;
 
+  /* The number of compilation threads, or 0 for one per processor. */
+  long job_no;
+
+  /* The file listing one input pathname per line for a batch run, or NULL to
+     run once on the standard input. */
+  char *inputs_path;
+
+  /* The number of threads running batch inputs, or 0 for one per processor. */
+  long thread_no;
+
+  /* True iff we should serve programs rather than run one, and the Unix
+     socket to listen on, or NULL to use the standard input and output. */
+  bool server;
+  char *server_socket_path;
+
+  /* The size of the VM output buffer, and the file descriptor it writes to or
+     -1 for the standard output stream. */
+  size_t output_buffer_size;
+  int output_fd;
+
+  /* The directory holding cached compiled code, or NULL for no caching. */
+  char *cache_dir;
+
+  /* The kernels for bulk array operations. */
+  enum izmir_array_kernel_set array_kernel_set;
+
   /* Pathname of the program source to be loaded. */
   char *program_path;
 };
@@ -188,12 +348,27 @@ static void izmir_initialize_command_line(struct izmir_command_line *cl) {
   cl->print_defects = izmir_print_defect_what_no;
   cl->profile_specialized = false;
   cl->profile_unspecialized = false;
+  cl->profile_json_path = NULL;
   cl->print_locations = false;
   cl->dry_run = false;
+  cl->time = false;
+  cl->perf_map = false;
   cl->optimization_rewriting = true;
   cl->slow_literals_only = false;
   cl->slow_registers_only = false;
+  cl->optimization_level = 1;
+  cl->tail_calls = true;
+  cl->inline_budget = IZMIR_INLINE_DEFAULT_BUDGET;
   cl->code_generator = izmir_code_generator_register;
+  cl->job_no = 1;
+  cl->inputs_path = NULL;
+  cl->thread_no = 1;
+  cl->server = false;
+  cl->server_socket_path = NULL;
+  cl->output_buffer_size = IZMIR_OUTPUT_DEFAULT_SIZE;
+  cl->output_fd = -1;
+  cl->cache_dir = NULL;
+  cl->array_kernel_set = izmir_array_kernel_set_automatic;
   cl->program_path = NULL;
 }
 
@@ -206,6 +381,27 @@ static void izmir_set_command_line_program(struct izmir_command_line *cl,
   cl->program_path = arg;
 }
 
+/* Return the non-negative integer written in the given string, which is the
+   part of the given option following "=", failing fatally if the string is
+   not a valid number. */
+static long izmir_parse_natural(char *string, char *option) {
+  char *end;
+  errno = 0;
+  long res = strtol(string, &end, 10);
+  if (*string == '\0' || *end != '\0' || res < 0 || errno != 0)
+    izmir_usage("invalid number in ", option);
+  return res;
+}
+
+/* Return the given number of threads from the command line, replacing 0 with
+   the number of online processors. */
+static size_t izmir_thread_no(long requested) {
+  if (requested > 0)
+    return requested;
+  long processor_no = sysconf(_SC_NPROCESSORS_ONLN);
+  return (processor_no > 0) ? processor_no : 1;
+}
+
 /* Fill the pointed command-line data structure with information from the
    actual command line. */
 static void izmir_parse_command_line(struct izmir_command_line *cl, int argc,
@@ -248,6 +444,12 @@ static void izmir_parse_command_line(struct izmir_command_line *cl, int argc,
       cl->profile_specialized = true;
     else if (handle_options && !strcmp(arg, "--profile-unspecialized"))
       cl->profile_unspecialized = true;
+    else if (handle_options && !strncmp(arg, "--profile-json=", 15)) {
+      if (arg[15] == '\0')
+        izmir_usage("empty profile file name in ", arg);
+      cl->profile_json_path = arg + 15;
+    } else if (handle_options && !strcmp(arg, "--no-profile-json"))
+      cl->profile_json_path = NULL;
     else if (handle_options && !strcmp(arg, "--no-print-defects"))
       cl->print_defects = izmir_print_defect_what_no;
     else if (handle_options && !strcmp(arg, "--no-profile-unspecialized"))
@@ -276,6 +478,64 @@ static void izmir_parse_command_line(struct izmir_command_line *cl, int argc,
       cl->optimization_rewriting = true;
     else if (handle_options && !strcmp(arg, "--no-optimization-rewriting"))
       cl->optimization_rewriting = false;
+    else if (handle_options && !strcmp(arg, "--tail-calls"))
+      cl->tail_calls = true;
+    else if (handle_options && !strcmp(arg, "--no-tail-calls"))
+      cl->tail_calls = false;
+    else if (handle_options && !strncmp(arg, "--inline-budget=", 16))
+      cl->inline_budget = izmir_parse_natural(arg + 16, arg);
+    else if (handle_options && !strcmp(arg, "-O0"))
+      cl->optimization_level = 0;
+    else if (handle_options && !strcmp(arg, "-O1"))
+      cl->optimization_level = 1;
+    else if (handle_options && !strcmp(arg, "-j")) {
+      if (i + 1 == argc)
+        izmir_usage("missing number after ", arg);
+      cl->job_no = izmir_parse_natural(argv[++i], arg);
+    } else if (handle_options && !strncmp(arg, "-j", 2))
+      cl->job_no = izmir_parse_natural(arg + 2, arg);
+    else if (handle_options && !strncmp(arg, "--jobs=", 7))
+      cl->job_no = izmir_parse_natural(arg + 7, arg);
+    else if (handle_options && !strncmp(arg, "--inputs=", 9)) {
+      if (arg[9] == '\0')
+        izmir_usage("empty input list file name in ", arg);
+      cl->inputs_path = arg + 9;
+    } else if (handle_options && !strcmp(arg, "--no-inputs"))
+      cl->inputs_path = NULL;
+    else if (handle_options && !strncmp(arg, "--threads=", 10))
+      cl->thread_no = izmir_parse_natural(arg + 10, arg);
+    else if (handle_options && !strcmp(arg, "--server")) {
+      cl->server = true;
+      cl->server_socket_path = NULL;
+    } else if (handle_options && !strncmp(arg, "--server=", 9)) {
+      if (arg[9] == '\0')
+        izmir_usage("empty socket name in ", arg);
+      cl->server = true;
+      cl->server_socket_path = arg + 9;
+    } else if (handle_options && !strcmp(arg, "--no-server"))
+      cl->server = false;
+    else if (handle_options && !strncmp(arg, "--cache-dir=", 12)) {
+      if (arg[12] == '\0')
+        izmir_usage("empty cache directory in ", arg);
+      cl->cache_dir = arg + 12;
+    } else if (handle_options && !strncmp(arg, "--output-buffer-size=", 21))
+      cl->output_buffer_size = izmir_parse_natural(arg + 21, arg);
+    else if (handle_options && !strncmp(arg, "--output-fd=", 12))
+      cl->output_fd = izmir_parse_natural(arg + 12, arg);
+    else if (handle_options && !strcmp(arg, "--no-output-fd"))
+      cl->output_fd = -1;
+    else if (handle_options && !strcmp(arg, "--no-cache"))
+      cl->cache_dir = NULL;
+    else if (handle_options && !strcmp(arg, "--array-kernels=auto"))
+      cl->array_kernel_set = izmir_array_kernel_set_automatic;
+    else if (handle_options && !strcmp(arg, "--array-kernels=portable"))
+      cl->array_kernel_set = izmir_array_kernel_set_portable;
+    else if (handle_options && !strcmp(arg, "--array-kernels=sse4.2"))
+      cl->array_kernel_set = izmir_array_kernel_set_sse4_2;
+    else if (handle_options && !strcmp(arg, "--array-kernels=avx2"))
+      cl->array_kernel_set = izmir_array_kernel_set_avx2;
+    else if (handle_options && !strncmp(arg, "--array-kernels=", 16))
+      izmir_usage("unknown array kernel set in ", arg);
     else if (handle_options && !strcmp(arg, "--stack"))
       cl->code_generator = izmir_code_generator_stack;
     else if (handle_options && !strcmp(arg, "--register"))
@@ -290,6 +550,14 @@ static void izmir_parse_command_line(struct izmir_command_line *cl, int argc,
       cl->dry_run = true;
     else if (handle_options && !strcmp(arg, "--no-dry-run"))
       cl->dry_run = false;
+    else if (handle_options && !strcmp(arg, "--time"))
+      cl->time = true;
+    else if (handle_options && !strcmp(arg, "--no-time"))
+      cl->time = false;
+    else if (handle_options && !strcmp(arg, "--perf-map"))
+      cl->perf_map = true;
+    else if (handle_options && !strcmp(arg, "--no-perf-map"))
+      cl->perf_map = false;
     else if (handle_options && strlen(arg) > 1 && arg[0] == '-')
       izmir_usage("unrecognized option ", arg);
     else if (handle_options && strlen(arg) > 1 && arg[0] != '-')
@@ -298,50 +566,203 @@ static void izmir_parse_command_line(struct izmir_command_line *cl, int argc,
       izmir_set_command_line_program(cl, arg);
   }
 
-  /* Still not having a program name at the end is an error. */
-  if (cl->program_path == NULL)
+  /* Still not having a program name at the end is an error, except for a
+     server, which receives programs later. */
+  if (cl->server && cl->program_path != NULL)
+    izmir_usage("a server takes no program; remove ", cl->program_path);
+  if (cl->server &&
+      (cl->inputs_path != NULL || cl->profile_specialized ||
+       cl->profile_unspecialized || cl->profile_json_path != NULL))
+    izmir_usage("--server cannot be combined with --inputs or profiles", "");
+  if (!cl->server && cl->program_path == NULL)
     izmir_usage("program name missing", "");
+  if (!IZMIR_PROFILE_AVAILABLE &&
+      (cl->profile_specialized || cl->profile_unspecialized ||
+       cl->profile_json_path != NULL))
+    izmir_usage("profiling is disabled in this build; reconfigure with "
+                "-DIZMIR_PROFILE_COUNT=ON or -DIZMIR_PROFILE_SAMPLE=ON",
+                "");
+  if (cl->inputs_path != NULL &&
+      (cl->profile_specialized || cl->profile_unspecialized ||
+       cl->profile_json_path != NULL))
+    izmir_usage("profiles are per run, and cannot be shown with ",
+                "--inputs");
+  if (!IZMIR_PERF_MAP_AVAILABLE && cl->perf_map)
+    izmir_usage("--perf-map needs replicated code; use "
+                "--dispatch=no-threading or --dispatch=minimal-threading",
+                "");
 }
 
-static void izmir_compile_expression(struct izmir_expression *exp) {
-  switch (exp->case_)
-  {
-    case izmir_expression_case_literal:
-      printf("pushconstant %li\n", (long)exp->literal);
-      break;
-    default:
-      printf("NOT SUPPORTED\n");
-      break;
-  }
-  // printf("pushconstant 42\n");
+/* Phase timing.
+ * ************************************************************************** */
+
+/* The time spent in each phase of the current run, in seconds.  Reading or
+   mapping a cached entry counts as compilation, and so does building the VM
+   routine from recorded code. */
+struct izmir_phase_times {
+  double parse;
+  double compile;
+  double specialize;
+  double execute;
+};
+
+/* The phase times of this run, for --time . */
+static struct izmir_phase_times izmir_times;
+
+/* Return the current time in seconds, from an arbitrary origin. */
+static double izmir_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
 }
 
-static void izmir_compile_statement(struct izmir_statement *st) {
-  switch (st->case_) {
-  case izmir_statement_case_skip:
-    printf("# skip\n");
-    break;
-  case izmir_statement_case_assignment:
-    printf("Case not implemented\n");
-    break;
-  case izmir_statement_case_print:
-    // this is where I am for print(1 + 2);
-    izmir_compile_expression(st->print_expression);
-    printf("print\n");
+/* Print the phase times of this run, and the given number of executed
+   instructions unless negative, as a CSV line on stderr. */
+static void izmir_print_times(long long instruction_no) {
+  fprintf(stderr, "%.9f,%.9f,%.9f,%.9f,", izmir_times.parse,
+          izmir_times.compile, izmir_times.specialize, izmir_times.execute);
+  if (instruction_no >= 0)
+    fprintf(stderr, "%lli", instruction_no);
+  fprintf(stderr, "\n");
+}
+
+/* Code generation.
+ * ************************************************************************** */
+
+/* Append to the pointed code the translation of the pointed program, according
+   to the options in the pointed command line.  Destroy the program, which is
+   not needed after code generation. */
+static void izmir_compile_program(struct izmir_command_line *cl,
+                                  struct izmir_program *p,
+                                  struct izmir_code *c) {
+  double start = izmir_now();
+
+  /* Optimization and code generation may spread procedures across threads;
+     the result is the same with any number of them. */
+  izmir_job_no = izmir_thread_no(cl->job_no);
+
+  /* Code generators read their settings from process-wide variables. */
+  izmir_tail_calls = cl->tail_calls;
+
+  /* Check names and assign frame slots, then inline small procedures and
+     simplify the AST in place unless optimization was disabled.  Inlining
+     comes first, so that constant actuals are folded into inlined bodies. */
+  izmir_resolve_program(p);
+  if (cl->optimization_level > 0) {
+    izmir_inline_program(p, cl->inline_budget);
+    izmir_optimize_program(p);
+  }
+
+  switch (cl->code_generator) {
+  case izmir_code_generator_stack:
+    izmir_generate_program_stack(c, p);
     break;
-  case izmir_statement_case_sequence:
-    izmir_compile_statement(st->sequence_statement_0);
-    izmir_compile_statement(st->sequence_statement_1);
+  case izmir_code_generator_register:
+    izmir_generate_program_register(c, p);
     break;
   default:
-    // printf("nothing default");
-    exit(EXIT_FAILURE);
+    jitter_fatal("invalid code generator");
   }
+
+  /* The code does not refer to the AST, which can be released at once. */
+  izmir_program_destroy(p);
+  izmir_times.compile += izmir_now() - start;
 }
 
-static void izmir_compile_program(struct izmir_program *p) {
-  izmir_compile_statement(p->main_statement);
-  // printf("not anything useful yet\n");
+/* Return a malloc-allocated buffer holding the whole contents of the file with
+   the given pathname, or of the standard input if the pathname is "-", and
+   store its size into *size . */
+static char *izmir_read_source(const char *path, size_t *size) {
+  FILE *f = !strcmp(path, "-") ? stdin : fopen(path, "r");
+  if (f == NULL)
+    jitter_fatal("failed opening file %s", path);
+
+  size_t allocated_size = 4096;
+  char *res = jitter_xmalloc(allocated_size);
+  *size = 0;
+  size_t read_size;
+  while ((read_size = fread(res + *size, 1, allocated_size - *size, f)) > 0) {
+    *size += read_size;
+    if (*size == allocated_size) {
+      allocated_size *= 2;
+      res = jitter_xrealloc(res, allocated_size);
+    }
+  }
+  if (ferror(f))
+    jitter_fatal("failed reading %s", path);
+  if (f != stdin)
+    fclose(f);
+  return res;
+}
+
+/* Initialize the pointed code to hold the translation of the program named in
+   the pointed command line.  When a cache directory is given, reuse the code
+   compiled by a previous run for the same source and options if any, and
+   otherwise save the new code there. */
+static void izmir_obtain_code(struct izmir_command_line *cl,
+                              struct izmir_code *c) {
+  const char *file_name =
+      !strcmp(cl->program_path, "-") ? "<stdin>" : cl->program_path;
+
+  /* Without a cache, parse straight from the file. */
+  double start = izmir_now();
+  if (cl->cache_dir == NULL) {
+    struct izmir_program *p;
+    if (!strcmp(cl->program_path, "-"))
+      p = izmir_parse_file_star(stdin);
+    else
+      p = izmir_parse_file(cl->program_path);
+    izmir_times.parse += izmir_now() - start;
+    izmir_code_initialize(c);
+    izmir_compile_program(cl, p, c);
+    return;
+  }
+
+  /* With a cache the source must be read into memory anyway, to hash it. */
+  size_t source_size;
+  char *source = izmir_read_source(cl->program_path, &source_size);
+  char configuration[96];
+  snprintf(configuration, sizeof(configuration),
+           "%s -O%i%s --inline-budget=%lu",
+           (cl->code_generator == izmir_code_generator_stack) ? "--stack"
+                                                               : "--register",
+           cl->optimization_level, cl->tail_calls ? "" : " --no-tail-calls",
+           (unsigned long)cl->inline_budget);
+  izmir_cache_key key =
+      izmir_cache_make_key(source, source_size, configuration);
+  bool hit = izmir_cache_load(cl->cache_dir, key, source, source_size,
+                              configuration, c);
+  izmir_times.compile += izmir_now() - start;
+  if (!hit) {
+    start = izmir_now();
+    struct izmir_program *p =
+        izmir_parse_memory(source, source_size, file_name);
+    izmir_times.parse += izmir_now() - start;
+    izmir_code_initialize(c);
+    izmir_compile_program(cl, p, c);
+    izmir_cache_store(cl->cache_dir, key, source, source_size, configuration,
+                      c);
+  }
+  free(source);
+}
+
+/* Return a fresh VM routine containing the pointed code, built according to
+   the options in the pointed command line.  If lines is not NULL initialize
+   the pointed table with the source line of each routine instruction. */
+static izmirvm_routine izmir_make_routine(struct izmir_command_line *cl,
+                                          const struct izmir_code *c,
+                                          struct izmir_code_lines *lines) {
+  double start = izmir_now();
+  izmirvm_routine r = izmirvm_make_routine();
+  jitter_set_mutable_routine_option_slow_literals_only(r,
+                                                       cl->slow_literals_only);
+  jitter_set_mutable_routine_option_slow_registers_only(
+      r, cl->slow_registers_only);
+  jitter_set_mutable_routine_option_optimization_rewriting(
+      r, cl->optimization_rewriting);
+  izmir_code_to_routine(c, r, lines);
+  izmir_times.compile += izmir_now() - start;
+  return r;
 }
 
 /* Execute what the command line says.
@@ -349,14 +770,224 @@ static void izmir_compile_program(struct izmir_program *p) {
 
 /* Do what the pointed command line data structure says. */
 static void izmir_work(struct izmir_command_line *cl) {
-  /* Parse a izmir-language program into an AST. */
-  struct izmir_program *p;
-  if (!strcmp(cl->program_path, "-"))
-    p = izmir_parse_file_star(stdin);
+  /* Initialize the VM subsystem. */
+  izmirvm_initialize();
+  izmir_array_requested_kernel_set = cl->array_kernel_set;
+
+  /* Translate the program into VM code, or load it from the cache, and build
+     a VM routine from it in memory: there is no need to go through the
+     textual representation unless the user asked to see it. */
+  struct izmir_code c;
+  izmir_obtain_code(cl, &c);
+  struct izmir_code_lines lines;
+  izmirvm_routine r = izmir_make_routine(cl, &c, cl->perf_map ? &lines : NULL);
+  izmir_code_finalize(&c);
+
+  /* Specialize the routine now rather than at the beginning of execution, so
+     that specialization can be timed separately. */
+  if (!cl->dry_run) {
+    double start = izmir_now();
+    jitter_routine_make_executable_if_needed(r);
+    izmir_times.specialize = izmir_now() - start;
+  }
+
+  /* Describe the native code for perf, if requested, before running it. */
+  if (cl->perf_map) {
+    jitter_routine_make_executable_if_needed(r);
+    izmir_perf_map_write(
+        r, &lines,
+        !strcmp(cl->program_path, "-") ? "<stdin>" : cl->program_path);
+    izmir_code_lines_finalize(&lines);
+  }
+
+  /* Print, disassemble and show data locations, if requested. */
+  jitter_print_context ctx = jitter_print_context_make_file_star(stdout);
+  if (cl->print_locations)
+    izmirvm_dump_data_locations(ctx);
+  if (cl->print)
+    izmirvm_routine_print(ctx, r);
+  if (cl->disassemble)
+    izmirvm_routine_disassemble(
+        ctx, r, true, cl->cross_disassemble ? JITTER_CROSS_OBJDUMP : JITTER_OBJDUMP,
+        NULL);
+  jitter_print_context_destroy(ctx);
+
+  /* Run the routine in this same process, unless this is a dry run: once per
+     listed input in a batch, timed as a whole, or else just once. */
+  long long instruction_no = -1;
+  size_t failed_no = 0;
+  if (!cl->dry_run && cl->inputs_path != NULL) {
+    fflush(stdout);
+    izmir_output_default_size = cl->output_buffer_size;
+    size_t input_no;
+    char **input_paths = izmir_batch_read_list(cl->inputs_path, &input_no);
+    double start = izmir_now();
+    instruction_no =
+        izmir_batch_run(r, input_paths, input_no,
+                        izmir_thread_no(cl->thread_no), &failed_no);
+    izmir_times.execute = izmir_now() - start;
+    izmir_batch_destroy_list(input_paths, input_no);
+  } else if (!cl->dry_run) {
+    /* Output from the VM may bypass stdio, so what was printed so far must be
+       out first. */
+    fflush(stdout);
+    izmir_output_default_size = cl->output_buffer_size;
+    izmir_output_default_fd = cl->output_fd;
+    struct izmirvm_state s;
+    izmirvm_state_initialize(&s);
+#if defined(JITTER_PROFILE_SAMPLE)
+    izmirvm_profile_sample_start(&s);
+#endif
+    double start = izmir_now();
+    izmirvm_execute_routine(r, &s);
+    izmir_times.execute = izmir_now() - start;
+#if defined(JITTER_PROFILE_SAMPLE)
+    izmirvm_profile_sample_stop();
+#endif
+    instruction_no = izmir_profile_executed_instruction_no(&s);
+
+    /* Show the profiles, if requested, after the program output. */
+    izmir_output_flush(&s.izmirvm_state_runtime.output);
+    ctx = jitter_print_context_make_file_star(stdout);
+    if (cl->profile_unspecialized)
+      izmir_profile_print(ctx, &s, false);
+    if (cl->profile_specialized)
+      izmir_profile_print(ctx, &s, true);
+    jitter_print_context_destroy(ctx);
+    if (cl->profile_json_path != NULL)
+      izmir_profile_write_json(cl->profile_json_path, &s);
+    izmirvm_state_finalize(&s);
+  }
+  if (cl->time)
+    izmir_print_times(instruction_no);
+
+  izmirvm_destroy_routine(r);
+  izmirvm_finalize();
+
+  /* Runs stopped by an error were reported already, but still make the whole
+     batch fail. */
+  if (failed_no > 0)
+    exit(EXIT_FAILURE);
+}
+
+/* Server mode.
+ * ************************************************************************** */
+
+/* The state of a server session, kept from one request to the next. */
+struct izmir_session {
+  /* The command line, with the compilation options. */
+  struct izmir_command_line *cl;
+
+  /* The VM state running every program, and whether it is initialized.  An
+     error interrupting a program may leave the state anywhere, so it is then
+     finalized and initialized again for the next request. */
+  struct izmirvm_state state;
+  bool state_initialized;
+
+  /* What the current request holds, to be released if it fails: the program
+     until it is compiled, the code until it becomes a routine, and the
+     routine, which is running iff running is true. */
+  struct izmir_program *program;
+  struct izmir_code code;
+  bool code_initialized;
+  izmirvm_routine routine;
+  bool running;
+
+  /* The message of the last error. */
+  char message[IZMIR_ERROR_MAX_MESSAGE_SIZE];
+};
+
+/* Compile and run the program of the pointed request in the session pointed
+   by data, filling the pointed reply.  This is the server handler.  Every
+   error in the program or in its input is reported back, and whatever the
+   request allocated is released before returning. */
+static void izmir_serve_request(void *data,
+                                const struct izmir_server_request *rq,
+                                struct izmir_server_reply *reply) {
+  struct izmir_session *ss = data;
+  if (!ss->state_initialized) {
+    izmirvm_state_initialize(&ss->state);
+    izmir_output_keep_in_memory(&ss->state.izmirvm_state_runtime.output);
+    ss->state_initialized = true;
+  }
+  struct izmir_output *o = &ss->state.izmirvm_state_runtime.output;
+  izmir_output_discard(o);
+  izmir_input_set_memory(&ss->state.izmirvm_state_runtime.input, rq->input,
+                         rq->input_size);
+
+  struct izmir_recovery recovery;
+  if (setjmp(recovery.jump) == 0) {
+    izmir_recovery_push(&recovery);
+    ss->program =
+        izmir_parse_memory(rq->program, rq->program_size, "<request>");
+    izmir_code_initialize(&ss->code);
+    ss->code_initialized = true;
+    izmir_compile_program(ss->cl, ss->program, &ss->code);
+    ss->program = NULL;
+    ss->routine = izmir_make_routine(ss->cl, &ss->code, NULL);
+    izmir_code_finalize(&ss->code);
+    ss->code_initialized = false;
+    ss->running = true;
+    izmirvm_execute_routine(ss->routine, &ss->state);
+    ss->running = false;
+    izmir_recovery_pop(&recovery);
+
+    /* Objects allocated by one program are garbage for the next. */
+    izmir_heap_finalize(&ss->state.izmirvm_state_runtime.heap);
+    izmir_heap_initialize(&ss->state.izmirvm_state_runtime.heap);
+    reply->ok = true;
+    reply->text = o->buffer;
+    reply->text_size = o->used;
+  } else {
+    if (ss->program != NULL) {
+      izmir_program_destroy(ss->program);
+      ss->program = NULL;
+    }
+    if (ss->code_initialized) {
+      izmir_code_finalize(&ss->code);
+      ss->code_initialized = false;
+    }
+    if (ss->running) {
+      izmirvm_state_finalize(&ss->state);
+      ss->state_initialized = false;
+      ss->running = false;
+    }
+    strcpy(ss->message, recovery.message);
+    reply->ok = false;
+    reply->text = ss->message;
+    reply->text_size = strlen(ss->message);
+  }
+  if (ss->routine != NULL) {
+    izmirvm_destroy_routine(ss->routine);
+    ss->routine = NULL;
+  }
+}
+
+/* Serve programs as the pointed command line says, until the standard input
+   ends or forever on a socket. */
+static void izmir_serve(struct izmir_command_line *cl) {
+  izmirvm_initialize();
+  izmir_output_default_size = cl->output_buffer_size;
+  izmir_array_requested_kernel_set = cl->array_kernel_set;
+
+  struct izmir_session ss;
+  ss.cl = cl;
+  ss.state_initialized = false;
+  ss.program = NULL;
+  ss.code_initialized = false;
+  ss.routine = NULL;
+  ss.running = false;
+  /* Serving on a socket never returns, so only the standard input case gets
+     to finalization. */
+  if (cl->server_socket_path != NULL)
+    izmir_server_serve_socket(cl->server_socket_path, izmir_serve_request,
+                              &ss);
   else
-    p = izmir_parse_file(cl->program_path);
+    izmir_server_serve_stream(0, 1, izmir_serve_request, &ss);
 
-  izmir_compile_program(p);
+  if (ss.state_initialized)
+    izmirvm_state_finalize(&ss.state);
+  izmirvm_finalize();
 }
 
 /* Main function.
@@ -368,7 +999,10 @@ int main(int argc, char **argv) {
   izmir_parse_command_line(&cl, argc, argv);
 
   /* Do what was requested on the command line. */
-  izmir_work(&cl);
+  if (cl.server)
+    izmir_serve(&cl);
+  else
+    izmir_work(&cl);
 
   /* Exit with success, if we're still alive. */
   return EXIT_SUCCESS;
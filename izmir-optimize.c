@@ -0,0 +1,544 @@
+/* Izmir language: AST optimization.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdbool.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-optimize.h"
+#include "izmir-parallel.h"
+
+
+/* Expression properties.
+ * ************************************************************************** */
+
+/* Return non-false iff the pointed expression is a literal with the given
+   value. */
+static bool
+izmir_is_literal (const struct izmir_expression *e, jitter_int value)
+{
+  return e->case_ == izmir_expression_case_literal && e->literal == value;
+}
+
+/* Return non-false iff the given primitive is a comparison taking two
+   operands. */
+static bool
+izmir_is_binary_comparison_primitive (enum izmir_primitive p)
+{
+  return (izmir_is_comparison_primitive (p)
+          && p != izmir_primitive_logical_not
+          && p != izmir_primitive_is_nonzero);
+}
+
+/* Return non-false iff the pointed expression is known to evaluate to either 0
+   or 1. */
+static bool
+izmir_is_boolean (const struct izmir_expression *e)
+{
+  return ((e->case_ == izmir_expression_case_literal
+           && (e->literal == 0 || e->literal == 1))
+          || (e->case_ == izmir_expression_case_primitive
+              && izmir_is_comparison_primitive (e->primitive)));
+}
+
+
+
+
+/* Constant folding.
+ * ************************************************************************** */
+
+/* Compute the result of the given primitive on the given literal operands,
+   with the same semantics as the VM, and store it into *result.  Return
+   non-false on success, or false if the primitive cannot be evaluated at
+   compile time; in that case leave *result unchanged.  The second operand is
+   ignored for unary primitives. */
+static bool
+izmir_fold_primitive (enum izmir_primitive p, jitter_int a, jitter_int b,
+                      jitter_int *result)
+{
+  /* Do arithmetic on unsigned operands, which wrap around on overflow like
+     VM instructions do. */
+  jitter_uint ua = a, ub = b;
+  switch (p)
+    {
+    case izmir_primitive_plus:             * result = ua + ub; break;
+    case izmir_primitive_minus:            * result = ua - ub; break;
+    case izmir_primitive_times:            * result = ua * ub; break;
+    case izmir_primitive_divided:
+      if (b == 0)
+        return false;
+      * result = (b == -1) ? (jitter_int) - ua : a / b;
+      break;
+    case izmir_primitive_remainder:
+      if (b == 0)
+        return false;
+      * result = (b == -1) ? 0 : a % b;
+      break;
+    case izmir_primitive_unary_minus:      * result = - ua; break;
+    case izmir_primitive_equal:            * result = a == b; break;
+    case izmir_primitive_different:        * result = a != b; break;
+    case izmir_primitive_less:             * result = a < b; break;
+    case izmir_primitive_less_or_equal:    * result = a <= b; break;
+    case izmir_primitive_greater:          * result = a > b; break;
+    case izmir_primitive_greater_or_equal: * result = a >= b; break;
+    case izmir_primitive_logical_not:      * result = ! a; break;
+    case izmir_primitive_is_nonzero:       * result = a != 0; break;
+    default:
+      return false;
+    }
+  return true;
+}
+
+
+
+
+/* In-place expression rewriting.
+ * ************************************************************************** */
+
+/* Turn the pointed expression into a literal with the given value. */
+static void
+izmir_set_literal (struct izmir_expression *e, jitter_int value)
+{
+  e->case_ = izmir_expression_case_literal;
+  e->literal = value;
+}
+
+/* Turn the pointed expression into a copy of the pointed replacement, which
+   is usually one of its subexpressions. */
+static void
+izmir_replace (struct izmir_expression *e,
+               const struct izmir_expression *replacement)
+{
+  * e = * replacement;
+}
+
+/* Turn the pointed expression into a primitive expression with the given
+   primitive and operands. */
+static void
+izmir_set_primitive (struct izmir_expression *e, enum izmir_primitive p,
+                     struct izmir_expression *operand_0,
+                     struct izmir_expression *operand_1)
+{
+  e->case_ = izmir_expression_case_primitive;
+  e->primitive = p;
+  e->primitive_operand_0 = operand_0;
+  e->primitive_operand_1 = operand_1;
+}
+
+/* Return the primitive computing the same comparison as the given one with
+   its operands swapped: for example a < b is the same as b > a . */
+static enum izmir_primitive
+izmir_mirror_comparison_primitive (enum izmir_primitive p)
+{
+  switch (p)
+    {
+    case izmir_primitive_less:             return izmir_primitive_greater;
+    case izmir_primitive_less_or_equal:    return izmir_primitive_greater_or_equal;
+    case izmir_primitive_greater:          return izmir_primitive_less;
+    case izmir_primitive_greater_or_equal: return izmir_primitive_less_or_equal;
+    default:                               return p;
+    }
+}
+
+static void
+izmir_optimize_expression (struct izmir_expression *e);
+
+/* Optimize the pointed primitive expression in place, assuming its operands
+   are already optimized. */
+static void
+izmir_optimize_primitive (struct izmir_expression *e)
+{
+  struct izmir_expression *a = e->primitive_operand_0;
+  struct izmir_expression *b = e->primitive_operand_1;
+  jitter_int folded;
+
+  /* Fold primitives on literals. */
+  if (a != NULL
+      && a->case_ == izmir_expression_case_literal
+      && (b == NULL || b->case_ == izmir_expression_case_literal)
+      && izmir_fold_primitive (e->primitive, a->literal,
+                               (b == NULL) ? 0 : b->literal, & folded))
+    {
+      izmir_set_literal (e, folded);
+      return;
+    }
+
+  /* Move a literal first operand to the right of commutative and comparison
+     primitives, where code generators and rewrite rules expect it. */
+  if (b != NULL
+      && a->case_ == izmir_expression_case_literal
+      && b->case_ != izmir_expression_case_literal
+      && (e->primitive == izmir_primitive_plus
+          || e->primitive == izmir_primitive_times
+          || izmir_is_binary_comparison_primitive (e->primitive)))
+    {
+      struct izmir_expression *literal = a;
+      e->primitive = izmir_mirror_comparison_primitive (e->primitive);
+      e->primitive_operand_0 = a = b;
+      e->primitive_operand_1 = b = literal;
+    }
+
+  switch (e->primitive)
+    {
+    case izmir_primitive_plus:
+      if (izmir_is_literal (b, 0))
+        izmir_replace (e, a);
+      break;
+
+    case izmir_primitive_minus:
+      if (izmir_is_literal (b, 0))
+        izmir_replace (e, a);
+      else if (izmir_is_literal (a, 0))
+        izmir_set_primitive (e, izmir_primitive_unary_minus, b, NULL);
+      break;
+
+    case izmir_primitive_times:
+      if (izmir_is_literal (b, 1))
+        izmir_replace (e, a);
+      else if (izmir_is_literal (b, 0) && ! izmir_has_effects (a))
+        izmir_set_literal (e, 0);
+      else if (izmir_is_literal (b, -1))
+        izmir_set_primitive (e, izmir_primitive_unary_minus, a, NULL);
+      break;
+
+    case izmir_primitive_divided:
+      if (izmir_is_literal (b, 1))
+        izmir_replace (e, a);
+      else if (izmir_is_literal (b, -1))
+        izmir_set_primitive (e, izmir_primitive_unary_minus, a, NULL);
+      break;
+
+    case izmir_primitive_remainder:
+      if ((izmir_is_literal (b, 1) || izmir_is_literal (b, -1))
+          && ! izmir_has_effects (a))
+        izmir_set_literal (e, 0);
+      break;
+
+    case izmir_primitive_unary_minus:
+      if (a->case_ == izmir_expression_case_primitive
+          && a->primitive == izmir_primitive_unary_minus)
+        izmir_replace (e, a->primitive_operand_0);
+      break;
+
+    case izmir_primitive_logical_not:
+      if (a->case_ != izmir_expression_case_primitive)
+        break;
+      if (a->primitive == izmir_primitive_logical_not)
+        izmir_set_primitive (e, izmir_primitive_is_nonzero,
+                             a->primitive_operand_0, NULL);
+      else if (a->primitive == izmir_primitive_is_nonzero)
+        izmir_set_primitive (e, izmir_primitive_logical_not,
+                             a->primitive_operand_0, NULL);
+      else if (izmir_is_binary_comparison_primitive (a->primitive))
+        izmir_set_primitive (e,
+                             izmir_reverse_comparison_primitive (a->primitive),
+                             a->primitive_operand_0, a->primitive_operand_1);
+      else
+        break;
+      /* The result may simplify further. */
+      izmir_optimize_primitive (e);
+      break;
+
+    case izmir_primitive_is_nonzero:
+      if (izmir_is_boolean (a))
+        izmir_replace (e, a);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/* Replace the pointed condition, in place, with an equivalent condition for
+   branching, stripping negations and redundant tests; return non-false iff the
+   meaning of the condition was reversed, in which case the caller must swap
+   its branches. */
+static bool
+izmir_optimize_condition (struct izmir_expression **condition)
+{
+  bool reversed = false;
+  izmir_optimize_expression (* condition);
+  while ((* condition)->case_ == izmir_expression_case_primitive
+         && ((* condition)->primitive == izmir_primitive_logical_not
+             || (* condition)->primitive == izmir_primitive_is_nonzero))
+    {
+      if ((* condition)->primitive == izmir_primitive_logical_not)
+        reversed = ! reversed;
+      * condition = (* condition)->primitive_operand_0;
+    }
+  return reversed;
+}
+
+/* Optimize the pointed expression in place. */
+static void
+izmir_optimize_expression (struct izmir_expression *e)
+{
+  size_t i;
+  switch (e->case_)
+    {
+    case izmir_expression_case_if_then_else:
+      {
+        struct izmir_expression *condition = e->if_then_else_condition;
+        struct izmir_expression *then_branch = e->if_then_else_then_branch;
+        struct izmir_expression *else_branch = e->if_then_else_else_branch;
+        if (izmir_optimize_condition (& condition))
+          {
+            struct izmir_expression *t = then_branch;
+            then_branch = else_branch;
+            else_branch = t;
+          }
+        izmir_optimize_expression (then_branch);
+        izmir_optimize_expression (else_branch);
+        e->if_then_else_condition = condition;
+        e->if_then_else_then_branch = then_branch;
+        e->if_then_else_else_branch = else_branch;
+
+        /* Remove dead branches, and turn conditionals which just compute a
+           boolean into primitives. */
+        if (condition->case_ == izmir_expression_case_literal)
+          izmir_replace (e, (condition->literal != 0) ? then_branch : else_branch);
+        else if (izmir_is_literal (then_branch, 1)
+                 && izmir_is_literal (else_branch, 0))
+          {
+            izmir_set_primitive (e, izmir_primitive_is_nonzero, condition, NULL);
+            izmir_optimize_primitive (e);
+          }
+        else if (izmir_is_literal (then_branch, 0)
+                 && izmir_is_literal (else_branch, 1))
+          {
+            izmir_set_primitive (e, izmir_primitive_logical_not, condition,
+                                 NULL);
+            izmir_optimize_primitive (e);
+          }
+        break;
+      }
+
+    case izmir_expression_case_primitive:
+      if (e->primitive_operand_0 != NULL)
+        izmir_optimize_expression (e->primitive_operand_0);
+      if (e->primitive_operand_1 != NULL)
+        izmir_optimize_expression (e->primitive_operand_1);
+      izmir_optimize_primitive (e);
+      break;
+
+    case izmir_expression_case_call:
+      for (i = 0; i < e->actual_no; i ++)
+        izmir_optimize_expression (e->actuals [i]);
+      break;
+
+    default:
+      break;
+    }
+}
+
+
+
+
+/* Statement rewriting.
+ * ************************************************************************** */
+
+/* Turn the pointed statement into a skip statement, and return it. */
+static struct izmir_statement *
+izmir_set_skip (struct izmir_statement *s)
+{
+  s->case_ = izmir_statement_case_skip;
+  return s;
+}
+
+static struct izmir_statement *
+izmir_optimize_statement (struct izmir_statement *s);
+
+/* Optimize the given number of statements in the pointed array in place, in a
+   loop, compacting away skip statements, and return how many remain. */
+static size_t
+izmir_optimize_statements (struct izmir_statement **statements,
+                           size_t statement_no)
+{
+  size_t i, used_no = 0;
+  for (i = 0; i < statement_no; i ++)
+    {
+      struct izmir_statement *element
+        = izmir_optimize_statement (statements [i]);
+      if (element->case_ != izmir_statement_case_skip)
+        statements [used_no ++] = element;
+    }
+  return used_no;
+}
+
+/* Optimize the pointed block statement in place, walking its chain with a
+   loop: see izmir_block_inner_block .  Each inner block stays the last
+   statement of its enclosing body, since blocks are never removed. */
+static void
+izmir_optimize_block (struct izmir_statement *s)
+{
+  size_t prefix_no;
+  struct izmir_statement *inner;
+  while ((inner = izmir_block_inner_block (s, & prefix_no)) != NULL)
+    {
+      struct izmir_statement *body = s->block_body;
+      if (body->case_ == izmir_statement_case_sequence)
+        {
+          size_t used_no = izmir_optimize_statements (body->sequence_statements,
+                                                      prefix_no);
+          body->sequence_statements [used_no ++] = inner;
+          body->sequence_statement_no = used_no;
+          if (used_no == 1)
+            s->block_body = inner;
+        }
+      s = inner;
+    }
+  s->block_body = izmir_optimize_statement (s->block_body);
+}
+
+/* Return an optimized version of the pointed statement, which may be the same
+   statement modified in place or one of its substatements. */
+static struct izmir_statement *
+izmir_optimize_statement (struct izmir_statement *s)
+{
+  size_t i;
+  switch (s->case_)
+    {
+    case izmir_statement_case_block:
+      izmir_optimize_block (s);
+      return s;
+
+    case izmir_statement_case_assignment:
+      izmir_optimize_expression (s->assignment_expression);
+      /* An assignment of a variable to itself does nothing. */
+      if (s->assignment_expression->case_ == izmir_expression_case_variable
+          && (s->assignment_expression->variable_slot
+              == s->assignment_slot))
+        return izmir_set_skip (s);
+      return s;
+
+    case izmir_statement_case_print:
+      izmir_optimize_expression (s->print_expression);
+      return s;
+
+    case izmir_statement_case_sequence:
+      {
+        /* What remains may be a single statement, or nothing. */
+        size_t used_no
+          = izmir_optimize_statements (s->sequence_statements,
+                                       s->sequence_statement_no);
+        s->sequence_statement_no = used_no;
+        if (used_no == 0)
+          return izmir_set_skip (s);
+        if (used_no == 1)
+          return s->sequence_statements [0];
+        return s;
+      }
+
+    case izmir_statement_case_if_then_else:
+      {
+        if (izmir_optimize_condition (& s->if_then_else_condition))
+          {
+            struct izmir_statement *t = s->if_then_else_then_branch;
+            s->if_then_else_then_branch = s->if_then_else_else_branch;
+            s->if_then_else_else_branch = t;
+          }
+        s->if_then_else_then_branch
+          = izmir_optimize_statement (s->if_then_else_then_branch);
+        s->if_then_else_else_branch
+          = izmir_optimize_statement (s->if_then_else_else_branch);
+        struct izmir_expression *condition = s->if_then_else_condition;
+        if (condition->case_ == izmir_expression_case_literal)
+          return ((condition->literal != 0)
+                  ? s->if_then_else_then_branch
+                  : s->if_then_else_else_branch);
+        if (s->if_then_else_then_branch->case_ == izmir_statement_case_skip
+            && s->if_then_else_else_branch->case_ == izmir_statement_case_skip
+            && ! izmir_has_effects (condition))
+          return izmir_set_skip (s);
+        return s;
+      }
+
+    case izmir_statement_case_repeat_until:
+      s->repeat_until_body = izmir_optimize_statement (s->repeat_until_body);
+      izmir_optimize_expression (s->repeat_until_guard);
+      /* A loop whose guard is always true runs its body exactly once. */
+      if (s->repeat_until_guard->case_ == izmir_expression_case_literal
+          && s->repeat_until_guard->literal != 0)
+        return s->repeat_until_body;
+      return s;
+
+    case izmir_statement_case_return:
+      izmir_optimize_expression (s->return_result);
+      return s;
+
+    case izmir_statement_case_call:
+      for (i = 0; i < s->actual_no; i ++)
+        izmir_optimize_expression (s->actuals [i]);
+      return s;
+
+    case izmir_statement_case_element_assignment:
+      izmir_optimize_expression (s->element_array);
+      izmir_optimize_expression (s->element_index);
+      izmir_optimize_expression (s->element_value);
+      return s;
+
+    case izmir_statement_case_bulk:
+      for (i = 0; i < s->bulk_operand_no; i ++)
+        izmir_optimize_expression (s->bulk_operands [i]);
+      return s;
+
+    case izmir_statement_case_inlined:
+      /* Exits point to the inlined statement, which must stay even when its
+         body becomes a single statement. */
+      s->inlined_body = izmir_optimize_statement (s->inlined_body);
+      if (s->inlined_body->case_ == izmir_statement_case_skip)
+        return izmir_set_skip (s);
+      return s;
+
+    default:
+      return s;
+    }
+}
+
+
+
+
+/* Program rewriting.
+ * ************************************************************************** */
+
+/* Optimize the body of the procedure with the given index in the pointed
+   program, or the main statement if the index is the number of procedures.
+   This is a parallel task for izmir_parallel_for : procedure bodies share no
+   statement or expression, so they can be rewritten concurrently. */
+static void
+izmir_optimize_procedure (void *program_as_void_star, size_t index)
+{
+  struct izmir_program *p = program_as_void_star;
+  if (index == p->procedure_no)
+    p->main_statement = izmir_optimize_statement (p->main_statement);
+  else
+    p->procedures [index]->body
+      = izmir_optimize_statement (p->procedures [index]->body);
+}
+
+void
+izmir_optimize_program (struct izmir_program *p)
+{
+  izmir_parallel_for (izmir_job_no, p->procedure_no + 1,
+                      izmir_optimize_procedure, p);
+}
@@ -0,0 +1,52 @@
+/* Izmir language: AST optimization.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_OPTIMIZE_H_
+#define IZMIR_OPTIMIZE_H_
+
+#include "izmir-syntax.h"
+
+
+/* AST optimization.
+ * ************************************************************************** */
+
+/* Rewrite the pointed program AST into an equivalent one which is cheaper to
+   execute, before code generation.  The pass folds constant primitives,
+   simplifies algebraic identities, moves literal operands of commutative
+   primitives to the right so that code generators can recognize them,
+   collapses double negations and negated comparisons, and removes dead
+   branches, trivial loops and skip statements.
+
+   The program must have been resolved (see izmir-resolve.h), and the
+   rewritten AST keeps its resolution.  Expressions are rewritten in place
+   where possible, so that subexpressions shared by more than one parent, such
+   as the guard of a desugared while loop, stay consistent.  Statements no
+   longer reachable from the program are simply abandoned.
+
+   Procedures are optimized in parallel when more than one job is enabled
+   (see izmir-parallel.h). */
+void
+izmir_optimize_program (struct izmir_program *p);
+
+
+#endif // #ifndef IZMIR_OPTIMIZE_H_
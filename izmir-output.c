@@ -0,0 +1,248 @@
+/* Izmir language: buffered integer output for the print instructions.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-output.h"
+
+
+/* Global settings.
+ * ************************************************************************** */
+
+size_t izmir_output_default_size = IZMIR_OUTPUT_DEFAULT_SIZE;
+int izmir_output_default_fd = -1;
+
+
+
+
+/* Live outputs.
+ * ************************************************************************** */
+
+/* The first output in the doubly-linked list of initialized and not yet
+   finalized outputs, or NULL. */
+static struct izmir_output *izmir_live_outputs = NULL;
+
+/* Non-false iff izmir_output_flush_all is registered with atexit . */
+static bool izmir_output_atexit_registered = false;
+
+/* The lock protecting the list of live outputs and the variable above, since
+   states may be initialized and finalized by different threads. */
+static pthread_mutex_t izmir_live_outputs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Flush every live output.  This runs at exit, including after a fatal
+   error. */
+static void
+izmir_output_flush_all (void)
+{
+  struct izmir_output *o;
+  for (o = izmir_live_outputs; o != NULL; o = o->next)
+    {
+      /* A failing flush would exit again from within an exit handler. */
+      if (o->used > 0 && ! o->in_memory)
+        {
+          if (o->fd < 0)
+            fwrite (o->buffer, 1, o->used, stdout);
+          else
+            while (write (o->fd, o->buffer, o->used) < 0 && errno == EINTR)
+              ;
+          o->used = 0;
+        }
+    }
+}
+
+
+
+
+/* Writing.
+ * ************************************************************************** */
+
+/* Write every byte in the given iovec array of the given length to the given
+   file descriptor, retrying after partial writes.  Fail fatally on error. */
+static void
+izmir_output_writev (int fd, struct iovec *iov, int iov_no)
+{
+  while (iov_no > 0)
+    {
+      ssize_t written = writev (fd, iov, iov_no);
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          jitter_fatal ("could not write output");
+        }
+
+      /* Skip the completely written elements, and advance within the first
+         partially written one. */
+      while (iov_no > 0 && (size_t) written >= iov->iov_len)
+        {
+          written -= iov->iov_len;
+          iov ++;
+          iov_no --;
+        }
+      if (iov_no > 0)
+        {
+          iov->iov_base = (char *) iov->iov_base + written;
+          iov->iov_len -= written;
+        }
+    }
+}
+
+/* Write the used part of the buffer of the pointed output followed by the
+   given extra bytes, which may be none, and empty the buffer.  If the output
+   is kept in memory append the extra bytes to the buffer instead, growing
+   it. */
+static void
+izmir_output_write (struct izmir_output *o, const char *extra,
+                    size_t extra_size)
+{
+  if (o->in_memory)
+    {
+      while (o->size - o->used < extra_size)
+        {
+          o->size *= 2;
+          o->buffer = jitter_xrealloc (o->buffer, o->size);
+        }
+      memcpy (o->buffer + o->used, extra, extra_size);
+      o->used += extra_size;
+      return;
+    }
+  else if (o->fd < 0)
+    {
+      if (fwrite (o->buffer, 1, o->used, stdout) != o->used
+          || fwrite (extra, 1, extra_size, stdout) != extra_size)
+        jitter_fatal ("could not write output");
+    }
+  else
+    {
+      struct iovec iov [2];
+      iov [0].iov_base = o->buffer;
+      iov [0].iov_len = o->used;
+      iov [1].iov_base = (char *) extra;
+      iov [1].iov_len = extra_size;
+      izmir_output_writev (o->fd, iov, 2);
+    }
+  o->used = 0;
+}
+
+
+
+
+/* Output operations.
+ * ************************************************************************** */
+
+void
+izmir_output_initialize (struct izmir_output *o)
+{
+  o->size = izmir_output_default_size;
+  if (o->size > 0 && o->size < IZMIR_OUTPUT_MAX_LINE_SIZE)
+    o->size = IZMIR_OUTPUT_MAX_LINE_SIZE;
+  o->buffer = (o->size > 0) ? jitter_xmalloc (o->size) : NULL;
+  o->used = 0;
+  o->fd = izmir_output_default_fd;
+  o->in_memory = false;
+
+  pthread_mutex_lock (& izmir_live_outputs_lock);
+  o->previous = NULL;
+  o->next = izmir_live_outputs;
+  if (izmir_live_outputs != NULL)
+    izmir_live_outputs->previous = o;
+  izmir_live_outputs = o;
+  if (! izmir_output_atexit_registered)
+    {
+      atexit (izmir_output_flush_all);
+      izmir_output_atexit_registered = true;
+    }
+  pthread_mutex_unlock (& izmir_live_outputs_lock);
+}
+
+void
+izmir_output_finalize (struct izmir_output *o)
+{
+  izmir_output_flush (o);
+  if (o->fd < 0 && ! o->in_memory)
+    fflush (stdout);
+  free (o->buffer);
+
+  pthread_mutex_lock (& izmir_live_outputs_lock);
+  if (o->previous != NULL)
+    o->previous->next = o->next;
+  else
+    izmir_live_outputs = o->next;
+  if (o->next != NULL)
+    o->next->previous = o->previous;
+  pthread_mutex_unlock (& izmir_live_outputs_lock);
+}
+
+void
+izmir_output_keep_in_memory (struct izmir_output *o)
+{
+  if (o->size < IZMIR_OUTPUT_MAX_LINE_SIZE)
+    {
+      o->size = IZMIR_OUTPUT_DEFAULT_SIZE;
+      o->buffer = jitter_xrealloc (o->buffer, o->size);
+    }
+  o->in_memory = true;
+}
+
+void
+izmir_output_discard (struct izmir_output *o)
+{
+  o->used = 0;
+  if (o->size > IZMIR_OUTPUT_DEFAULT_SIZE)
+    {
+      o->size = IZMIR_OUTPUT_DEFAULT_SIZE;
+      o->buffer = jitter_xrealloc (o->buffer, o->size);
+    }
+}
+
+void
+izmir_output_flush (struct izmir_output *o)
+{
+  if (o->used > 0 && ! o->in_memory)
+    izmir_output_write (o, NULL, 0);
+}
+
+void
+izmir_output_print_slow (struct izmir_output *o, jitter_int n)
+{
+  /* Without a buffer, print to stdout as the VM did before output was
+     buffered. */
+  if (o->size == 0 && o->fd < 0)
+    {
+      printf ("%li\n", (long) n);
+      return;
+    }
+
+  /* Write the full buffer, if any, and the new line together. */
+  char line [IZMIR_OUTPUT_MAX_LINE_SIZE];
+  size_t line_size = izmir_output_format (line, n);
+  izmir_output_write (o, line, line_size);
+}
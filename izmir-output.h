@@ -0,0 +1,193 @@
+/* Izmir language: buffered integer output for the print instructions.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_OUTPUT_H_
+#define IZMIR_OUTPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <jitter/jitter.h>
+
+
+/* About output.
+ * ************************************************************************** */
+
+/* Every izmirvm state owns one output buffer, where the print instructions
+   format integers in decimal, one per line, without going through stdio:
+   there is no format string to parse, no locale to consult and no stream lock
+   to take for each number.  The buffer is flushed when it fills up, when the
+   program reads input, when the state is finalized and when the process
+   exits, including after a fatal error.
+
+   A flush writes to the standard output stream, so that output keeps its
+   order with respect to anything else printed through stdio, or else directly
+   to a file descriptor with writev , bypassing stdio altogether.
+
+   A buffer size of zero selects the unbuffered path, printing each number
+   with printf ; it is only useful for comparison.
+
+   An output may instead keep everything in memory, growing its buffer as
+   needed and never writing it anywhere; the server uses this to send the
+   output of each program back as a whole. */
+
+/* The size of the longest line which printing one integer can produce: a
+   sign, the digits of the most negative 64-bit integer and a newline. */
+#define IZMIR_OUTPUT_MAX_LINE_SIZE  21
+
+/* The default buffer size in bytes. */
+#define IZMIR_OUTPUT_DEFAULT_SIZE  65536
+
+
+
+
+/* Output data structures.
+ * ************************************************************************** */
+
+/* An output buffer. */
+struct izmir_output
+{
+  /* The malloc-allocated buffer, or NULL if size is zero. */
+  char *buffer;
+
+  /* The allocated size of buffer , in bytes. */
+  size_t size;
+
+  /* The number of used bytes at the beginning of buffer . */
+  size_t used;
+
+  /* The file descriptor to write to, or -1 to write to stdout . */
+  int fd;
+
+  /* Non-false iff the output is kept in memory, in which case fd is
+     ignored. */
+  bool in_memory;
+
+  /* The previous and next output in the list of live outputs, flushed at
+     exit. */
+  struct izmir_output *previous;
+  struct izmir_output *next;
+};
+
+/* The buffer size and file descriptor for outputs initialized from now on.
+   These are process-wide settings, meant to be set once from the command
+   line before any VM state is initialized. */
+extern size_t izmir_output_default_size;
+extern int izmir_output_default_fd;
+
+
+
+
+/* Output operations.
+ * ************************************************************************** */
+
+/* Initialize the pointed output with the current default size and file
+   descriptor. */
+void
+izmir_output_initialize (struct izmir_output *o);
+
+/* Flush and finalize the pointed output. */
+void
+izmir_output_finalize (struct izmir_output *o);
+
+/* Make the pointed output, just initialized, keep what is printed in memory
+   from now on. */
+void
+izmir_output_keep_in_memory (struct izmir_output *o);
+
+/* Empty the pointed output, which is kept in memory, without writing it, and
+   give back the memory it grew beyond the default size. */
+void
+izmir_output_discard (struct izmir_output *o);
+
+/* Write the contents of the pointed output buffer and empty it, unless the
+   output is kept in memory.  Fail fatally on write errors. */
+void
+izmir_output_flush (struct izmir_output *o);
+
+/* Print the given integer to the pointed output when the buffer has no room
+   for it, or is disabled.  This is the out-of-line part of
+   izmir_output_print . */
+void
+izmir_output_print_slow (struct izmir_output *o, jitter_int n);
+
+/* Write the given integer in decimal followed by a newline starting at the
+   given address, and return the number of written characters, at most
+   IZMIR_OUTPUT_MAX_LINE_SIZE . */
+static inline size_t
+izmir_output_format (char *p, jitter_int n)
+{
+  /* Digits are generated two at a time from the right, into a temporary
+     buffer, and then copied into place with a single memcpy . */
+  static const char digit_pairs [201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+  char digits [IZMIR_OUTPUT_MAX_LINE_SIZE];
+  char *end = digits + IZMIR_OUTPUT_MAX_LINE_SIZE;
+  char *q = end;
+  * -- q = '\n';
+  jitter_uint u = (n < 0) ? - (jitter_uint) n : (jitter_uint) n;
+  while (u >= 100)
+    {
+      jitter_uint pair = u % 100;
+      u /= 100;
+      q -= 2;
+      memcpy (q, digit_pairs + 2 * pair, 2);
+    }
+  if (u >= 10)
+    {
+      q -= 2;
+      memcpy (q, digit_pairs + 2 * u, 2);
+    }
+  else
+    * -- q = '0' + u;
+  if (n < 0)
+    * -- q = '-';
+  size_t length = end - q;
+  memcpy (p, q, length);
+  return length;
+}
+
+/* Print the given integer in decimal followed by a newline to the pointed
+   output. */
+static inline void
+izmir_output_print (struct izmir_output *o, jitter_int n)
+{
+  if (__builtin_expect (o->size - o->used >= IZMIR_OUTPUT_MAX_LINE_SIZE,
+                        true))
+    o->used += izmir_output_format (o->buffer + o->used, n);
+  else
+    izmir_output_print_slow (o, n);
+}
+
+
+#endif // #ifndef IZMIR_OUTPUT_H_
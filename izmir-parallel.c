@@ -0,0 +1,100 @@
+/* Izmir language: running independent tasks in parallel.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-parallel.h"
+
+
+/* Global settings.
+ * ************************************************************************** */
+
+size_t izmir_job_no = 1;
+
+
+
+
+/* Parallel loops.
+ * ************************************************************************** */
+
+/* The state of a parallel loop, shared by every thread running it. */
+struct izmir_parallel_loop
+{
+  /* The task, its data and the number of indices. */
+  izmir_parallel_task task;
+  void *data;
+  size_t task_no;
+
+  /* The next index to hand out, updated atomically. */
+  size_t next_index;
+};
+
+/* Run tasks from the pointed loop until every index has been handed out.
+   This is the thread entry point, and is also called by the main thread. */
+static void *
+izmir_parallel_work (void *loop_as_void_star)
+{
+  struct izmir_parallel_loop *loop = loop_as_void_star;
+  size_t index;
+  while ((index = __atomic_fetch_add (& loop->next_index, 1,
+                                      __ATOMIC_RELAXED))
+         < loop->task_no)
+    loop->task (loop->data, index);
+  return NULL;
+}
+
+void
+izmir_parallel_for (size_t thread_no, size_t task_no,
+                    izmir_parallel_task task, void *data)
+{
+  if (thread_no > task_no)
+    thread_no = task_no;
+  if (thread_no < 2)
+    {
+      size_t i;
+      for (i = 0; i < task_no; i ++)
+        task (data, i);
+      return;
+    }
+
+  /* Start the other threads, and work along with them.  If a thread cannot be
+     created the ones already running, or just this one, do all the work. */
+  struct izmir_parallel_loop loop = { task, data, task_no, 0 };
+  pthread_t *threads = jitter_xmalloc (sizeof (pthread_t) * (thread_no - 1));
+  size_t created_no;
+  for (created_no = 0; created_no < thread_no - 1; created_no ++)
+    if (pthread_create (threads + created_no, NULL, izmir_parallel_work,
+                        & loop) != 0)
+      break;
+  izmir_parallel_work (& loop);
+
+  /* Joining makes every write done by the tasks visible to the caller. */
+  size_t i;
+  for (i = 0; i < created_no; i ++)
+    pthread_join (threads [i], NULL);
+  free (threads);
+}
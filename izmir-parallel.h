@@ -0,0 +1,55 @@
+/* Izmir language: running independent tasks in parallel.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_PARALLEL_H_
+#define IZMIR_PARALLEL_H_
+
+#include <stddef.h>
+
+
+/* Parallel loops.
+ * ************************************************************************** */
+
+/* The number of threads which compilation passes may use, including the main
+   thread.  This is a process-wide setting, meant to be set once from the
+   command line; the default is 1, compiling serially. */
+extern size_t izmir_job_no;
+
+/* A task in a parallel loop, called on the loop data and on a task index. */
+typedef void (*izmir_parallel_task) (void *data, size_t index);
+
+/* Call the given task on the given data and on every index from zero to
+   task_no - 1, using up to thread_no threads including the calling one, and
+   return when every call has returned.  Indices are handed out one at a time
+   in increasing order to whichever thread is free, so that tasks of uneven
+   cost balance out; the order of completion is unspecified, so tasks must be
+   independent.  With one thread, or fewer than two tasks, the tasks run in
+   order in the calling thread.  Compilation passes pass izmir_job_no as
+   thread_no . */
+void
+izmir_parallel_for (size_t thread_no, size_t task_no,
+                    izmir_parallel_task task, void *data);
+
+
+#endif // #ifndef IZMIR_PARALLEL_H_
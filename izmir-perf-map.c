@@ -0,0 +1,92 @@
+/* Izmir language: perf symbol maps for replicated code.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <jitter/jitter-dynamic-buffer.h>
+#include <jitter/jitter-mutable-routine.h>
+#include <jitter/jitter-replicate.h>
+
+#include "izmir-perf-map.h"
+
+
+/* Perf map output.
+ * ************************************************************************** */
+
+void
+izmir_perf_map_write (izmirvm_routine r, const struct izmir_code_lines *lines,
+                      const char *source_name)
+{
+#if defined (JITTER_REPLICATE)
+  char path [64];
+  snprintf (path, sizeof (path), "/tmp/perf-%li.map", (long) getpid ());
+  FILE *f = fopen (path, "a");
+  if (f == NULL)
+    {
+      fprintf (stderr, "warning: cannot open %s: %s\n", path,
+               strerror (errno));
+      return;
+    }
+
+  /* There is one replicated block per specialized instruction, in routine
+     order.  Every unspecialized instruction becomes exactly one specialized
+     instruction, so the blocks which are not special specialized instructions
+     correspond in order to the entries of the line table. */
+  const struct jitter_replicated_block *blocks
+    = jitter_dynamic_buffer_to_const_pointer (& r->replicated_blocks);
+  size_t block_no
+    = (jitter_dynamic_buffer_size (& r->replicated_blocks)
+       / sizeof (struct jitter_replicated_block));
+  size_t instruction_index = 0;
+  size_t i;
+  for (i = 0; i < block_no; i ++)
+    {
+      const struct jitter_replicated_block *b = blocks + i;
+      fprintf (f, "%lx %lx %s", (unsigned long) b->native_code,
+               (unsigned long) b->native_code_size,
+               izmirvm_specialized_instruction_names [b->specialized_opcode]);
+      if (izmirvm_specialized_instruction_to_unspecialized_instruction
+             [b->specialized_opcode] >= 0)
+        {
+          if (instruction_index < lines->line_no
+              && lines->lines [instruction_index] > 0)
+            fprintf (f, " %s:%i", source_name,
+                     lines->lines [instruction_index]);
+          instruction_index ++;
+        }
+      fprintf (f, "\n");
+    }
+
+  if (fclose (f) != 0)
+    fprintf (stderr, "warning: cannot write %s: %s\n", path,
+             strerror (errno));
+#else
+  /* Without replication there is nothing to map. */
+  (void) r;
+  (void) lines;
+  (void) source_name;
+#endif // #if defined (JITTER_REPLICATE)
+}
@@ -0,0 +1,79 @@
+/* Izmir language: perf symbol maps for replicated code.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_PERF_MAP_H_
+#define IZMIR_PERF_MAP_H_
+
+#include <stdbool.h>
+
+#include "izmir-code.h"
+#include "izmirvm-vm.h"
+
+
+/* About perf maps.
+ * ************************************************************************** */
+
+/* With the no-threading and minimal-threading dispatch models Jitter copies
+   the native code of each specialized instruction into memory allocated at
+   run time, where profilers find no symbols.  perf reads symbols for such
+   code from the text file /tmp/perf-PID.map , one line per address range in
+   the format
+     START SIZE NAME
+   with START and SIZE in hexadecimal.
+
+   izmir writes one range per replicated instruction, named after the
+   specialized instruction and the source line it was compiled from, so that
+   perf report attributes time to izmir statements:
+     pushconstant/nR fib.iz:7
+   Special specialized instructions such as !BEGINBASICBLOCK are named without
+   a line.
+
+   With the other dispatch models the native code of instructions is in the
+   izmir executable itself, and there is nothing to map. */
+
+/* Non-false iff this executable replicates native code, and therefore can
+   write perf maps. */
+#if defined (JITTER_REPLICATE)
+# define IZMIR_PERF_MAP_AVAILABLE  true
+#else
+# define IZMIR_PERF_MAP_AVAILABLE  false
+#endif
+
+
+
+
+/* Perf map output.
+ * ************************************************************************** */
+
+/* Append to /tmp/perf-PID.map , where PID is the process identifier, the
+   address ranges of the native code of the pointed routine, which must be
+   already executable.  The pointed line table, filled by
+   izmir_code_to_routine , gives the source line of each instruction within
+   the file with the given name.  Do nothing if native code is not replicated.
+   A failure only prints a warning, since the map is a debugging aid. */
+void
+izmir_perf_map_write (izmirvm_routine r, const struct izmir_code_lines *lines,
+                      const char *source_name);
+
+
+#endif // #ifndef IZMIR_PERF_MAP_H_
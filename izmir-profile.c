@@ -0,0 +1,251 @@
+/* Izmir language: VM execution profiles.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-profile.h"
+
+
+/* Profile entries.
+ * ************************************************************************** */
+
+/* The profile of one instruction, specialized or not. */
+struct izmir_profile_entry
+{
+  /* The instruction name. */
+  const char *name;
+
+  /* How many times the instruction was executed, or zero without count
+     profiling. */
+  uint64_t count;
+
+  /* How many samples were taken while the instruction was executing, or zero
+     without sample profiling. */
+  uint64_t sample_no;
+};
+
+/* A whole profile, in the order in which it is shown. */
+struct izmir_profile
+{
+  /* One entry per instruction, sorted by decreasing count and then by
+     decreasing sample number. */
+  struct izmir_profile_entry entries [IZMIRVM_SPECIALIZED_INSTRUCTION_NO];
+
+  /* The number of used elements in entries . */
+  size_t entry_no;
+
+  /* The sum of every count and of every sample number in entries . */
+  uint64_t total_count;
+  uint64_t total_sample_no;
+};
+
+/* A qsort comparison function for struct izmir_profile_entry objects. */
+static int
+izmir_profile_entry_compare (const void *ap, const void *bp)
+{
+  const struct izmir_profile_entry *a = ap;
+  const struct izmir_profile_entry *b = bp;
+  if (a->count != b->count)
+    return (a->count < b->count) ? 1 : -1;
+  if (a->sample_no != b->sample_no)
+    return (a->sample_no < b->sample_no) ? 1 : -1;
+  return strcmp (a->name, b->name);
+}
+
+/* Fill the pointed profile from the profile runtime of the pointed state,
+   per specialized instruction if specialized is non-false or per unspecialized
+   instruction otherwise. */
+static void
+izmir_profile_collect (struct izmir_profile *p, struct izmirvm_state *s,
+                       bool specialized)
+{
+#if IZMIR_PROFILE_AVAILABLE
+  struct izmirvm_profile_runtime *prt = izmirvm_state_profile_runtime (s);
+#endif
+
+  /* Start with one entry per instruction, all zero; specialized instructions
+     are then accumulated into the entry of their unspecialized instruction,
+     unless we are showing them separately. */
+  size_t i;
+  p->entry_no = (specialized
+                 ? IZMIRVM_SPECIALIZED_INSTRUCTION_NO
+                 : IZMIRVM_META_INSTRUCTION_NO);
+  for (i = 0; i < p->entry_no; i ++)
+    {
+      p->entries [i].name = (specialized
+                             ? izmirvm_specialized_instruction_names [i]
+                             : izmirvm_meta_instructions [i].name);
+      p->entries [i].count = 0;
+      p->entries [i].sample_no = 0;
+    }
+  for (i = 0; i < IZMIRVM_SPECIALIZED_INSTRUCTION_NO; i ++)
+    {
+      int index = i;
+      if (! specialized)
+        {
+          /* Special specialized instructions such as !BEGINBASICBLOCK have no
+             unspecialized counterpart, and are not shown. */
+          index = izmirvm_specialized_instruction_to_unspecialized_instruction
+                     [i];
+          if (index < 0)
+            continue;
+        }
+#if defined (JITTER_PROFILE_COUNT)
+      p->entries [index].count += prt->count_profile_runtime.counts [i];
+#endif
+#if defined (JITTER_PROFILE_SAMPLE)
+      p->entries [index].sample_no += prt->sample_profile_runtime.counts [i];
+#endif
+    }
+
+  /* Sort, drop the instructions which never ran, and compute totals. */
+  qsort (p->entries, p->entry_no, sizeof (struct izmir_profile_entry),
+         izmir_profile_entry_compare);
+  p->total_count = 0;
+  p->total_sample_no = 0;
+  for (i = 0; i < p->entry_no; i ++)
+    {
+      if (p->entries [i].count == 0 && p->entries [i].sample_no == 0)
+        break;
+      p->total_count += p->entries [i].count;
+      p->total_sample_no += p->entries [i].sample_no;
+    }
+  p->entry_no = i;
+}
+
+/* Return the given part of the given total as a percentage, or zero if the
+   total is zero. */
+static double
+izmir_profile_percentage (uint64_t part, uint64_t total)
+{
+  return (total == 0) ? 0 : (100.0 * part / total);
+}
+
+
+
+
+/* Profile output.
+ * ************************************************************************** */
+
+void
+izmir_profile_print (jitter_print_context ctx, struct izmirvm_state *s,
+                     bool specialized)
+{
+  /* The profile may be too big for the stack with many specialized
+     instructions. */
+  struct izmir_profile *p = jitter_xmalloc (sizeof (struct izmir_profile));
+  izmir_profile_collect (p, s, specialized);
+
+  char line [256];
+  snprintf (line, sizeof (line),
+            "# %s instruction profile: %llu executions, %llu samples\n",
+            specialized ? "Specialized" : "Unspecialized",
+            (unsigned long long) p->total_count,
+            (unsigned long long) p->total_sample_no);
+  jitter_print_char_star (ctx, line);
+  jitter_print_char_star (ctx, "#               count   count %    time %  "
+                               "instruction\n");
+  size_t i;
+  for (i = 0; i < p->entry_no; i ++)
+    {
+      const struct izmir_profile_entry *e = p->entries + i;
+      snprintf (line, sizeof (line), "%21llu  %7.3f%%  %7.3f%%  %s\n",
+                (unsigned long long) e->count,
+                izmir_profile_percentage (e->count, p->total_count),
+                izmir_profile_percentage (e->sample_no, p->total_sample_no),
+                e->name);
+      jitter_print_char_star (ctx, line);
+    }
+  free (p);
+}
+
+/* Write the given profile to the given stream as a JSON array, one object
+   per instruction.  The time share is null without sample profiling. */
+static void
+izmir_profile_write_json_array (FILE *f, const struct izmir_profile *p)
+{
+  fprintf (f, "[");
+  size_t i;
+  for (i = 0; i < p->entry_no; i ++)
+    {
+      const struct izmir_profile_entry *e = p->entries + i;
+      fprintf (f, "%s\n    {\"name\": \"%s\", \"count\": %llu, "
+               "\"samples\": %llu, \"time_share\": ",
+               (i == 0) ? "" : ",", e->name, (unsigned long long) e->count,
+               (unsigned long long) e->sample_no);
+      if (p->total_sample_no == 0)
+        fprintf (f, "null}");
+      else
+        fprintf (f, "%.6f}", (double) e->sample_no / p->total_sample_no);
+    }
+  fprintf (f, "%s]", (p->entry_no == 0) ? "" : "\n  ");
+}
+
+void
+izmir_profile_write_json (const char *path, struct izmirvm_state *s)
+{
+  FILE *f = fopen (path, "w");
+  if (f == NULL)
+    jitter_fatal ("could not open %s for writing", path);
+
+  struct izmir_profile *p = jitter_xmalloc (sizeof (struct izmir_profile));
+
+  /* Instruction names are plain identifiers, possibly with slashes and
+     punctuation but never with quotes or backslashes, so they need no
+     escaping. */
+  izmir_profile_collect (p, s, true);
+  fprintf (f, "{\n  \"executions\": %llu,\n  \"samples\": %llu,\n",
+           (unsigned long long) p->total_count,
+           (unsigned long long) p->total_sample_no);
+  fprintf (f, "  \"specialized\": ");
+  izmir_profile_write_json_array (f, p);
+  izmir_profile_collect (p, s, false);
+  fprintf (f, ",\n  \"unspecialized\": ");
+  izmir_profile_write_json_array (f, p);
+  fprintf (f, "\n}\n");
+  free (p);
+
+  if (fclose (f) != 0)
+    jitter_fatal ("could not write %s", path);
+}
+
+long long
+izmir_profile_executed_instruction_no (struct izmirvm_state *s)
+{
+#if defined (JITTER_PROFILE_COUNT)
+  struct izmirvm_profile_runtime *prt = izmirvm_state_profile_runtime (s);
+  long long res = 0;
+  size_t i;
+  for (i = 0; i < IZMIRVM_SPECIALIZED_INSTRUCTION_NO; i ++)
+    res += prt->count_profile_runtime.counts [i];
+  return res;
+#else
+  return -1;
+#endif
+}
@@ -0,0 +1,87 @@
+/* Izmir language: VM execution profiles.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_PROFILE_H_
+#define IZMIR_PROFILE_H_
+
+#include <stdbool.h>
+
+#include <jitter/jitter-print.h>
+
+#include "izmirvm-vm.h"
+
+
+/* About profiles.
+ * ************************************************************************** */
+
+/* Jitter can collect two kinds of profile while a VM routine runs, each of
+   which must be enabled when compiling the VM:
+   - count profiles, with JITTER_PROFILE_COUNT defined, count how many times
+     each specialized instruction is executed;
+   - sample profiles, with JITTER_PROFILE_SAMPLE defined, periodically record
+     which specialized instruction is executing, which estimates the share of
+     time spent in each.
+   The build system defines the macros when configured with
+   -DIZMIR_PROFILE_COUNT=ON and -DIZMIR_PROFILE_SAMPLE=ON .
+
+   A profile can be shown per specialized instruction, or per unspecialized
+   instruction by adding together every specialization of the same
+   instruction.  Superinstructions introduced by rewriting are specialized
+   instructions of their own: frequent sequences which have no superinstruction
+   yet are the ones to look for in the unspecialized profile. */
+
+/* Non-false iff this executable was built with at least one kind of
+   profiling. */
+#if defined (JITTER_PROFILE_COUNT) || defined (JITTER_PROFILE_SAMPLE)
+# define IZMIR_PROFILE_AVAILABLE  true
+#else
+# define IZMIR_PROFILE_AVAILABLE  false
+#endif
+
+
+
+
+/* Profile output.
+ * ************************************************************************** */
+
+/* Print the profile collected in the pointed state as a table sorted by
+   decreasing execution count, with one row per specialized instruction if
+   specialized is non-false, or per unspecialized instruction otherwise.
+   Instructions which were never executed or sampled are omitted. */
+void
+izmir_profile_print (jitter_print_context ctx, struct izmirvm_state *s,
+                     bool specialized);
+
+/* Write the profile collected in the pointed state to the file with the given
+   pathname as a JSON object, with both the specialized and the unspecialized
+   instruction profiles.  Fail fatally if the file cannot be written. */
+void
+izmir_profile_write_json (const char *path, struct izmirvm_state *s);
+
+/* Return the number of VM instructions executed with the pointed state, or -1
+   if this executable was built without count profiling. */
+long long
+izmir_profile_executed_instruction_no (struct izmirvm_state *s);
+
+
+#endif // #ifndef IZMIR_PROFILE_H_
@@ -0,0 +1,544 @@
+/* Izmir language: name resolution.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-arena.h"
+#include "izmir-error.h"
+#include "izmir-resolve.h"
+
+
+/* Procedure table.
+ * ************************************************************************** */
+
+/* A procedure name and its index in the program. */
+struct izmir_procedure_entry
+{
+  izmir_variable name;
+  size_t index;
+};
+
+/* A qsort comparison function for struct izmir_procedure_entry objects,
+   ordering them by name address and then by index.  Names are interned, so
+   equal names have the same address. */
+static int
+izmir_procedure_entry_compare (const void *ap, const void *bp)
+{
+  const struct izmir_procedure_entry *a = ap;
+  const struct izmir_procedure_entry *b = bp;
+  if (a->name != b->name)
+    return ((uintptr_t) a->name < (uintptr_t) b->name) ? -1 : 1;
+  if (a->index != b->index)
+    return (a->index < b->index) ? -1 : 1;
+  return 0;
+}
+
+/* Return an array with one entry per procedure of the pointed program,
+   allocated in its arena, sorted so that procedures can be found by name in
+   logarithmic time.  Fail if two procedures have the same name, reporting the
+   duplicate which comes first in the program. */
+static struct izmir_procedure_entry *
+izmir_make_procedure_table (struct izmir_program *p)
+{
+  struct izmir_procedure_entry *res
+    = izmir_program_allocate (p, sizeof (struct izmir_procedure_entry)
+                                 * (p->procedure_no + 1));
+  size_t i;
+  for (i = 0; i < p->procedure_no; i ++)
+    {
+      res [i].name = p->procedures [i]->procedure_name;
+      res [i].index = i;
+    }
+  qsort (res, p->procedure_no, sizeof (struct izmir_procedure_entry),
+         izmir_procedure_entry_compare);
+
+  /* Equal names are adjacent, the first definition first. */
+  size_t duplicate_index = p->procedure_no;
+  for (i = 1; i < p->procedure_no; i ++)
+    if (res [i].name == res [i - 1].name && res [i].index < duplicate_index)
+      duplicate_index = res [i].index;
+  if (duplicate_index < p->procedure_no)
+    izmir_fail ("%s: procedure %s defined more than once",
+                p->source_file_name,
+                p->procedures [duplicate_index]->procedure_name);
+  return res;
+}
+
+
+
+
+/* Scopes.
+ * ************************************************************************** */
+
+/* The variables visible at some point of a procedure or of the main statement,
+   with their frame slots.  Since a variable takes the first slot not used by
+   an enclosing variable, the slot of each visible variable is its index in
+   the array. */
+struct izmir_scope
+{
+  /* The program being resolved. */
+  struct izmir_program *program;
+
+  /* The procedures of the program, as made by izmir_make_procedure_table .
+     The table is not owned by the scope. */
+  const struct izmir_procedure_entry *procedure_table;
+
+  /* An array of the visible variables, outermost first, allocated in the
+     program arena.  Identifiers are interned, so they can be compared as
+     pointers. */
+  izmir_variable *variables;
+
+  /* The number of used elements in variables . */
+  size_t variable_no;
+
+  /* The number of allocated elements in variables . */
+  size_t variable_allocated_no;
+
+  /* The maximum value ever reached by variable_no . */
+  size_t max_variable_no;
+};
+
+/* Initialize the pointed scope to have no visible variables. */
+static void
+izmir_scope_initialize (struct izmir_scope *s, struct izmir_program *p,
+                        const struct izmir_procedure_entry *procedure_table)
+{
+  s->program = p;
+  s->procedure_table = procedure_table;
+  s->variables = NULL;
+  s->variable_no = 0;
+  s->variable_allocated_no = 0;
+  s->max_variable_no = 0;
+}
+
+/* Return the slot of the given variable in the pointed scope, or -1 if the
+   variable is not visible. */
+static jitter_int
+izmir_scope_lookup (const struct izmir_scope *s, izmir_variable v)
+{
+  size_t i;
+  for (i = s->variable_no; i > 0; i --)
+    if (s->variables [i - 1] == v)
+      return i - 1;
+  return -1;
+}
+
+/* Make the given variable visible in the pointed scope, and return its
+   slot. */
+static jitter_int
+izmir_scope_push (struct izmir_scope *s, izmir_variable v)
+{
+  if (s->variable_no == s->variable_allocated_no)
+    {
+      size_t old_allocated_no = s->variable_allocated_no;
+      s->variable_allocated_no = 2 * s->variable_allocated_no + 8;
+      s->variables
+        = izmir_arena_reallocate (& s->program->arena, s->variables,
+                                  sizeof (izmir_variable) * old_allocated_no,
+                                  sizeof (izmir_variable)
+                                  * s->variable_allocated_no);
+    }
+  s->variables [s->variable_no] = v;
+  if (++ s->variable_no > s->max_variable_no)
+    s->max_variable_no = s->variable_no;
+  return s->variable_no - 1;
+}
+
+/* Make the innermost variable of the pointed scope invisible. */
+static void
+izmir_scope_pop (struct izmir_scope *s)
+{
+  s->variable_no --;
+}
+
+
+
+
+/* Variable and procedure lookup.
+ * ************************************************************************** */
+
+/* Return the slot of the given variable used at the given line, or fail if
+   the variable is not visible. */
+static jitter_int
+izmir_resolve_variable (const struct izmir_scope *s, izmir_variable v,
+                        int line)
+{
+  jitter_int res = izmir_scope_lookup (s, v);
+  if (res < 0)
+    izmir_fail ("%s:%i: undefined variable %s",
+                s->program->source_file_name, line, v);
+  return res;
+}
+
+/* Return the index of the procedure with the given name in the program of
+   the pointed scope, or -1 if there is no such procedure. */
+static jitter_int
+izmir_lookup_procedure (const struct izmir_scope *s, izmir_variable name)
+{
+  struct izmir_program *p = s->program;
+  size_t low = 0, high = p->procedure_no;
+  while (low < high)
+    {
+      size_t middle = low + (high - low) / 2;
+      if ((uintptr_t) s->procedure_table [middle].name < (uintptr_t) name)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  if (low == p->procedure_no || s->procedure_table [low].name != name)
+    return -1;
+  return s->procedure_table [low].index;
+}
+
+/* Return the index of the procedure with the given name called at the given
+   line with the given number of actuals, or fail if there is no such procedure
+   or if it takes a different number of arguments. */
+static size_t
+izmir_resolve_callee (const struct izmir_scope *s, izmir_variable callee,
+                      size_t actual_no, int line)
+{
+  struct izmir_program *p = s->program;
+  jitter_int index = izmir_lookup_procedure (s, callee);
+  if (index < 0)
+    izmir_fail ("%s:%i: undefined procedure %s", p->source_file_name, line,
+                callee);
+
+  size_t res = index;
+  if (p->procedures [res]->formal_no != actual_no)
+    izmir_fail ("%s:%i: procedure %s takes %lu arguments, called with %lu",
+                p->source_file_name, line, callee,
+                (unsigned long) p->procedures [res]->formal_no,
+                (unsigned long) actual_no);
+  return res;
+}
+
+
+
+
+/* Builtins.
+ * ************************************************************************** */
+
+/* Array operations are called like procedures, but have no definition: a
+   call to a builtin is resolved into a primitive expression or into a bulk
+   statement.  Builtin names are not reserved, and a procedure defined by the
+   program hides the builtin with its name. */
+
+/* A builtin. */
+struct izmir_builtin
+{
+  /* The builtin name. */
+  const char *name;
+
+  /* The number of arguments. */
+  size_t argument_no;
+
+  /* Non-false iff a call to the builtin is an expression, as opposed to a
+     statement. */
+  bool expression;
+
+  /* The primitive of an expression builtin. */
+  enum izmir_primitive primitive;
+
+  /* The operation of a statement builtin. */
+  enum izmir_bulk_operation bulk_operation;
+};
+
+/* Every builtin. */
+static const struct izmir_builtin
+izmir_builtins [] =
+  {
+    { "array",    1, true,  izmir_primitive_array_new, 0 },
+    { "length",   1, true,  izmir_primitive_array_length, 0 },
+    { "sum",      1, true,  izmir_primitive_array_sum, 0 },
+    { "minimum",  1, true,  izmir_primitive_array_minimum, 0 },
+    { "maximum",  1, true,  izmir_primitive_array_maximum, 0 },
+    { "dot",      2, true,  izmir_primitive_array_dot, 0 },
+    { "fill",     2, false, 0, izmir_bulk_operation_fill },
+    { "copy",     2, false, 0, izmir_bulk_operation_copy },
+    { "add",      3, false, 0, izmir_bulk_operation_add },
+    { "multiply", 3, false, 0, izmir_bulk_operation_multiply }
+  };
+
+/* Return the builtin called with the given name at the given line with the
+   given number of actuals, or NULL if the name is not a builtin or if the
+   program defines a procedure with the same name.  Fail if the builtin takes
+   a different number of arguments. */
+static const struct izmir_builtin *
+izmir_lookup_builtin (const struct izmir_scope *s, izmir_variable callee,
+                      size_t actual_no, int line)
+{
+  if (izmir_lookup_procedure (s, callee) >= 0)
+    return NULL;
+  size_t i;
+  for (i = 0; i < sizeof (izmir_builtins) / sizeof (izmir_builtins [0]); i ++)
+    if (! strcmp (izmir_builtins [i].name, callee))
+      {
+        const struct izmir_builtin *res = izmir_builtins + i;
+        if (res->argument_no != actual_no)
+          izmir_fail ("%s:%i: builtin %s takes %lu arguments, called with %lu",
+                      s->program->source_file_name, line, callee,
+                      (unsigned long) res->argument_no,
+                      (unsigned long) actual_no);
+        return res;
+      }
+  return NULL;
+}
+
+/* If the pointed call expression at the given line calls a builtin, turn it
+   into the builtin primitive and return non-false; otherwise leave it alone
+   and return false.  Fail if the builtin is a statement. */
+static bool
+izmir_resolve_builtin_expression (struct izmir_scope *s,
+                                  struct izmir_expression *e, int line)
+{
+  const struct izmir_builtin *b
+    = izmir_lookup_builtin (s, e->callee, e->actual_no, line);
+  if (b == NULL)
+    return false;
+  if (! b->expression)
+    izmir_fail ("%s:%i: builtin %s is a statement, and has no result",
+                s->program->source_file_name, line, e->callee);
+
+  /* The call fields share memory with the primitive fields. */
+  struct izmir_expression **actuals = e->actuals;
+  size_t actual_no = e->actual_no;
+  e->case_ = izmir_expression_case_primitive;
+  e->primitive = b->primitive;
+  e->primitive_operand_0 = actuals [0];
+  e->primitive_operand_1 = (actual_no > 1) ? actuals [1] : NULL;
+  return true;
+}
+
+/* If the pointed call statement calls a builtin, turn it into a bulk
+   statement and return non-false; otherwise leave it alone and return false.
+   Fail if the builtin is an expression, whose result would be lost. */
+static bool
+izmir_resolve_builtin_statement (struct izmir_scope *s,
+                                 struct izmir_statement *st)
+{
+  const struct izmir_builtin *b
+    = izmir_lookup_builtin (s, st->callee, st->actual_no, st->line);
+  if (b == NULL)
+    return false;
+  if (b->expression)
+    izmir_fail ("%s:%i: the result of builtin %s is not used",
+                s->program->source_file_name, st->line, st->callee);
+
+  /* The call fields share memory with the bulk fields. */
+  struct izmir_expression **actuals = st->actuals;
+  size_t actual_no = st->actual_no;
+  st->case_ = izmir_statement_case_bulk;
+  st->bulk_operation = b->bulk_operation;
+  st->bulk_operands = actuals;
+  st->bulk_operand_no = actual_no;
+  return true;
+}
+
+
+
+
+/* Expression and statement resolution.
+ * ************************************************************************** */
+
+/* Resolve the names in the pointed expression, which occurs in a statement at
+   the given line. */
+static void
+izmir_resolve_expression (struct izmir_scope *s, struct izmir_expression *e,
+                          int line)
+{
+  size_t i;
+  switch (e->case_)
+    {
+    case izmir_expression_case_undefined:
+    case izmir_expression_case_literal:
+      break;
+    case izmir_expression_case_variable:
+      e->variable_slot = izmir_resolve_variable (s, e->variable, line);
+      break;
+    case izmir_expression_case_if_then_else:
+      izmir_resolve_expression (s, e->if_then_else_condition, line);
+      izmir_resolve_expression (s, e->if_then_else_then_branch, line);
+      izmir_resolve_expression (s, e->if_then_else_else_branch, line);
+      break;
+    case izmir_expression_case_primitive:
+      if (e->primitive == izmir_primitive_array_new)
+        s->program->uses_arrays = true;
+      if (e->primitive_operand_0 != NULL)
+        izmir_resolve_expression (s, e->primitive_operand_0, line);
+      if (e->primitive_operand_1 != NULL)
+        izmir_resolve_expression (s, e->primitive_operand_1, line);
+      break;
+    case izmir_expression_case_call:
+      if (izmir_resolve_builtin_expression (s, e, line))
+        {
+          izmir_resolve_expression (s, e, line);
+          break;
+        }
+      e->callee_index = izmir_resolve_callee (s, e->callee, e->actual_no,
+                                              line);
+      for (i = 0; i < e->actual_no; i ++)
+        izmir_resolve_expression (s, e->actuals [i], line);
+      break;
+    default:
+      jitter_fatal ("invalid expression case: %i", (int) e->case_);
+    }
+}
+
+/* Resolve the names in the pointed statement. */
+static void
+izmir_resolve_statement (struct izmir_scope *s, struct izmir_statement *st)
+{
+  size_t i;
+  switch (st->case_)
+    {
+    case izmir_statement_case_skip:
+      break;
+    case izmir_statement_case_block:
+      {
+        /* Bind every variable of the chain in a loop: see
+           izmir_block_inner_block . */
+        size_t block_no = 0, prefix_no;
+        struct izmir_statement *inner;
+        while (true)
+          {
+            if (izmir_scope_lookup (s, st->block_variable) >= 0)
+              izmir_fail ("%s:%i: variable %s declared again in its scope",
+                          s->program->source_file_name, st->line,
+                          st->block_variable);
+            st->block_slot = izmir_scope_push (s, st->block_variable);
+            block_no ++;
+            if ((inner = izmir_block_inner_block (st, & prefix_no)) == NULL)
+              break;
+            for (i = 0; i < prefix_no; i ++)
+              izmir_resolve_statement
+                 (s, st->block_body->sequence_statements [i]);
+            st = inner;
+          }
+        izmir_resolve_statement (s, st->block_body);
+        for (i = 0; i < block_no; i ++)
+          izmir_scope_pop (s);
+        break;
+      }
+    case izmir_statement_case_assignment:
+      izmir_resolve_expression (s, st->assignment_expression, st->line);
+      st->assignment_slot
+        = izmir_resolve_variable (s, st->assignment_variable, st->line);
+      break;
+    case izmir_statement_case_print:
+      izmir_resolve_expression (s, st->print_expression, st->line);
+      break;
+    case izmir_statement_case_sequence:
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        izmir_resolve_statement (s, st->sequence_statements [i]);
+      break;
+    case izmir_statement_case_if_then_else:
+      izmir_resolve_expression (s, st->if_then_else_condition, st->line);
+      izmir_resolve_statement (s, st->if_then_else_then_branch);
+      izmir_resolve_statement (s, st->if_then_else_else_branch);
+      break;
+    case izmir_statement_case_repeat_until:
+      izmir_resolve_statement (s, st->repeat_until_body);
+      izmir_resolve_expression (s, st->repeat_until_guard, st->line);
+      break;
+    case izmir_statement_case_return:
+      izmir_resolve_expression (s, st->return_result, st->line);
+      break;
+    case izmir_statement_case_call:
+      if (izmir_resolve_builtin_statement (s, st))
+        {
+          izmir_resolve_statement (s, st);
+          break;
+        }
+      st->callee_index = izmir_resolve_callee (s, st->callee, st->actual_no,
+                                               st->line);
+      for (i = 0; i < st->actual_no; i ++)
+        izmir_resolve_expression (s, st->actuals [i], st->line);
+      break;
+    case izmir_statement_case_element_assignment:
+      izmir_resolve_expression (s, st->element_array, st->line);
+      izmir_resolve_expression (s, st->element_index, st->line);
+      izmir_resolve_expression (s, st->element_value, st->line);
+      break;
+    case izmir_statement_case_bulk:
+      for (i = 0; i < st->bulk_operand_no; i ++)
+        izmir_resolve_expression (s, st->bulk_operands [i], st->line);
+      break;
+    case izmir_statement_case_inlined:
+      izmir_resolve_statement (s, st->inlined_body);
+      break;
+    case izmir_statement_case_inlined_exit:
+      break;
+    default:
+      jitter_fatal ("invalid statement case: %i", (int) st->case_);
+    }
+}
+
+
+
+
+/* Program resolution.
+ * ************************************************************************** */
+
+/* Resolve the names in the pointed procedure of the pointed program, whose
+   procedures are in the given table. */
+static void
+izmir_resolve_procedure (struct izmir_program *p,
+                         const struct izmir_procedure_entry *procedure_table,
+                         struct izmir_procedure *procedure)
+{
+  struct izmir_scope s;
+  izmir_scope_initialize (& s, p, procedure_table);
+  size_t i;
+  for (i = 0; i < procedure->formal_no; i ++)
+    {
+      if (izmir_scope_lookup (& s, procedure->formals [i]) >= 0)
+        izmir_fail ("%s: formal %s appears twice in procedure %s",
+                    p->source_file_name, procedure->formals [i],
+                    procedure->procedure_name);
+      izmir_scope_push (& s, procedure->formals [i]);
+    }
+  izmir_resolve_statement (& s, procedure->body);
+  procedure->slot_no = s.max_variable_no;
+}
+
+void
+izmir_resolve_program (struct izmir_program *p)
+{
+  struct izmir_procedure_entry *procedure_table
+    = izmir_make_procedure_table (p);
+  p->uses_arrays = false;
+
+  size_t i;
+  for (i = 0; i < p->procedure_no; i ++)
+    izmir_resolve_procedure (p, procedure_table, p->procedures [i]);
+
+  struct izmir_scope s;
+  izmir_scope_initialize (& s, p, procedure_table);
+  izmir_resolve_statement (& s, p->main_statement);
+  p->main_slot_no = s.max_variable_no;
+}
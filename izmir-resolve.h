@@ -0,0 +1,56 @@
+/* Izmir language: name resolution.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_RESOLVE_H_
+#define IZMIR_RESOLVE_H_
+
+#include "izmir-syntax.h"
+
+
+/* Name resolution.
+ * ************************************************************************** */
+
+/* Check the names in the pointed program AST and annotate it with what they
+   refer to, so that code generation never looks up a name.  This must run
+   after parsing and before any other pass, and may run again on a resolved
+   program which was rewritten, as inlining does (see izmir-inline.h).
+
+   Each procedure, and the main statement, has a frame of slots numbered from
+   zero.  Formals take the first slots in order, and each block variable takes
+   the first slot not used by an enclosing variable; blocks which are not
+   nested in one another share their slots.  Code generators keep slot i in
+   a fixed register, so that reading or writing a variable is a single
+   instruction.  Every call is annotated with the index of its callee.
+
+   Fail with izmir_fail , mentioning the source line, on the first use of an
+   undefined variable or procedure, on a call with the wrong number of
+   arguments, on a procedure defined twice, on a formal appearing twice in the
+   same procedure and on a block variable declared again where it is already
+   visible.  Resolution allocates only in the program arena, so that
+   destroying the program after an error releases everything. */
+void
+izmir_resolve_program (struct izmir_program *p);
+
+
+#endif // #ifndef IZMIR_RESOLVE_H_
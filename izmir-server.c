@@ -0,0 +1,321 @@
+/* Izmir language: serving many programs from one process.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-server.h"
+
+
+/* Connections.
+ * ************************************************************************** */
+
+/* The initial size of a connection read buffer, in bytes.  A buffer grown to
+   hold a large request shrinks back to this size afterwards. */
+#define IZMIR_SERVER_DEFAULT_BUFFER_SIZE  65536
+
+/* A connection, over which requests are read and replies written. */
+struct izmir_server_connection
+{
+  /* The file descriptors to read from and to write to. */
+  int in_fd;
+  int out_fd;
+
+  /* The malloc-allocated read buffer, and its allocated size in bytes. */
+  char *buffer;
+  size_t size;
+
+  /* The first unread byte in buffer , and the byte past the last read one. */
+  size_t start;
+  size_t end;
+};
+
+/* Initialize the pointed connection with the given file descriptors. */
+static void
+izmir_server_connection_initialize (struct izmir_server_connection *c,
+                                    int in_fd, int out_fd)
+{
+  c->in_fd = in_fd;
+  c->out_fd = out_fd;
+  c->size = IZMIR_SERVER_DEFAULT_BUFFER_SIZE;
+  c->buffer = jitter_xmalloc (c->size);
+  c->start = 0;
+  c->end = 0;
+}
+
+/* Release the resources of the pointed connection, without closing its file
+   descriptors. */
+static void
+izmir_server_connection_finalize (struct izmir_server_connection *c)
+{
+  free (c->buffer);
+}
+
+/* Read until the pointed connection has at least the given number of unread
+   bytes, which are moved to the beginning of the buffer if more room is
+   needed.  Return false if the input ends first or cannot be read. */
+static bool
+izmir_server_fill (struct izmir_server_connection *c, size_t needed)
+{
+  while (c->end - c->start < needed)
+    {
+      if (c->size - c->start < needed)
+        {
+          memmove (c->buffer, c->buffer + c->start, c->end - c->start);
+          c->end -= c->start;
+          c->start = 0;
+          if (c->size < needed)
+            {
+              c->size = needed;
+              c->buffer = jitter_xrealloc (c->buffer, c->size);
+            }
+        }
+      ssize_t read_size = read (c->in_fd, c->buffer + c->end,
+                                c->size - c->end);
+      if (read_size < 0 && errno == EINTR)
+        continue;
+      if (read_size <= 0)
+        return false;
+      c->end += read_size;
+    }
+  return true;
+}
+
+/* Mark the given number of unread bytes of the pointed connection as
+   consumed, and shrink its buffer back if it grew for a large request and is
+   now mostly empty. */
+static void
+izmir_server_consume (struct izmir_server_connection *c, size_t size)
+{
+  c->start += size;
+  size_t unread_size = c->end - c->start;
+  if (c->size > IZMIR_SERVER_DEFAULT_BUFFER_SIZE
+      && unread_size <= IZMIR_SERVER_DEFAULT_BUFFER_SIZE)
+    {
+      memmove (c->buffer, c->buffer + c->start, unread_size);
+      c->start = 0;
+      c->end = unread_size;
+      c->size = IZMIR_SERVER_DEFAULT_BUFFER_SIZE;
+      c->buffer = jitter_xrealloc (c->buffer, c->size);
+    }
+}
+
+/* Write a reply with the given status word and text of the given size to the
+   pointed connection.  Return false if the output cannot be written. */
+static bool
+izmir_server_write_reply (struct izmir_server_connection *c,
+                          const char *status, const char *text,
+                          size_t text_size)
+{
+  char header [IZMIR_SERVER_MAX_HEADER_SIZE];
+  int header_size = snprintf (header, sizeof (header), "%s %lu\n", status,
+                              (unsigned long) text_size);
+  struct iovec iov [2];
+  iov [0].iov_base = header;
+  iov [0].iov_len = header_size;
+  iov [1].iov_base = (char *) text;
+  iov [1].iov_len = text_size;
+  struct iovec *next = iov;
+  int iov_no = 2;
+  while (iov_no > 0)
+    {
+      ssize_t written = writev (c->out_fd, next, iov_no);
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written < 0)
+        return false;
+      while (iov_no > 0 && (size_t) written >= next->iov_len)
+        {
+          written -= next->iov_len;
+          next ++;
+          iov_no --;
+        }
+      if (iov_no > 0)
+        {
+          next->iov_base = (char *) next->iov_base + written;
+          next->iov_len -= written;
+        }
+    }
+  return true;
+}
+
+/* Parse a decimal size from the given string, storing it into *size and
+   returning a pointer past its last digit, or return NULL if the string does
+   not begin with a digit or the number exceeds
+   IZMIR_SERVER_MAX_REQUEST_SIZE . */
+static const char *
+izmir_server_parse_size (const char *p, size_t *size)
+{
+  if (* p < '0' || * p > '9')
+    return NULL;
+  * size = 0;
+  for (; * p >= '0' && * p <= '9'; p ++)
+    {
+      * size = * size * 10 + (* p - '0');
+      if (* size > IZMIR_SERVER_MAX_REQUEST_SIZE)
+        return NULL;
+    }
+  return p;
+}
+
+
+
+
+/* Serving.
+ * ************************************************************************** */
+
+/* Read the header of the next request from the pointed connection, storing
+   the sizes it holds into *program_size and *input_size, and consume it.
+   Return 1 on success, 0 if the input ended before the header began and -1 if
+   the header is malformed or truncated. */
+static int
+izmir_server_read_header (struct izmir_server_connection *c,
+                          size_t *program_size, size_t *input_size)
+{
+  /* Look for the end of the header line, reading one more byte each time it
+     is not among the unread ones. */
+  char *newline;
+  while ((newline = memchr (c->buffer + c->start, '\n', c->end - c->start))
+         == NULL)
+    {
+      size_t unread_size = c->end - c->start;
+      if (unread_size >= IZMIR_SERVER_MAX_HEADER_SIZE)
+        return -1;
+      if (! izmir_server_fill (c, unread_size + 1))
+        return (c->end == c->start) ? 0 : -1;
+    }
+
+  char header [IZMIR_SERVER_MAX_HEADER_SIZE];
+  size_t header_size = newline - (c->buffer + c->start);
+  if (header_size >= IZMIR_SERVER_MAX_HEADER_SIZE)
+    return -1;
+  memcpy (header, c->buffer + c->start, header_size);
+  header [header_size] = '\0';
+  izmir_server_consume (c, header_size + 1);
+
+  const char *p = izmir_server_parse_size (header, program_size);
+  if (p == NULL)
+    return -1;
+  * input_size = 0;
+  if (* p == ' ')
+    p = izmir_server_parse_size (p + 1, input_size);
+  if (p == NULL || * p != '\0')
+    return -1;
+  return 1;
+}
+
+void
+izmir_server_serve_stream (int in_fd, int out_fd,
+                           izmir_server_handler handler, void *data)
+{
+  /* A client going away must end its connection, not the process. */
+  signal (SIGPIPE, SIG_IGN);
+
+  struct izmir_server_connection c;
+  izmir_server_connection_initialize (& c, in_fd, out_fd);
+  while (true)
+    {
+      size_t program_size, input_size;
+      int header_result = izmir_server_read_header (& c, & program_size,
+                                                    & input_size);
+      if (header_result == 0)
+        break;
+      if (header_result < 0)
+        {
+          const char *message = "malformed request header";
+          izmir_server_write_reply (& c, "error", message, strlen (message));
+          break;
+        }
+      if (! izmir_server_fill (& c, program_size + input_size))
+        {
+          const char *message = "truncated request";
+          izmir_server_write_reply (& c, "error", message, strlen (message));
+          break;
+        }
+
+      /* The request is read in place, without copying it. */
+      struct izmir_server_request rq;
+      rq.program = c.buffer + c.start;
+      rq.program_size = program_size;
+      rq.input = rq.program + program_size;
+      rq.input_size = input_size;
+      struct izmir_server_reply reply;
+      handler (data, & rq, & reply);
+      izmir_server_consume (& c, program_size + input_size);
+      if (! izmir_server_write_reply (& c, reply.ok ? "ok" : "error",
+                                      reply.text, reply.text_size))
+        break;
+    }
+  izmir_server_connection_finalize (& c);
+}
+
+void
+izmir_server_serve_socket (const char *path, izmir_server_handler handler,
+                           void *data)
+{
+  struct sockaddr_un address;
+  if (strlen (path) >= sizeof (address.sun_path))
+    jitter_fatal ("socket pathname too long: %s", path);
+  memset (& address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  strcpy (address.sun_path, path);
+
+  /* Only ever remove a socket, never a file which happens to be there. */
+  struct stat st;
+  if (lstat (path, & st) == 0 && S_ISSOCK (st.st_mode))
+    unlink (path);
+
+  int listening_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (listening_fd < 0)
+    jitter_fatal ("could not create a socket: %s", strerror (errno));
+  if (bind (listening_fd, (struct sockaddr *) & address, sizeof (address))
+      != 0)
+    jitter_fatal ("could not bind to %s: %s", path, strerror (errno));
+  if (listen (listening_fd, 16) != 0)
+    jitter_fatal ("could not listen on %s: %s", path, strerror (errno));
+
+  while (true)
+    {
+      int fd = accept (listening_fd, NULL, NULL);
+      if (fd < 0)
+        {
+          if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+          jitter_fatal ("could not accept on %s: %s", path, strerror (errno));
+        }
+      izmir_server_serve_stream (fd, fd, handler, data);
+      close (fd);
+    }
+}
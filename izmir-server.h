@@ -0,0 +1,130 @@
+/* Izmir language: serving many programs from one process.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_SERVER_H_
+#define IZMIR_SERVER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* About the server.
+ * ************************************************************************** */
+
+/* In server mode one process compiles and runs many programs, one after the
+   other, so that process startup and VM initialization are paid once rather
+   than for every program.  Requests and replies travel over a byte stream,
+   either the standard input and output or a connection to a local Unix
+   socket.
+
+   A request is a header line holding the size in bytes of the program source
+   in decimal, optionally followed by a space and the size of the program
+   input, and then that many bytes of source followed by that many bytes of
+   input.  For example
+     26 3
+     print 1 + 2; print input;
+     40
+   runs a 26-byte program, newline included, on a 3-byte input.  The reply is
+   either "ok SIZE" or "error SIZE" on a line, followed by SIZE bytes of
+   output or of error message.  The stream ends cleanly between requests; a
+   malformed header gets an error reply and ends the stream, since what
+   follows cannot be made sense of.
+
+   There is no time limit.  Requests are handled one at a time to completion,
+   and socket connections are served one after the other, each until it ends;
+   other clients wait meanwhile in the listen queue.  So a program which never
+   terminates, or a client which stops sending in the middle of a request or
+   keeps its connection open, holds the server forever.  A running program
+   cannot be interrupted safely from outside the VM, for example by a signal,
+   since it may be within malloc or updating the heap at the time; a server
+   open to untrusted programs needs a limit enforced around the process, such
+   as a supervisor restarting it when a reply is too late. */
+
+/* The size of the longest accepted request header line, including the
+   newline. */
+#define IZMIR_SERVER_MAX_HEADER_SIZE  64
+
+/* The largest accepted program or input size, in bytes. */
+#define IZMIR_SERVER_MAX_REQUEST_SIZE  (1 << 30)
+
+
+
+
+/* Server data structures.
+ * ************************************************************************** */
+
+/* A request. */
+struct izmir_server_request
+{
+  /* The program source, which is not '\0'-terminated, and its size. */
+  const char *program;
+  size_t program_size;
+
+  /* The program input, and its size. */
+  const char *input;
+  size_t input_size;
+};
+
+/* A reply. */
+struct izmir_server_reply
+{
+  /* Non-false iff the program ran to completion. */
+  bool ok;
+
+  /* The program output if ok is non-false, or otherwise the error message,
+     and its size. */
+  const char *text;
+  size_t text_size;
+};
+
+/* A function handling the pointed request, and filling the pointed reply,
+   whose text must stay valid until the next call.  The first argument is the
+   data given to the server. */
+typedef void (*izmir_server_handler) (void *data,
+                                      const struct izmir_server_request *rq,
+                                      struct izmir_server_reply *reply);
+
+
+
+
+/* Serving.
+ * ************************************************************************** */
+
+/* Serve requests read from the first given file descriptor, writing replies
+   to the second, until the input ends or the output cannot be written. */
+void
+izmir_server_serve_stream (int in_fd, int out_fd,
+                           izmir_server_handler handler, void *data);
+
+/* Listen on a Unix socket at the given pathname and serve its connections
+   one after the other, forever: this never returns.  A socket left over at
+   the same pathname is replaced.  Fail fatally if the socket cannot be set
+   up. */
+void
+izmir_server_serve_socket (const char *path, izmir_server_handler handler,
+                           void *data)
+  __attribute__ ((noreturn));
+
+
+#endif // #ifndef IZMIR_SERVER_H_
@@ -0,0 +1,537 @@
+/* Izmir language: static main stack depth verification.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-stack-depth.h"
+
+
+/* Stack effects.
+ * ************************************************************************** */
+
+/* The effect of an instruction on the main stack: it pops pop_no elements,
+   and then pushes push_no elements. */
+struct izmir_stack_effect
+{
+  unsigned char pop_no;
+  unsigned char push_no;
+};
+
+/* The stack effect of every instruction, indexed by meta-instruction
+   identifier.  Instructions not listed here, including every register
+   instruction, do not touch the main stack.  The effect of call depends on the
+   callee, and is not here; neither is the effect of tail-call.  Keep this in
+   sync with izmirvm.jitter . */
+static const struct izmir_stack_effect
+izmir_stack_effects [IZMIRVM_META_INSTRUCTION_NO] =
+  {
+    [izmirvm_meta_instruction_id_pushconstant] = { 0, 1 },
+    [izmirvm_meta_instruction_id_print] = { 1, 0 },
+    [izmirvm_meta_instruction_id_pushregister] = { 0, 1 },
+    [izmirvm_meta_instruction_id_popregister] = { 1, 0 },
+    [izmirvm_meta_instruction_id_plus_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_minus_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_times_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_divided_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_remainder_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_times_mpower_mof_mtwo_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_divided_mpower_mof_mtwo_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_remainder_mpower_mof_mtwo_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_unary_mminus_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_equal_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_different_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_less_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_less_mor_mequal_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_greater_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_greater_mor_mequal_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_logical_mnot_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_is_mnonzero_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_input_mstack] = { 0, 1 },
+    [izmirvm_meta_instruction_id_branch_mif_mzero_mstack] = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mnonzero_mstack] = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mequal_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mdifferent_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mless_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mless_mor_mequal_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mgreater_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mgreater_mor_mequal_mstack]
+      = { 2, 0 },
+    [izmirvm_meta_instruction_id_copyregister] = { 1, 1 },
+    [izmirvm_meta_instruction_id_pushregister_mpushregister] = { 0, 2 },
+    [izmirvm_meta_instruction_id_popregister_mpopregister] = { 2, 0 },
+    [izmirvm_meta_instruction_id_plus_mpushregister] = { 0, 1 },
+    [izmirvm_meta_instruction_id_minus_mpushregister] = { 0, 1 },
+    [izmirvm_meta_instruction_id_plus_mconstant_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_minus_mconstant_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_times_mconstant_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_branch_mif_mequal_mconstant_mstack] = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mdifferent_mconstant_mstack]
+      = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mless_mconstant_mstack] = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mless_mor_mequal_mconstant_mstack]
+      = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mgreater_mconstant_mstack]
+      = { 1, 0 },
+    [izmirvm_meta_instruction_id_branch_mif_mgreater_mor_mequal_mconstant_mstack]
+      = { 1, 0 },
+    [izmirvm_meta_instruction_id_array_mnew_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_array_melement_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_array_mset_mstack] = { 3, 0 },
+    [izmirvm_meta_instruction_id_array_mlength_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_array_msum_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_array_mminimum_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_array_mmaximum_mstack] = { 1, 1 },
+    [izmirvm_meta_instruction_id_array_mdot_mstack] = { 2, 1 },
+    [izmirvm_meta_instruction_id_array_mfill_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_array_mcopy_mstack] = { 2, 0 },
+    [izmirvm_meta_instruction_id_array_madd_mstack] = { 3, 0 },
+    [izmirvm_meta_instruction_id_array_mmultiply_mstack] = { 3, 0 }
+  };
+
+
+
+
+/* Verification.
+ * ************************************************************************** */
+
+/* The state of the verification of a program. */
+struct izmir_stack_depth_verifier
+{
+  /* The code being verified. */
+  const struct izmir_code *code;
+
+  /* The same code when the verifier sets the argument of every
+     mainstack-reserve instruction, or NULL when it only checks them. */
+  struct izmir_code *writable_code;
+
+  /* The program the code was generated from, for error messages, or NULL. */
+  const struct izmir_program *program;
+
+  /* Where to jump on failure when checking, in which case failures are not
+     fatal. */
+  jmp_buf failure;
+
+  /* The index of the item defining each label, or -1 if the label is not
+     defined. */
+  jitter_int *label_items;
+
+  /* The depth at each label, or -1 if no path reaching the label was found
+     yet. */
+  jitter_int *label_depths;
+
+  /* The index of the entry point from which each label was first reached,
+     counting the main statement as 0 and then each procedure, or -1. */
+  jitter_int *label_entries;
+
+  /* The number of formals of the procedure whose entry point is each label, or
+     -1 if the label is not a procedure entry point. */
+  jitter_int *label_formal_nos;
+
+  /* The labels reached and not followed yet.  The array has room for every
+     label, since a label is only added once. */
+  izmir_code_label *pending_labels;
+  size_t pending_label_no;
+
+  /* The index of the entry point of the code being followed, as in
+     label_entries . */
+  jitter_int entry;
+
+  /* The maximum depth reached so far in the code being followed. */
+  jitter_int max_depth;
+
+  /* The index of the literal argument of the first mainstack-reserve
+     instruction in the code being followed, or -1 if there is none yet. */
+  jitter_int reserve_item;
+};
+
+/* Fail with the given printf-style message: fatally when the pointed verifier
+   is verifying freshly generated code, since that is a bug in a code
+   generator, or otherwise by jumping back to izmir_stack_depth_check . */
+static void
+izmir_stack_depth_fail (struct izmir_stack_depth_verifier *v,
+                        const char *format, ...)
+  __attribute__ ((noreturn, format (printf, 2, 3)));
+static void
+izmir_stack_depth_fail (struct izmir_stack_depth_verifier *v,
+                        const char *format, ...)
+{
+  if (v->writable_code == NULL)
+    longjmp (v->failure, 1);
+
+  char message [256];
+  va_list arguments;
+  va_start (arguments, format);
+  vsnprintf (message, sizeof (message), format, arguments);
+  va_end (arguments);
+  jitter_fatal ("stack depth: %s", message);
+}
+
+/* Record that the given label is reached with the given depth in the pointed
+   verifier, adding it to the pending labels if it was not reached before, or
+   otherwise checking that the depth is the same. */
+static void
+izmir_stack_depth_reach (struct izmir_stack_depth_verifier *v,
+                         izmir_code_label l, jitter_int depth)
+{
+  if (l < 0 || l >= v->code->label_no || v->label_items [l] < 0)
+    izmir_stack_depth_fail (v, "branch to undefined label %li", (long) l);
+  if (v->label_depths [l] >= 0)
+    {
+      if (v->label_depths [l] != depth)
+        izmir_stack_depth_fail (v, "label %li reached with depths %li and %li",
+                                (long) l, (long) v->label_depths [l],
+                                (long) depth);
+      /* The depth beyond a label only counts for the reserve of the entry
+         point which followed it. */
+      if (v->label_entries [l] != v->entry)
+        izmir_stack_depth_fail (v, "label %li reached from two entry points",
+                                (long) l);
+      return;
+    }
+  v->label_depths [l] = depth;
+  v->label_entries [l] = v->entry;
+  v->pending_labels [v->pending_label_no ++] = l;
+}
+
+/* Follow the recorded code in the pointed verifier from the item with the
+   given index, with the given depth, until the end of the basic block
+   sequence falling through from it.  Labels reached by branches are left
+   pending. */
+static void
+izmir_stack_depth_follow (struct izmir_stack_depth_verifier *v,
+                          size_t item_index, jitter_int depth)
+{
+  const struct izmir_code *c = v->code;
+  size_t i = item_index;
+  while (true)
+    {
+      if (i >= c->item_no)
+        izmir_stack_depth_fail (v, "control falls off the end of the code");
+      const struct izmir_code_item *item = c->items + i;
+      switch (item->case_)
+        {
+        case izmir_code_item_case_line:
+          i ++;
+          continue;
+        case izmir_code_item_case_label:
+          {
+            /* Falling through into a label which was already followed ends
+               this block sequence; otherwise the label is followed from
+               here. */
+            izmir_code_label l = item->value;
+            if (v->label_depths [l] >= 0)
+              {
+                izmir_stack_depth_reach (v, l, depth);
+                return;
+              }
+            v->label_depths [l] = depth;
+            v->label_entries [l] = v->entry;
+            i ++;
+            continue;
+          }
+        case izmir_code_item_case_instruction:
+          break;
+        default:
+          izmir_stack_depth_fail (v, "parameter without an instruction at "
+                                  "item %li", (long) i);
+        }
+      if (item->value < 0 || item->value >= IZMIRVM_META_INSTRUCTION_NO)
+        izmir_stack_depth_fail (v, "invalid instruction at item %li",
+                                (long) i);
+
+      /* Find the parameters of the instruction, and its label parameter if
+         any. */
+      enum izmirvm_meta_instruction_id id = item->value;
+      size_t parameter_index = i + 1;
+      size_t next_index = parameter_index;
+      jitter_int label = -1;
+      while (next_index < c->item_no
+             && (c->items [next_index].case_
+                 == izmir_code_item_case_literal_parameter
+                 || c->items [next_index].case_
+                    == izmir_code_item_case_register_parameter
+                 || c->items [next_index].case_
+                    == izmir_code_item_case_label_parameter))
+        {
+          if (c->items [next_index].case_
+              == izmir_code_item_case_label_parameter)
+            label = c->items [next_index].value;
+          next_index ++;
+        }
+
+      /* Nothing may touch the stack or branch before the room for the whole
+         depth is reserved; only the prolog, which uses the return stack, and
+         setting the limit come first. */
+      if (v->reserve_item < 0
+          && id != izmirvm_meta_instruction_id_mainstack_mreserve
+          && id != izmirvm_meta_instruction_id_procedure_mprolog
+          && id != izmirvm_meta_instruction_id_mainstack_mset_mlimit)
+        izmir_stack_depth_fail (v, "%s at item %li before mainstack-reserve",
+                                izmirvm_meta_instructions [id].name, (long) i);
+
+      /* Apply the stack effect. */
+      jitter_int pop_no, push_no;
+      if (id == izmirvm_meta_instruction_id_call
+          || id == izmirvm_meta_instruction_id_tail_mcall)
+        {
+          if (label < 0 || label >= c->label_no
+              || v->label_formal_nos [label] < 0)
+            izmir_stack_depth_fail (v, "call to a non-procedure at item %li",
+                                    (long) i);
+          pop_no = v->label_formal_nos [label];
+          push_no = 0;
+        }
+      else
+        {
+          pop_no = izmir_stack_effects [id].pop_no;
+          push_no = izmir_stack_effects [id].push_no;
+        }
+      if (depth < pop_no)
+        izmir_stack_depth_fail (v, "%s at item %li pops %li elements at "
+                                "depth %li",
+                                izmirvm_meta_instructions [id].name,
+                                (long) i, (long) pop_no, (long) depth);
+      depth += push_no - pop_no;
+      if (depth > v->max_depth)
+        v->max_depth = depth;
+      if (id == izmirvm_meta_instruction_id_mainstack_mreserve
+          && v->reserve_item < 0)
+        {
+          if (next_index != parameter_index + 1
+              || (c->items [parameter_index].case_
+                  != izmir_code_item_case_literal_parameter))
+            izmir_stack_depth_fail (v, "malformed mainstack-reserve at item "
+                                    "%li", (long) i);
+          v->reserve_item = parameter_index;
+        }
+
+      /* Follow the control flow. */
+      switch (id)
+        {
+        case izmirvm_meta_instruction_id_return:
+          if (depth != 0)
+            izmir_stack_depth_fail (v, "return at item %li with depth %li",
+                                    (long) i, (long) depth);
+          return;
+        case izmirvm_meta_instruction_id_tail_mcall:
+          /* The callee takes over the frame, which must hold nothing but the
+             actuals. */
+          if (depth != 0)
+            izmir_stack_depth_fail (v, "tail call at item %li leaves %li "
+                                    "elements", (long) i, (long) depth);
+          return;
+        case izmirvm_meta_instruction_id_exitvm:
+          return;
+        case izmirvm_meta_instruction_id_branch:
+          izmir_stack_depth_reach (v, label, depth);
+          return;
+        case izmirvm_meta_instruction_id_call:
+          break;
+        default:
+          if (label >= 0)
+            izmir_stack_depth_reach (v, label, depth);
+        }
+      i = next_index;
+    }
+}
+
+/* Verify the code beginning at the item with the given index in the pointed
+   verifier, entered with the given depth, and set or check the argument of
+   its mainstack-reserve instruction.  The given name describes the code, for
+   error messages. */
+static void
+izmir_stack_depth_verify_entry (struct izmir_stack_depth_verifier *v,
+                                size_t item_index, jitter_int entry_depth,
+                                const char *name)
+{
+  v->pending_label_no = 0;
+  v->max_depth = entry_depth;
+  v->reserve_item = -1;
+  izmir_stack_depth_follow (v, item_index, entry_depth);
+  while (v->pending_label_no > 0)
+    {
+      izmir_code_label l = v->pending_labels [-- v->pending_label_no];
+      izmir_stack_depth_follow (v, v->label_items [l] + 1,
+                                v->label_depths [l]);
+    }
+
+  if (v->reserve_item < 0)
+    izmir_stack_depth_fail (v, "no mainstack-reserve in %s", name);
+  jitter_int depth = v->max_depth - entry_depth;
+  if (v->writable_code != NULL)
+    v->writable_code->items [v->reserve_item].value = depth;
+  else
+    {
+      /* A larger reservation is safe, as long as it fits in the stack. */
+      jitter_int reserved = v->code->items [v->reserve_item].value;
+      if (reserved < depth || reserved > IZMIRVM_MAINSTACK_ELEMENT_NO)
+        izmir_stack_depth_fail (v, "%s reserves %li elements for depth %li",
+                                name, (long) reserved, (long) depth);
+    }
+}
+
+/* Verify the code in the pointed verifier, whose code, writable_code and
+   program fields are set, from the entry points recorded in the code. */
+static void
+izmir_stack_depth_verify_code (struct izmir_stack_depth_verifier *v)
+{
+  const struct izmir_code *c = v->code;
+  size_t label_no = c->label_no;
+  size_t i;
+  for (i = 0; i < label_no; i ++)
+    {
+      v->label_items [i] = -1;
+      v->label_depths [i] = -1;
+      v->label_entries [i] = -1;
+      v->label_formal_nos [i] = -1;
+    }
+  for (i = 0; i < c->item_no; i ++)
+    if (c->items [i].case_ == izmir_code_item_case_label)
+      {
+        izmir_code_label l = c->items [i].value;
+        if (l < 0 || l >= c->label_no || v->label_items [l] >= 0)
+          izmir_stack_depth_fail (v, "invalid label definition at item %li",
+                                  (long) i);
+        v->label_items [l] = i;
+      }
+  for (i = 0; i < c->procedure_no; i ++)
+    {
+      const struct izmir_code_procedure *procedure = c->procedures + i;
+      if (procedure->entry_label < 0 || procedure->entry_label >= c->label_no
+          || procedure->tail_entry_label < 0
+          || procedure->tail_entry_label >= c->label_no
+          || procedure->formal_no < 0)
+        izmir_stack_depth_fail (v, "invalid procedure %li", (long) i);
+      v->label_formal_nos [procedure->entry_label] = procedure->formal_no;
+      v->label_formal_nos [procedure->tail_entry_label] = procedure->formal_no;
+    }
+
+  /* The main statement starts with an empty stack, and a procedure with its
+     actuals. */
+  v->entry = 0;
+  izmir_stack_depth_verify_entry (v, c->main_item_index, 0, "main statement");
+  for (i = 0; i < c->procedure_no; i ++)
+    {
+      const struct izmir_code_procedure *procedure = c->procedures + i;
+      char name [64];
+      if (v->program != NULL)
+        snprintf (name, sizeof (name), "%s",
+                  v->program->procedures [i]->procedure_name);
+      else
+        snprintf (name, sizeof (name), "procedure %li", (long) i);
+      izmir_code_label l = procedure->entry_label;
+      if (v->label_items [l] < 0)
+        izmir_stack_depth_fail (v, "%s not generated", name);
+      if (v->label_depths [l] >= 0)
+        izmir_stack_depth_fail (v, "%s entered from elsewhere", name);
+      v->entry = i + 1;
+      v->label_depths [l] = procedure->formal_no;
+      v->label_entries [l] = v->entry;
+      izmir_stack_depth_verify_entry (v, v->label_items [l] + 1,
+                                      procedure->formal_no, name);
+    }
+}
+
+/* Allocate the arrays of the pointed verifier for the pointed code. */
+static void
+izmir_stack_depth_verifier_initialize (struct izmir_stack_depth_verifier *v,
+                                       const struct izmir_code *c)
+{
+  size_t label_no = c->label_no;
+  v->code = c;
+  v->label_items = jitter_xmalloc (sizeof (jitter_int) * (label_no + 1));
+  v->label_depths = jitter_xmalloc (sizeof (jitter_int) * (label_no + 1));
+  v->label_entries = jitter_xmalloc (sizeof (jitter_int) * (label_no + 1));
+  v->label_formal_nos = jitter_xmalloc (sizeof (jitter_int) * (label_no + 1));
+  v->pending_labels
+    = jitter_xmalloc (sizeof (izmir_code_label) * (label_no + 1));
+}
+
+/* Release the arrays of the pointed verifier. */
+static void
+izmir_stack_depth_verifier_finalize (struct izmir_stack_depth_verifier *v)
+{
+  free (v->label_items);
+  free (v->label_depths);
+  free (v->label_entries);
+  free (v->label_formal_nos);
+  free (v->pending_labels);
+}
+
+void
+izmir_stack_depth_verify (struct izmir_code *c, struct izmir_program *p,
+                          size_t main_item_index,
+                          const izmir_code_label *procedure_labels)
+{
+  /* Record the entry points, for izmir_stack_depth_check . */
+  size_t i;
+  c->main_item_index = main_item_index;
+  c->procedure_no = p->procedure_no;
+  c->procedures
+    = jitter_xmalloc (sizeof (struct izmir_code_procedure)
+                      * (p->procedure_no + 1));
+  for (i = 0; i < p->procedure_no; i ++)
+    {
+      c->procedures [i].entry_label = procedure_labels [i];
+      c->procedures [i].tail_entry_label
+        = procedure_labels [p->procedure_no + i];
+      c->procedures [i].formal_no = p->procedures [i]->formal_no;
+    }
+
+  struct izmir_stack_depth_verifier v;
+  izmir_stack_depth_verifier_initialize (& v, c);
+  v.writable_code = c;
+  v.program = p;
+  izmir_stack_depth_verify_code (& v);
+  izmir_stack_depth_verifier_finalize (& v);
+}
+
+bool
+izmir_stack_depth_check (const struct izmir_code *c)
+{
+  if (c->label_no < 0 || c->main_item_index >= c->item_no)
+    return false;
+
+  /* The array pointers in the verifier are not modified after setjmp , so
+     they can still be freed after a failure jumps back here. */
+  struct izmir_stack_depth_verifier v;
+  izmir_stack_depth_verifier_initialize (& v, c);
+  v.writable_code = NULL;
+  v.program = NULL;
+  volatile bool res = false;
+  if (setjmp (v.failure) == 0)
+    {
+      izmir_stack_depth_verify_code (& v);
+      res = true;
+    }
+  izmir_stack_depth_verifier_finalize (& v);
+  return res;
+}
@@ -0,0 +1,92 @@
+/* Izmir language: static main stack depth verification.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+
+#ifndef IZMIR_STACK_DEPTH_H_
+#define IZMIR_STACK_DEPTH_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "izmir-syntax.h"
+#include "izmir-code.h"
+
+
+/* About main stack depth.
+ * ************************************************************************** */
+
+/* The code generators know the effect on the main stack of every instruction
+   they emit, so the depth of the main stack at every point of a procedure,
+   relative to the procedure entry, is a compile-time constant; so is the
+   depth at every point of the main statement.  The verifier follows every
+   path through the recorded code of each procedure and of the main statement,
+   from its entry, and checks that:
+
+   - every basic block is reached with the same depth along every path;
+   - no instruction pops more elements than the depth;
+   - every return instruction is reached with the depth at zero, the formals
+     having been popped, and so is every tail-call instruction, once its
+     actuals are popped.
+
+   A call or a tail call counts as popping the actuals of the callee; the
+   callee frame is then bounded by the callee itself.  Failing any check on
+   freshly generated code is a bug in a code generator, and fatal.
+
+   The maximum depth of the main statement and of each procedure, beyond the
+   depth at its entry, becomes the argument of the mainstack-reserve
+   instruction at its beginning, which the code generators emit with a
+   placeholder argument.  Checking the whole depth once at entry lets izmir
+   run on a VM whose main stack has no guards; recursion still fails cleanly,
+   at the first procedure entry for which there is no room left on the main
+   stack or, as procedure-prolog checks, on the return stack. */
+
+
+
+
+/* Stack depth verification.
+ * ************************************************************************** */
+
+/* Verify the main stack depth of the pointed code, just generated for the
+   pointed program, and set the argument of every mainstack-reserve
+   instruction.  The code of the main statement begins at the item with the
+   given index, and the code of each procedure begins with the definition of
+   its entry point label, given in the array procedure_labels as made by
+   izmir_make_procedure_labels .  Record the entry points in the code, for
+   izmir_stack_depth_check .  Fail fatally if verification fails. */
+void
+izmir_stack_depth_verify (struct izmir_code *c, struct izmir_program *p,
+                          size_t main_item_index,
+                          const izmir_code_label *procedure_labels);
+
+/* Verify the main stack depth of the pointed code again, from the entry points
+   recorded in it, without changing it.  Return non-false iff every check
+   passes and every mainstack-reserve argument covers the depth reached, within
+   the size of the stack.  This is for code which was not just generated, such
+   as a cache entry, which may be corrupt: since the code runs without stack
+   guards, failing is not fatal, and every index in the code is checked before
+   use. */
+bool
+izmir_stack_depth_check (const struct izmir_code *c);
+
+
+#endif // #ifndef IZMIR_STACK_DEPTH_H_
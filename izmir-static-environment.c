@@ -0,0 +1,204 @@
+/* Izmir language: static environments for code generation.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#include <jitter/jitter-fatal.h>
+#include <jitter/jitter-malloc.h>
+
+#include "izmir-parallel.h"
+#include "izmir-static-environment.h"
+
+
+/* Global settings.
+ * ************************************************************************** */
+
+bool izmir_tail_calls = true;
+
+
+
+
+/* Register allocation.
+ * ************************************************************************** */
+
+/* Allocate the next register and return its index. */
+static jitter_int
+izmir_static_environment_allocate_register (struct izmir_static_environment *e)
+{
+  jitter_int res = e->used_register_no ++;
+  if (e->used_register_no > e->max_used_register_no)
+    e->max_used_register_no = e->used_register_no;
+  return res;
+}
+
+/* Free the given register, which must be the last one allocated. */
+static void
+izmir_static_environment_free_register (struct izmir_static_environment *e,
+                                        jitter_int register_index)
+{
+  if (register_index != e->used_register_no - 1)
+    jitter_fatal ("freeing register %li out of order (%li in use)",
+                  (long) register_index, (long) e->used_register_no);
+  e->used_register_no --;
+}
+
+
+
+
+/* Static environment operations.
+ * ************************************************************************** */
+
+izmir_code_label *
+izmir_make_procedure_labels (struct izmir_code *c, struct izmir_program *p)
+{
+  izmir_code_label *res
+    = jitter_xmalloc (sizeof (izmir_code_label) * (2 * p->procedure_no + 1));
+  size_t i;
+  for (i = 0; i < 2 * p->procedure_no; i ++)
+    res [i] = izmir_code_fresh_label (c);
+  return res;
+}
+
+/* The data shared by the tasks generating procedures in parallel. */
+struct izmir_procedure_generation
+{
+  struct izmir_program *program;
+  const izmir_code_label *procedure_labels;
+  izmir_procedure_generator generator;
+
+  /* The number of labels shared by every piece: the procedure labels, and
+     any label allocated before them. */
+  izmir_code_label shared_label_no;
+
+  /* One piece of code per procedure, in order. */
+  struct izmir_code *pieces;
+};
+
+/* Generate the procedure with the given index into its own piece of code.
+   This is a parallel task for izmir_parallel_for . */
+static void
+izmir_generate_procedure_piece (void *data, size_t index)
+{
+  struct izmir_procedure_generation *g = data;
+  struct izmir_code *piece = g->pieces + index;
+  izmir_code_initialize (piece);
+  piece->label_no = g->shared_label_no;
+  g->generator (piece, g->program, g->procedure_labels, index);
+}
+
+void
+izmir_generate_procedures (struct izmir_code *c, struct izmir_program *p,
+                           const izmir_code_label *procedure_labels,
+                           izmir_procedure_generator generator)
+{
+  if (p->procedure_no == 0)
+    return;
+
+  /* Procedure labels, with the tail entry points last, are allocated in
+     order. */
+  struct izmir_procedure_generation g;
+  g.program = p;
+  g.procedure_labels = procedure_labels;
+  g.generator = generator;
+  g.shared_label_no = procedure_labels [2 * p->procedure_no - 1] + 1;
+
+  /* When compiling serially one piece at a time is enough. */
+  size_t i;
+  if (izmir_job_no < 2)
+    {
+      struct izmir_code piece;
+      for (i = 0; i < p->procedure_no; i ++)
+        {
+          izmir_code_initialize (& piece);
+          piece.label_no = g.shared_label_no;
+          generator (& piece, p, procedure_labels, i);
+          izmir_code_append_code (c, & piece, g.shared_label_no);
+          izmir_code_finalize (& piece);
+        }
+      return;
+    }
+
+  g.pieces = jitter_xmalloc (sizeof (struct izmir_code) * p->procedure_no);
+  izmir_parallel_for (izmir_job_no, p->procedure_no,
+                      izmir_generate_procedure_piece, & g);
+  for (i = 0; i < p->procedure_no; i ++)
+    {
+      izmir_code_append_code (c, g.pieces + i, g.shared_label_no);
+      izmir_code_finalize (g.pieces + i);
+    }
+  free (g.pieces);
+}
+
+void
+izmir_static_environment_initialize (struct izmir_static_environment *e,
+                                     struct izmir_program *p,
+                                     const izmir_code_label *procedure_labels)
+{
+  e->binding_no = 0;
+  e->used_register_no = IZMIR_FIRST_ALLOCATABLE_REGISTER;
+  e->max_used_register_no = IZMIR_FIRST_ALLOCATABLE_REGISTER;
+  e->program = p;
+  e->procedure_labels = procedure_labels;
+  e->procedure = NULL;
+}
+
+void
+izmir_static_environment_finalize (struct izmir_static_environment *e)
+{
+  /* Nothing to release. */
+}
+
+jitter_int
+izmir_static_environment_bind (struct izmir_static_environment *e,
+                               jitter_int slot)
+{
+  if (slot != e->binding_no
+      || e->used_register_no
+         != IZMIR_FIRST_ALLOCATABLE_REGISTER + e->binding_no)
+    jitter_fatal ("binding slot %li out of order (%li bound, %li registers "
+                  "in use)", (long) slot, (long) e->binding_no,
+                  (long) e->used_register_no);
+  e->binding_no ++;
+  return izmir_static_environment_allocate_register (e);
+}
+
+void
+izmir_static_environment_unbind (struct izmir_static_environment *e)
+{
+  if (e->binding_no == 0)
+    jitter_fatal ("unbinding from an empty static environment");
+  e->binding_no --;
+  izmir_static_environment_free_register
+     (e, IZMIR_FIRST_ALLOCATABLE_REGISTER + e->binding_no);
+}
+
+jitter_int
+izmir_static_environment_fresh_temporary (struct izmir_static_environment *e)
+{
+  return izmir_static_environment_allocate_register (e);
+}
+
+void
+izmir_static_environment_release_temporary (struct izmir_static_environment *e,
+                                            jitter_int register_index)
+{
+  izmir_static_environment_free_register (e, register_index);
+}
@@ -0,0 +1,210 @@
+/* Izmir language: static environments for code generation.
+
+   Copyright (C) 2022 ???
+   Written by ???
+
+   This file is part of the İzmir example, based on the Jitter
+   structured-language example which is distributed along with
+   GNU Jitter under its same license.
+
+   GNU Jitter is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU Jitter is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with GNU Jitter.  If not, see <http://www.gnu.org/licenses/>. */
+
+
+#ifndef IZMIR_STATIC_ENVIRONMENT_H_
+#define IZMIR_STATIC_ENVIRONMENT_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <jitter/jitter.h>
+#include <jitter/jitter-fatal.h>
+
+#include "izmir-syntax.h"
+#include "izmir-code.h"
+
+
+/* About static environments.
+ * ************************************************************************** */
+
+/* A static environment keeps track, at code generation time, of which VM
+   registers hold izmir variables and which registers are being used as
+   temporaries.  Nothing of this survives at run time: generated code refers to
+   registers by index, and never looks up variables by name.
+
+   Names are never looked up at code generation time either: resolution (see
+   izmir-resolve.h) has already assigned every variable a frame slot, and the
+   variable in slot i lives in register IZMIR_FIRST_ALLOCATABLE_REGISTER + i
+   for its whole scope.
+
+   Registers are allocated in a stack discipline.  Binding a variable or
+   allocating a temporary always takes the lowest register not in use, and
+   unbinding or releasing always frees the highest one.  This keeps the indices
+   small, so that the most frequently used registers are the fast ones.
+
+   Since a variable is bound when no temporary is in use, and since its slot
+   is the number of enclosing variables, the register it is bound to is always
+   the one of its slot.
+
+   Register 0 is never allocated: by convention it holds the result of a
+   procedure from the return instruction to the caller.
+
+   The static environment also knows the entry points of the procedures of the
+   program being compiled, indexed like the procedures themselves.  Every
+   procedure has a second entry point right past its prolog, for tail calls:
+   a procedure returning the result of a call pushes the actuals and jumps
+   there, leaving its own link on the return stack for the callee to return
+   to.  A procedure tail-calling itself becomes a loop. */
+
+
+
+
+/* Static environment data structures.
+ * ************************************************************************** */
+
+/* The index of the register holding procedure results. */
+#define IZMIR_RESULT_REGISTER  0
+
+/* The index of the first register available for variables and temporaries. */
+#define IZMIR_FIRST_ALLOCATABLE_REGISTER  1
+
+/* Non-false iff code generators compile calls in tail position as tail calls.
+   This is a process-wide setting, meant to be set once from the command line;
+   the default is true. */
+extern bool izmir_tail_calls;
+
+/* A static environment. */
+struct izmir_static_environment
+{
+  /* The number of variables currently bound, which occupy the registers
+     right after IZMIR_RESULT_REGISTER . */
+  jitter_int binding_no;
+
+  /* The number of registers currently in use, as variables or temporaries.
+     This is also the index of the next register to be allocated. */
+  jitter_int used_register_no;
+
+  /* The maximum value ever reached by used_register_no . */
+  jitter_int max_used_register_no;
+
+  /* The program being compiled, which is not owned by the environment. */
+  struct izmir_program *program;
+
+  /* The entry point label of each procedure in program, in the same order as
+     program->procedures , followed by the tail entry point label of each
+     procedure in the same order.  The array is not owned by the
+     environment. */
+  const izmir_code_label *procedure_labels;
+
+  /* The procedure being compiled, or NULL when compiling the main
+     statement. */
+  struct izmir_procedure *procedure;
+};
+
+
+
+
+/* Static environment operations.
+ * ************************************************************************** */
+
+/* Return a malloc-allocated array holding a fresh label in the pointed
+   code for the entry point of each procedure of the pointed program, in
+   order, followed by a fresh label for the tail entry point of each
+   procedure, in order. */
+izmir_code_label *
+izmir_make_procedure_labels (struct izmir_code *c, struct izmir_program *p);
+
+/* A function appending to the pointed code the code for the procedure with
+   the given index in the pointed program, whose procedure entry points are
+   the given labels. */
+typedef void (*izmir_procedure_generator)
+   (struct izmir_code *c, struct izmir_program *p,
+    const izmir_code_label *procedure_labels, size_t procedure_index);
+
+/* Append to the pointed code the code for every procedure of the pointed
+   program, in order, using the given generator and the given procedure entry
+   points, made by izmir_make_procedure_labels .  Each procedure is generated
+   into a piece of code of its own, up to izmir_job_no at a time in parallel
+   (see izmir-parallel.h), and the pieces are then appended in order: the
+   result does not depend on the number of jobs. */
+void
+izmir_generate_procedures (struct izmir_code *c, struct izmir_program *p,
+                           const izmir_code_label *procedure_labels,
+                           izmir_procedure_generator generator);
+
+/* Initialize the pointed static environment to have no variable bindings,
+   for compiling the main statement of the pointed program, whose procedure
+   entry points are the given labels.  The procedure field may be set after
+   initialization to compile a procedure instead. */
+void
+izmir_static_environment_initialize (struct izmir_static_environment *e,
+                                     struct izmir_program *p,
+                                     const izmir_code_label *procedure_labels);
+
+/* Release the resources held by the pointed static environment, which must
+   not be used again unless re-initialized. */
+void
+izmir_static_environment_finalize (struct izmir_static_environment *e);
+
+/* Bind the variable with the given slot to a fresh register, and return the
+   register index.  The slot must be the number of variables already bound,
+   and no temporary may be in use. */
+jitter_int
+izmir_static_environment_bind (struct izmir_static_environment *e,
+                               jitter_int slot);
+
+/* Remove the innermost binding, which must have been the last register
+   allocated. */
+void
+izmir_static_environment_unbind (struct izmir_static_environment *e);
+
+/* Return the index of the register bound to the variable with the given
+   slot. */
+static inline jitter_int
+izmir_static_environment_register (const struct izmir_static_environment *e,
+                                   jitter_int slot)
+{
+  if (slot < 0 || slot >= e->binding_no)
+    jitter_fatal ("slot %li is not bound", (long) slot);
+  return IZMIR_FIRST_ALLOCATABLE_REGISTER + slot;
+}
+
+/* Return the entry point label of the procedure with the given index. */
+static inline izmir_code_label
+izmir_static_environment_procedure (const struct izmir_static_environment *e,
+                                    size_t procedure_index)
+{
+  return e->procedure_labels [procedure_index];
+}
+
+/* Return the tail entry point label of the procedure with the given index,
+   right past its prolog. */
+static inline izmir_code_label
+izmir_static_environment_procedure_tail
+   (const struct izmir_static_environment *e, size_t procedure_index)
+{
+  return e->procedure_labels [e->program->procedure_no + procedure_index];
+}
+
+/* Allocate a fresh temporary register and return its index. */
+jitter_int
+izmir_static_environment_fresh_temporary (struct izmir_static_environment *e);
+
+/* Release the given temporary register, which must have been the last register
+   allocated. */
+void
+izmir_static_environment_release_temporary (struct izmir_static_environment *e,
+                                            jitter_int register_index);
+
+
+#endif // #ifndef IZMIR_STATIC_ENVIRONMENT_H_
@@ -23,10 +23,102 @@
 
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "izmir-syntax.h"
 
 
+/* Program memory.
+ * ************************************************************************** */
+
+void
+izmir_program_initialize (struct izmir_program *p, const char *file_name)
+{
+  izmir_arena_initialize (& p->arena);
+  p->source_file_name = izmir_arena_clone_string (& p->arena, file_name);
+  p->procedures = NULL;
+  p->procedure_no = 0;
+  p->procedure_allocated_no = 0;
+  p->identifier_table = NULL;
+  p->identifier_table_size = 0;
+  p->identifier_no = 0;
+  /* Do not initialise p->main_statement . */
+}
+
+void *
+izmir_program_allocate (struct izmir_program *p, size_t size)
+{
+  return izmir_arena_allocate (& p->arena, size);
+}
+
+/* Return a hash of the given C string. */
+static size_t
+izmir_identifier_hash (const char *s)
+{
+  /* This is FNV-1a. */
+  uint64_t res = 14695981039346656037ULL;
+  for (; * s != '\0'; s ++)
+    res = (res ^ (unsigned char) * s) * 1099511628211ULL;
+  return res;
+}
+
+/* Return a pointer to the slot of the identifier table of the pointed program
+   which contains the given identifier, or to the free slot where it belongs if
+   it is not there.  The table must have at least one free slot. */
+static char **
+izmir_identifier_slot (struct izmir_program *p, const char *identifier)
+{
+  size_t mask = p->identifier_table_size - 1;
+  size_t i = izmir_identifier_hash (identifier) & mask;
+  while (p->identifier_table [i] != NULL
+         && strcmp (p->identifier_table [i], identifier))
+    i = (i + 1) & mask;
+  return p->identifier_table + i;
+}
+
+/* Double the size of the identifier table of the pointed program, rehashing
+   its elements. */
+static void
+izmir_grow_identifier_table (struct izmir_program *p)
+{
+  char **old_table = p->identifier_table;
+  size_t old_size = p->identifier_table_size;
+  size_t i;
+  p->identifier_table_size = (old_size == 0) ? 64 : 2 * old_size;
+  p->identifier_table
+    = izmir_program_allocate (p, sizeof (char *) * p->identifier_table_size);
+  memset (p->identifier_table, 0, sizeof (char *) * p->identifier_table_size);
+  for (i = 0; i < old_size; i ++)
+    if (old_table [i] != NULL)
+      * izmir_identifier_slot (p, old_table [i]) = old_table [i];
+}
+
+char *
+izmir_program_intern (struct izmir_program *p, const char *identifier)
+{
+  /* Keep the load factor at most one half. */
+  if (2 * (p->identifier_no + 1) > p->identifier_table_size)
+    izmir_grow_identifier_table (p);
+  char **slot = izmir_identifier_slot (p, identifier);
+  if (* slot == NULL)
+    {
+      * slot = izmir_arena_clone_string (& p->arena, identifier);
+      p->identifier_no ++;
+    }
+  return * slot;
+}
+
+void
+izmir_program_destroy (struct izmir_program *p)
+{
+  izmir_arena_finalize (& p->arena);
+  free (p);
+}
+
+
+
+
 /* Reversing of boolean primitives.
  * ************************************************************************** */
 
@@ -74,3 +166,115 @@ izmir_reverse_comparison_primitive (enum izmir_primitive p)
       jitter_fatal ("cannot reverse boolean (?) primitive: %i", (int) p);
     }
 }
+
+
+
+
+/* Array primitives.
+ * ************************************************************************** */
+
+bool
+izmir_is_array_primitive (enum izmir_primitive p)
+{
+  switch (p)
+    {
+    case izmir_primitive_array_new:
+    case izmir_primitive_array_element:
+    case izmir_primitive_array_length:
+    case izmir_primitive_array_sum:
+    case izmir_primitive_array_minimum:
+    case izmir_primitive_array_maximum:
+    case izmir_primitive_array_dot:
+      return true;
+    default:
+      return false;
+    }
+}
+
+
+
+
+/* Expression effects.
+ * ************************************************************************** */
+
+bool
+izmir_has_effects (const struct izmir_expression *e)
+{
+  switch (e->case_)
+    {
+    case izmir_expression_case_undefined:
+    case izmir_expression_case_literal:
+    case izmir_expression_case_variable:
+      return false;
+    case izmir_expression_case_if_then_else:
+      return (izmir_has_effects (e->if_then_else_condition)
+              || izmir_has_effects (e->if_then_else_then_branch)
+              || izmir_has_effects (e->if_then_else_else_branch));
+    case izmir_expression_case_primitive:
+      if (e->primitive == izmir_primitive_input
+          || izmir_is_array_primitive (e->primitive))
+        return true;
+      if ((e->primitive == izmir_primitive_divided
+           || e->primitive == izmir_primitive_remainder)
+          && (e->primitive_operand_1->case_ != izmir_expression_case_literal
+              || e->primitive_operand_1->literal == 0))
+        return true;
+      return ((e->primitive_operand_0 != NULL
+               && izmir_has_effects (e->primitive_operand_0))
+              || (e->primitive_operand_1 != NULL
+                  && izmir_has_effects (e->primitive_operand_1)));
+    default:
+      return true;
+    }
+}
+
+
+
+
+/* Block chains.
+ * ************************************************************************** */
+
+struct izmir_statement *
+izmir_block_inner_block (const struct izmir_statement *block,
+                         size_t *prefix_no)
+{
+  struct izmir_statement *body = block->block_body;
+  if (body->case_ == izmir_statement_case_block)
+    {
+      * prefix_no = 0;
+      return body;
+    }
+  if (body->case_ == izmir_statement_case_sequence
+      && body->sequence_statement_no > 0)
+    {
+      size_t last_index = body->sequence_statement_no - 1;
+      struct izmir_statement *last = body->sequence_statements [last_index];
+      if (last->case_ == izmir_statement_case_block)
+        {
+          * prefix_no = last_index;
+          return last;
+        }
+    }
+  return NULL;
+}
+
+
+
+
+/* Literal properties.
+ * ************************************************************************** */
+
+int
+izmir_power_of_two_exponent (const struct izmir_expression *e)
+{
+  if (e->case_ != izmir_expression_case_literal
+      || e->literal < 2
+      || (e->literal & (e->literal - 1)) != 0)
+    return -1;
+
+  int res = 0;
+  jitter_int k;
+  for (k = e->literal; k > 1; k >>= 1)
+    res ++;
+  return res;
+}
@@ -33,6 +33,8 @@
 #include <jitter/jitter.h>
 #include <jitter/jitter-fatal.h>
 
+#include "izmir-arena.h"
+
 
 /* About AST data structures and heap-allocation.
  * ************************************************************************** */
@@ -40,15 +42,21 @@
 /* This headers defines C data types representing a high-level AST data
    structure for a izmir program.
 
-   Unboxed AST data structures are all heap-allocated with malloc .  There is no
-   sharing within an AST (no two parents ever point to the same children) and in
-   particular every text string is allocated independently, even when the text
-   it contains is identical to the text of another string occurring elsewhere in
-   the same AST.
+   Unboxed AST data structures, including the arrays pointing to them and the
+   text of identifiers, are all allocated within an arena owned by the program
+   they belong to (see izmir-arena.h).  Nothing in an AST is ever freed
+   individually: izmir_program_destroy releases the whole AST at once.
+
+   Since nodes are not freed one by one, sharing within an AST is permitted:
+   the parser makes two parents point to the same child where a construct is
+   desugared by duplicating a subexpression.  Identifiers are interned, so that
+   every occurrence of the same name within a program points to the same
+   string.
 
-   All the allocation, right now, occurs within the parser rules.  There is no
-   explicit facility to free ASTs, but that would be trivial to add if needed in
-   the future. */
+   All the allocation, right now, occurs within the parser rules.  The parser
+   leaves the fields marked as "set by resolution" uninitialized: they are
+   filled by the resolution pass in izmir-resolve.h , which must run before
+   code generation. */
 
 
 
@@ -87,12 +95,22 @@ enum izmir_primitive
     izmir_primitive_greater_or_equal,
     izmir_primitive_logical_not,
     izmir_primitive_is_nonzero,
-    izmir_primitive_input
+    izmir_primitive_input,
+
+    /* Array primitives (see izmir-array.h).  The parser only makes element
+       reads; the others are made by resolution from calls to builtins. */
+    izmir_primitive_array_new,
+    izmir_primitive_array_element,
+    izmir_primitive_array_length,
+    izmir_primitive_array_sum,
+    izmir_primitive_array_minimum,
+    izmir_primitive_array_maximum,
+    izmir_primitive_array_dot
   };
 
-/* A variable is represented as a pointer to a malloc-allocated C string holding
-   the variable name.  There is no sharing: each instance of the same variable
-   is allocated separately. */
+/* A variable is represented as a pointer to a C string holding the variable
+   name, interned in the program arena: every instance of the same variable
+   within a program is the same pointer. */
 typedef char* izmir_variable;
 
 /* A izmir-language expression AST.  Whenever an expression is contained
@@ -110,20 +128,27 @@ struct izmir_expression
     /* An integer. */
     jitter_int literal;
 
-    /* A variable. */
-    izmir_variable variable;
+    /* Variable fields. */
+    struct
+    {
+      /* The variable name. */
+      izmir_variable variable;
+
+      /* The frame slot of the variable, set by resolution. */
+      jitter_int variable_slot;
+    };
 
     /* If-then-else fields. */
     struct
     {
-      /* A pointer to the condition expression, as a malloc-allocated struct. */
+      /* A pointer to the condition expression, as an arena-allocated struct. */
       struct izmir_expression *if_then_else_condition;
 
-      /* A pointer to the then-branch expression, as a malloc-allocated
+      /* A pointer to the then-branch expression, as an arena-allocated
          struct. */
       struct izmir_expression *if_then_else_then_branch;
 
-      /* A pointer to the else-branch expression, as a malloc-allocated
+      /* A pointer to the else-branch expression, as an arena-allocated
          struct. */
       struct izmir_expression *if_then_else_else_branch;
     };
@@ -134,11 +159,11 @@ struct izmir_expression
       /* Primitive identifier. */
       enum izmir_primitive primitive;
 
-      /* Pointer to a malloc-allocated first operand structure as an expression;
+      /* Pointer to an arena-allocated first operand structure as an expression;
          NULL if there is no first operand. */
       struct izmir_expression *primitive_operand_0;
 
-      /* Pointer to a malloc-allocated second operand structure as an
+      /* Pointer to an arena-allocated second operand structure as an
          expression; NULL if there is no second operand. */
       struct izmir_expression *primitive_operand_1;
     };
@@ -149,6 +174,10 @@ struct izmir_expression
       izmir_variable callee;
       struct izmir_expression **actuals;
       size_t actual_no;
+
+      /* The index of the callee in the procedures of the program, set by
+         resolution. */
+      size_t callee_index;
     };
   }; /* end of the anonymous union. */
 };
@@ -164,7 +193,22 @@ enum izmir_statement_case
     izmir_statement_case_if_then_else,
     izmir_statement_case_repeat_until,
     izmir_statement_case_return,
-    izmir_statement_case_call
+    izmir_statement_case_call,
+    izmir_statement_case_element_assignment,
+    izmir_statement_case_bulk,
+    izmir_statement_case_inlined,
+    izmir_statement_case_inlined_exit
+  };
+
+/* A bulk operation on whole arrays, as a statement.  Each operation has the
+   operands of the izmir_array_ function with the same name (see
+   izmir-array.h), without the heap. */
+enum izmir_bulk_operation
+  {
+    izmir_bulk_operation_fill,
+    izmir_bulk_operation_copy,
+    izmir_bulk_operation_add,
+    izmir_bulk_operation_multiply
   };
 
 
@@ -181,6 +225,9 @@ struct izmir_statement
   /* The statement case. */
   enum izmir_statement_case case_;
 
+  /* The source line where the statement begins. */
+  int line;
+
   /* Statement fields, as an anonymous union.  Some fields of the anonymous
      union are anonymous structs. */
   union
@@ -193,6 +240,9 @@ struct izmir_statement
       /* The variable being declared. */
       izmir_variable block_variable;
       struct izmir_statement *block_body;
+
+      /* The frame slot of the declared variable, set by resolution. */
+      jitter_int block_slot;
     };
 
     /* Assignmenet fields. */
@@ -202,75 +252,81 @@ struct izmir_statement
       izmir_variable assignment_variable;
 
       /* A pointer to the expression whose value will be set into the
-         variable, as a malloc-allocated struct. */
+         variable, as an arena-allocated struct. */
       struct izmir_expression *assignment_expression;
+
+      /* The frame slot of the set variable, set by resolution. */
+      jitter_int assignment_slot;
     };
 
-    /* A pointer to the expression to be printed, as a malloc-allocated
+    /* A pointer to the expression to be printed, as an arena-allocated
        struct. */
     struct izmir_expression *print_expression;
 
     /* Sequence fields. */
     struct
     {
-      /* A pointer to the first statement in the sequence, as a malloc-allocated
-         struct.  The parser will nest sequences on the right, but there is no
-         deep reason why the pointed first statement could not be a sequence as
-         well. */
-      struct izmir_statement *sequence_statement_0;
-
-      /* A pointer to the second statement in the sequence, as a malloc-allocated
-         struct.  The second statement may be another sequence. */
-      struct izmir_statement *sequence_statement_1;
+      /* An arena-allocated array of pointers to the statements in the
+         sequence, as arena-allocated structs, in execution order.  The
+         parser builds one flat sequence per statement list, however long;
+         only optimization and inlining may make a sequence an element of
+         another. */
+      struct izmir_statement **sequence_statements;
+
+      /* The number of elements in sequence_statements . */
+      size_t sequence_statement_no;
     };
 
     /* If-then-else fields. */
     struct
     {
-      /* A pointer to the condition expression, as a malloc-allocated struct. */
+      /* A pointer to the condition expression, as an arena-allocated struct. */
       struct izmir_expression *if_then_else_condition;
 
-      /* A pointer to the then-branch statement, as a malloc-allocated struct. */
+      /* A pointer to the then-branch statement, as an arena-allocated
+         struct. */
       struct izmir_statement *if_then_else_then_branch;
 
-      /* A pointer to the else-branch statement, as a malloc-allocated struct. */
+      /* A pointer to the else-branch statement, as an arena-allocated
+         struct. */
       struct izmir_statement *if_then_else_else_branch;
     };
 
     /* If-then fields. */
     struct
     {
-      /* A pointer to the condition expression, as a malloc-allocated struct. */
+      /* A pointer to the condition expression, as an arena-allocated struct. */
       struct izmir_expression *if_then_condition;
 
-      /* A pointer to the then-branch statement, as a malloc-allocated struct. */
+      /* A pointer to the then-branch statement, as an arena-allocated
+         struct. */
       struct izmir_statement *if_then_then_branch;
     };
 
     /* While-do fields. */
     struct
     {
-      /* A pointer to the guard expression, as a malloc-allocated struct. */
+      /* A pointer to the guard expression, as an arena-allocated struct. */
       struct izmir_expression *while_do_guard;
 
-      /* A pointer to the body statement, as a malloc-allocated struct. */
+      /* A pointer to the body statement, as an arena-allocated struct. */
       struct izmir_statement *while_do_body;
     };
 
     /* Repeat-until fields. */
     struct
     {
-      /* A pointer to the body statement, as a malloc-allocated struct. */
+      /* A pointer to the body statement, as an arena-allocated struct. */
       struct izmir_statement *repeat_until_body;
 
-      /* A pointer to the guard expression, as a malloc-allocated struct. */
+      /* A pointer to the guard expression, as an arena-allocated struct. */
       struct izmir_expression *repeat_until_guard;
     };
 
     /* Return fields. */
     struct
     {
-      /* A pointer to the return expression, as a malloc-allocated struct. */
+      /* A pointer to the return expression, as an arena-allocated struct. */
       struct izmir_expression *return_result;
     };
 
@@ -280,44 +336,149 @@ struct izmir_statement
       izmir_variable callee;
       struct izmir_expression **actuals;
       size_t actual_no;
+
+      /* The index of the callee in the procedures of the program, set by
+         resolution. */
+      size_t callee_index;
+    };
+
+    /* Element assignment fields. */
+    struct
+    {
+      /* A pointer to the array expression, always a variable, as an
+         arena-allocated struct. */
+      struct izmir_expression *element_array;
+
+      /* Pointers to the index expression and to the expression whose value
+         will be set into the element, as arena-allocated structs. */
+      struct izmir_expression *element_index;
+      struct izmir_expression *element_value;
+    };
+
+    /* Bulk operation fields.  A bulk statement is made by resolution from a
+       call to a builtin, reusing the actuals. */
+    struct
+    {
+      enum izmir_bulk_operation bulk_operation;
+      struct izmir_expression **bulk_operands;
+      size_t bulk_operand_no;
+    };
+
+    /* Inlined fields.  An inlined statement is made by inlining (see
+       izmir-inline.h) from the body of a procedure, and may be left early by
+       an inlined exit statement, which a return becomes. */
+    struct
+    {
+      /* A pointer to the inlined body, as an arena-allocated struct. */
+      struct izmir_statement *inlined_body;
+
+      /* The label right past the inlined body, set by code generation. */
+      jitter_int inlined_exit_label;
+    };
+
+    /* Inlined exit fields. */
+    struct
+    {
+      /* A pointer to the inlined statement to leave, which contains this
+         one. */
+      struct izmir_statement *inlined_exit_target;
     };
   }; /* end of the anonymous union. */
 };
 
 struct izmir_procedure
 {
-  /* A pointer to the procedure name as a malloc-allocated C string. */
+  /* A pointer to the procedure name as an arena-allocated C string. */
   char *procedure_name;
 
-  /* A malloc-allocated array of malloc-allocated C strings containing formal
+  /* An arena-allocated array of arena-allocated C strings containing formal
      parameter names. */
   char **formals;
 
   /* The number of formal parameters. */
   size_t formal_no;
 
+  /* The number of allocated elements in formals . */
+  size_t formal_allocated_no;
+
   /* The procedure body. */
   struct izmir_statement *body;
+
+  /* The number of frame slots needed by the procedure, formals included, set
+     by resolution. */
+  size_t slot_no;
 };
 
 /* A izmir program AST.  Right now a program consists of a single
    statement. */
 struct izmir_program
 {
-  /* A pointer to the source file pathname as a malloc-allocated C string. */
+  /* A pointer to the source file pathname as an arena-allocated C string. */
   char *source_file_name;
 
-  /* A malloc-allocated array of pointers to malloc-allocated procedures. */
+  /* An arena-allocated array of pointers to arena-allocated procedures. */
   struct izmir_procedure **procedures;
 
   /* The number of procedures. */
   size_t procedure_no;
 
-  /* A pointer to the main statement, as a malloc-allocated struct. */
+  /* The number of allocated elements in procedures . */
+  size_t procedure_allocated_no;
+
+  /* A pointer to the main statement, as an arena-allocated struct. */
   struct izmir_statement *main_statement;
+
+  /* The number of frame slots needed by the main statement, set by
+     resolution. */
+  size_t main_slot_no;
+
+  /* Non-false iff the program may create arrays, set by resolution. */
+  bool uses_arrays;
+
+  /* The arena holding every AST node, array and identifier of this
+     program. */
+  struct izmir_arena arena;
+
+  /* A hash table of the interned identifiers, as an arena-allocated array of
+     identifier_table_size pointers to C strings, NULL for free slots.  The
+     size is zero or a power of two. */
+  char **identifier_table;
+
+  /* The number of allocated elements in identifier_table . */
+  size_t identifier_table_size;
+
+  /* The number of non-NULL elements in identifier_table . */
+  size_t identifier_no;
 };
 
 
+
+
+/* Program memory.
+ * ************************************************************************** */
+
+/* Initialize the pointed program to have no procedures, a fresh arena and the
+   given source file name, which is copied.  The main statement is not
+   initialized. */
+void
+izmir_program_initialize (struct izmir_program *p, const char *file_name);
+
+/* Return a pointer to a fresh uninitialized object of the given size in the
+   arena of the pointed program. */
+void *
+izmir_program_allocate (struct izmir_program *p, size_t size);
+
+/* Return the interned copy of the given identifier within the pointed program,
+   allocating it in the program arena the first time. */
+char *
+izmir_program_intern (struct izmir_program *p, const char *identifier);
+
+/* Release every resource of the pointed program, including the heap-allocated
+   struct itself.  Every pointer into the AST becomes invalid. */
+void
+izmir_program_destroy (struct izmir_program *p);
+
+
 
 
 /* Boolean primitives.
@@ -336,4 +497,60 @@ enum izmir_primitive
 izmir_reverse_comparison_primitive (enum izmir_primitive p);
 
 
+
+
+/* Array primitives.
+ * ************************************************************************** */
+
+/* Return non-false iff the given primitive works on arrays. */
+bool
+izmir_is_array_primitive (enum izmir_primitive p);
+
+
+
+
+/* Expression effects.
+ * ************************************************************************** */
+
+/* Return non-false iff evaluating the pointed expression may do anything more
+   than computing a result: reading input, calling a procedure, allocating or
+   using an array, or failing because of a division by zero.  Such expressions
+   may be neither removed, duplicated nor reordered with respect to one
+   another. */
+bool
+izmir_has_effects (const struct izmir_expression *e);
+
+
+
+
+/* Block chains.
+ * ************************************************************************** */
+
+/* A block extends to the end of the statement list containing it, so a list
+   declaring n variables nests a chain of n blocks, each the last statement in
+   the body of the previous one.  Passes walk such chains with a loop rather
+   than by recursion, so that the C stack does not grow with the number of
+   declarations.
+
+   If the body of the pointed block statement is another block, or a sequence
+   whose last statement is a block, return that block, and set *prefix_no to
+   the number of statements of the body before it: those are the first
+   *prefix_no elements of the sequence.  Otherwise return NULL. */
+struct izmir_statement *
+izmir_block_inner_block (const struct izmir_statement *block,
+                         size_t *prefix_no);
+
+
+
+
+/* Literal properties.
+ * ************************************************************************** */
+
+/* If the pointed expression is a literal positive power of two other than one,
+   return its base-two logarithm; otherwise return -1.  This is useful to
+   recognize divisions and remainders which can be computed by shifting. */
+int
+izmir_power_of_two_exponent (const struct izmir_expression *e);
+
+
 #endif // #ifndef JITTER_IZMIR_SYNTAX_H_
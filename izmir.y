@@ -25,6 +25,7 @@
 /* This code does not go to the generated header. */
 %{
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
 
 #include <jitter/jitter-malloc.h>
@@ -32,11 +33,15 @@
 #include <jitter/jitter-parse-int.h>
 #include <jitter/jitter-string.h>
 
+#include "izmir-error.h"
 #include "izmir-syntax.h"
 #include "izmir-parser.h"
 #include "izmir-scanner.h"
 
-/* This is currently a fatal error.  I could longjmp away instead. */
+/* Report a syntax error through izmir_fail , which may longjmp away from the
+   parser.  The parser stack is then allocated with alloca, so that it goes
+   away along with the C frames. */
+#define YYSTACK_USE_ALLOCA 1
 static void
 izmir_error (YYLTYPE *locp, struct izmir_program *p,
                   yyscan_t scanner, char *message)
@@ -58,99 +63,91 @@ izmir_error (YYLTYPE *locp, struct izmir_program *p,
 #define IZMIR_LINENO \
   (izmir_get_lineno (izmir_scanner))
 
-/* A copy of what would be yytext in a non-reentrant scanner. */
-#define IZMIR_TEXT_COPY \
-  (jitter_clone_string (IZMIR_TEXT))
+/* The interned copy of what would be yytext in a non-reentrant scanner,
+   allocated in the arena of the program being parsed. */
+#define IZMIR_TEXT_INTERNED \
+  (izmir_program_intern (p, IZMIR_TEXT))
 
-/* Initialise the fields of the pointed program, except for the main statement.
-   The name will be copied.  */
-static void izmir_initialize_program (struct izmir_program *p,
-                               const char *file_name)
-{
-  p->source_file_name = jitter_clone_string (file_name);
-  p->procedures = NULL;
-  p->procedure_no = 0;
-  /* Do not initialise p->main_statement . */
-}
-
-/* Return a pointer to a fresh malloc-allocated expression of the given case.
-   No field is initialized but case_. */
+/* Return a pointer to a fresh expression of the given case allocated in the
+   arena of the pointed program.  No field is initialized but case_. */
 static struct izmir_expression*
-izmir_make_expression (enum izmir_expression_case case_)
+izmir_make_expression (struct izmir_program *p,
+                       enum izmir_expression_case case_)
 {
-  struct izmir_expression* res = jitter_xmalloc (sizeof (struct izmir_expression));
+  struct izmir_expression* res
+    = izmir_program_allocate (p, sizeof (struct izmir_expression));
   res->case_ = case_;
 
   return res;
 }
 
-/* Return a pointer to a fresh malloc-allocated expression of the primitive
+/* Return a pointer to a fresh arena-allocated expression of the primitive
    case, with the given binary primitive and operands.  Every field is
    initalized. */
-static struct izmir_expression* izmir_make_binary (enum izmir_primitive primitive, struct izmir_expression *operand_0, struct izmir_expression *operand_1)
+static struct izmir_expression* izmir_make_binary (struct izmir_program *p, enum izmir_primitive primitive, struct izmir_expression *operand_0, struct izmir_expression *operand_1)
 {
-  struct izmir_expression* res = izmir_make_expression (izmir_expression_case_primitive);
+  struct izmir_expression* res = izmir_make_expression (p, izmir_expression_case_primitive);
   res->primitive = primitive;
   res->primitive_operand_0 = operand_0;
   res->primitive_operand_1 = operand_1;
   return res;
 }
 
-/* Return a pointer to a fresh malloc-allocated expression of the primitive
+/* Return a pointer to a fresh arena-allocated expression of the primitive
    case, with the given nullary primitive.  Every field is initalized. */
-static struct izmir_expression* izmir_make_nullary (enum izmir_primitive primitive)
+static struct izmir_expression* izmir_make_nullary (struct izmir_program *p, enum izmir_primitive primitive)
 {
-  return izmir_make_binary (primitive, NULL, NULL);
+  return izmir_make_binary (p, primitive, NULL, NULL);
 }
 
-static struct izmir_expression* izmir_make_unary (enum izmir_primitive primitive, struct izmir_expression *operand_0)
+static struct izmir_expression* izmir_make_unary (struct izmir_program *p, enum izmir_primitive primitive, struct izmir_expression *operand_0)
 {
-  return izmir_make_binary (primitive, operand_0, NULL);
+  return izmir_make_binary (p, primitive, operand_0, NULL);
 }
 
-static struct izmir_statement* izmir_make_statement (enum izmir_statement_case case_)
+/* Return a pointer to a fresh statement of the given case beginning at the
+   given source line, allocated in the arena of the pointed program.  No field
+   is initialized but case_ and line. */
+static struct izmir_statement* izmir_make_statement (struct izmir_program *p, enum izmir_statement_case case_, int line)
 {
-  struct izmir_statement* res = jitter_xmalloc (sizeof (struct izmir_statement));
+  struct izmir_statement* res
+    = izmir_program_allocate (p, sizeof (struct izmir_statement));
   res->case_ = case_;
+  res->line = line;
 
   return res;
 }
 
-/* Return a pointer to a fresh malloc-allocated statement containing a sequence
-   setting the given variable to the pointed expression, and then the pointed
-   statement. */
-static struct izmir_statement* izmir_make_block (izmir_variable v, struct izmir_expression *e, struct izmir_statement *body)
-{
-  struct izmir_statement *sequence
-    = izmir_make_statement (izmir_statement_case_sequence);
-  struct izmir_statement *assignment
-    = izmir_make_statement (izmir_statement_case_assignment);
-  assignment->assignment_variable = v;
-  assignment->assignment_expression = e;
-  sequence->sequence_statement_0 = assignment;
-  sequence->sequence_statement_1 = body;
-  return sequence;
-}
-
 /* Add an element at the end of the pointed array of pointers, which is
-   currently allocated with malloc and of size *element_no (in elements), by
-   using realloc.  Add new_pointer as the new value at the end.  Increment the
-   pointed size. */
-static void izmir_append_pointer (void ***pointers, size_t *element_no,
-                           void *new_pointer)
+   currently allocated in the arena of the pointed program with *allocated_no
+   elements of which the first *element_no are used.  Add new_pointer as the
+   new value at the end, doubling the allocated size when the array is full so
+   that building an array of n elements takes O(n) time.  Increment the pointed
+   size. */
+static void izmir_append_pointer (struct izmir_program *p,
+                                  void ***pointers, size_t *element_no,
+                                  size_t *allocated_no, void *new_pointer)
 {
-  * pointers = jitter_xrealloc (* pointers,
-                                sizeof (void *) * ((* element_no) + 1));
+  if (* element_no == * allocated_no)
+    {
+      size_t new_allocated_no = (* allocated_no == 0) ? 4 : 2 * (* allocated_no);
+      * pointers = izmir_arena_reallocate (& p->arena, * pointers,
+                                           sizeof (void *) * (* allocated_no),
+                                           sizeof (void *) * new_allocated_no);
+      * allocated_no = new_allocated_no;
+    }
   (* pointers) [* element_no] = new_pointer;
   (* element_no) ++;
 }
 
-static struct izmir_procedure* izmir_make_procedure (const char *procedure_name)
+static struct izmir_procedure* izmir_make_procedure (struct izmir_program *p, const char *procedure_name)
 {
-  struct izmir_procedure *res = jitter_xmalloc (sizeof (struct izmir_procedure));
-  res->procedure_name = jitter_clone_string (procedure_name);
+  struct izmir_procedure *res
+    = izmir_program_allocate (p, sizeof (struct izmir_procedure));
+  res->procedure_name = izmir_program_intern (p, procedure_name);
   res->formals = NULL;
   res->formal_no = 0;
+  res->formal_allocated_no = 0;
   /* Do not initialise res->body . */
   return res;
 }
@@ -158,20 +155,19 @@ static struct izmir_procedure* izmir_make_procedure (const char *procedure_name)
 static void izmir_program_append_procedure (struct izmir_program *p,
                                      const char *procedure_name)
 {
-  izmir_append_pointer ((void ***) & p->procedures, & p->procedure_no,
-                             izmir_make_procedure (procedure_name));
+  izmir_append_pointer (p, (void ***) & p->procedures, & p->procedure_no,
+                        & p->procedure_allocated_no,
+                        izmir_make_procedure (p, procedure_name));
 }
 
-static void izmir_procedure_append_formal (struct izmir_procedure *p,
-                                    const char *new_formal_name)
+static void izmir_procedure_append_formal (struct izmir_program *p,
+                                           struct izmir_procedure *procedure,
+                                           char *new_formal_name)
 {
-  int i;
-  for (i = 0; i < p->formal_no; i ++)
-    if (! strcmp (p->formals [i], new_formal_name))
-      jitter_fatal ("duplicated formal name %s in %s",
-                    p->procedure_name, new_formal_name);
-  izmir_append_pointer ((void ***) & p->formals, & p->formal_no,
-                             jitter_clone_string (new_formal_name));
+  /* Duplicate formals are rejected later, by resolution. */
+  izmir_append_pointer (p, (void ***) & procedure->formals,
+                        & procedure->formal_no, & procedure->formal_allocated_no,
+                        new_formal_name);
 }
 
 static struct izmir_procedure* izmir_last_procedure (struct izmir_program *p)
@@ -181,26 +177,131 @@ static struct izmir_procedure* izmir_last_procedure (struct izmir_program *p)
   return p->procedures [p->procedure_no - 1];
 }
 
-/* These are used internally, when parsing sequences. */
+/* These are used internally, when parsing sequences.  Sequences are
+   arena-allocated like everything else. */
 struct izmir_sequence
 {
   void **pointers;
   size_t pointer_no;
+  size_t pointer_allocated_no;
 };
 
 static void izmir_initialize_sequence(struct izmir_sequence *s)
 {
   s->pointers = NULL;
   s->pointer_no = 0;
+  s->pointer_allocated_no = 0;
 }
 
-static struct izmir_sequence* izmir_make_sequence (void)
+static struct izmir_sequence* izmir_make_sequence (struct izmir_program *p)
 {
-  struct izmir_sequence *res = jitter_xmalloc (sizeof (struct izmir_sequence));
+  struct izmir_sequence *res
+    = izmir_program_allocate (p, sizeof (struct izmir_sequence));
   izmir_initialize_sequence (res);
   return res;
 }
 
+/* Append the given pointer, to an expression or a statement, to the pointed
+   sequence. */
+static void izmir_sequence_append (struct izmir_program *p,
+                                   struct izmir_sequence *s,
+                                   void *pointer)
+{
+  izmir_append_pointer (p, & s->pointers, & s->pointer_no,
+                        & s->pointer_allocated_no, pointer);
+}
+
+/* Append the pointed statement to the pointed sequence of statements.  If the
+   statement is itself a sequence, as from a begin..end statement, append its
+   elements instead, so that sequences stay flat. */
+static void izmir_sequence_append_statement (struct izmir_program *p,
+                                             struct izmir_sequence *s,
+                                             struct izmir_statement *st)
+{
+  if (st->case_ == izmir_statement_case_sequence)
+    {
+      size_t i;
+      for (i = 0; i < st->sequence_statement_no; i ++)
+        izmir_sequence_append (p, s, st->sequence_statements [i]);
+    }
+  else
+    izmir_sequence_append (p, s, st);
+}
+
+/* Return a pointer to a statement executing the statements in the pointed
+   sequence in order, beginning at the given source line: a skip statement if
+   the sequence is empty, its only statement if it has one, and otherwise a
+   sequence statement sharing the array of the sequence. */
+static struct izmir_statement* izmir_make_sequence_statement (struct izmir_program *p, struct izmir_sequence *s, int line)
+{
+  if (s->pointer_no == 0)
+    return izmir_make_statement (p, izmir_statement_case_skip, line);
+  else if (s->pointer_no == 1)
+    return s->pointers [0];
+
+  struct izmir_statement *res
+    = izmir_make_statement (p, izmir_statement_case_sequence, line);
+  res->sequence_statements = (struct izmir_statement **) s->pointers;
+  res->sequence_statement_no = s->pointer_no;
+  return res;
+}
+
+/* Append to the pointed sequence of statements a declaration of the given
+   variable, initialized to the pointed expression at the given source line:
+   a block with no body yet, followed by the assignment of the initial value.
+   izmir_make_statements gives the block its body. */
+static void izmir_sequence_append_declaration (struct izmir_program *p,
+                                               struct izmir_sequence *s,
+                                               izmir_variable v,
+                                               struct izmir_expression *e,
+                                               int line)
+{
+  struct izmir_statement *block
+    = izmir_make_statement (p, izmir_statement_case_block, line);
+  block->block_variable = v;
+  block->block_body = NULL;
+  struct izmir_statement *assignment
+    = izmir_make_statement (p, izmir_statement_case_assignment, line);
+  assignment->assignment_variable = v;
+  assignment->assignment_expression = e;
+  izmir_sequence_append (p, s, block);
+  izmir_sequence_append (p, s, assignment);
+}
+
+/* Return a pointer to a statement executing the statements in the pointed
+   sequence, as izmir_make_sequence_statement does, after giving each
+   declaration from izmir_sequence_append_declaration its body: a block
+   extends to the end of its statement list, so its body is every statement
+   following it, the blocks of later declarations included.  The sequence is
+   scanned once backwards, and each statement is copied at most once, so that
+   the time is linear in the length of the list and the C stack does not grow
+   with the number of declarations. */
+static struct izmir_statement* izmir_make_statements (struct izmir_program *p, struct izmir_sequence *s, int line)
+{
+  struct izmir_statement **statements
+    = (struct izmir_statement **) s->pointers;
+  /* The statements up to end , excluded, remain to be nested. */
+  size_t end = s->pointer_no;
+  size_t i;
+  for (i = s->pointer_no; i > 0; i --)
+    {
+      struct izmir_statement *block = statements [i - 1];
+      if (block->case_ != izmir_statement_case_block
+          || block->block_body != NULL)
+        continue;
+      /* A declaration is followed at least by its initialization. */
+      struct izmir_sequence body;
+      izmir_initialize_sequence (& body);
+      size_t j;
+      for (j = i; j < end; j ++)
+        izmir_sequence_append (p, & body, statements [j]);
+      block->block_body = izmir_make_sequence_statement (p, & body, block->line);
+      end = i;
+    }
+  s->pointer_no = end;
+  return izmir_make_sequence_statement (p, s, line);
+}
+
 
 %}
 
@@ -220,6 +321,8 @@ static struct izmir_sequence* izmir_make_sequence (void)
 void izmir_scan_error (void *izmir_scanner) __attribute__ ((noreturn));
 struct izmir_program* izmir_parse_file_star (FILE *input_file);
 struct izmir_program* izmir_parse_file (const char *input_file_name);
+struct izmir_program* izmir_parse_memory (const char *text, size_t size,
+                                          const char *file_name);
 } /* end of %code requires */
 
 %union
@@ -245,6 +348,7 @@ struct izmir_program* izmir_parse_file (const char *input_file_name);
 %token WHILE DO
 %token REPEAT UNTIL
 %token OPEN_PAREN CLOSE_PAREN
+%token OPEN_BRACKET CLOSE_BRACKET
 %token UNDEFINED
        VARIABLE
        /*BINARY_LITERAL OCTAL_LITERAL*/ DECIMAL_LITERAL /*HEXADECIMAL_LITERAL*/
@@ -263,9 +367,8 @@ struct izmir_program* izmir_parse_file (const char *input_file_name);
 %type <expression> expression;
 %type <statement> statement;
 %type <statement> statements;
-%type <statement> one_or_more_statements;
-%type <statement> block;
-%type <statement> block_rest;
+%type <pointers> statement_list;
+%type <pointers> declarations;
 %type <statement> if_statement;
 %type <statement> if_statement_rest;
 %type <expression> optional_initialization;
@@ -276,10 +379,16 @@ struct izmir_program* izmir_parse_file (const char *input_file_name);
 
 %%
 
+/* Lists are left-recursive here and below, so that the parser stack depth
+   does not grow with the number of procedures or statements. */
 program:
-  statements
-  { p->main_statement = $1; }
-| procedure_definition program
+  procedure_definitions statements
+  { p->main_statement = $2; }
+;
+
+procedure_definitions:
+  /* nothing */
+| procedure_definitions procedure_definition
 ;
 
 /* FIXME: use the style of actuals for formals and procedures. */
@@ -290,27 +399,25 @@ formals:
 
 non_empty_formals:
   variable
-    { izmir_procedure_append_formal (izmir_last_procedure (p), $1); }
+    { izmir_procedure_append_formal (p, izmir_last_procedure (p), $1); }
 | variable COMMA
-    { izmir_procedure_append_formal (izmir_last_procedure (p), $1); }
+    { izmir_procedure_append_formal (p, izmir_last_procedure (p), $1); }
   non_empty_formals
 ;
 
 actuals:
   /* nothing */
-  { $$ = izmir_make_sequence (); }
+  { $$ = izmir_make_sequence (p); }
 | non_empty_actuals
   { $$ = $1; }
   ;
 
 non_empty_actuals:
   expression
-  { $$ = izmir_make_sequence ();
-    izmir_append_pointer ((void ***) & $$->pointers, & $$->pointer_no,
-                               $1); }
+  { $$ = izmir_make_sequence (p);
+    izmir_sequence_append (p, $$, $1); }
 | non_empty_actuals COMMA expression
-  { izmir_append_pointer ((void ***) & $$->pointers, & $$->pointer_no,
-                               $3); }
+  { izmir_sequence_append (p, $$, $3); }
 ;
 
 procedure_definition:
@@ -322,21 +429,28 @@ procedure_definition:
 
 statement:
   optional_skip SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_skip); }
+  { $$ = izmir_make_statement (p, izmir_statement_case_skip, @$.first_line); }
 | variable SET_TO expression SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_assignment);
+  { $$ = izmir_make_statement (p, izmir_statement_case_assignment, @$.first_line);
     $$->assignment_variable = $1;
     $$->assignment_expression = $3; }
+| variable OPEN_BRACKET expression CLOSE_BRACKET SET_TO expression SEMICOLON
+  { $$ = izmir_make_statement (p, izmir_statement_case_element_assignment,
+                               @$.first_line);
+    $$->element_array = izmir_make_expression (p, izmir_expression_case_variable);
+    $$->element_array->variable = $1;
+    $$->element_index = $3;
+    $$->element_value = $6; }
 | RETURN expression SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_return);
+  { $$ = izmir_make_statement (p, izmir_statement_case_return, @$.first_line);
     $$->return_result = $2; }
 | RETURN SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_return);
+  { $$ = izmir_make_statement (p, izmir_statement_case_return, @$.first_line);
     struct izmir_expression *e
-      = izmir_make_expression (izmir_expression_case_undefined);
+      = izmir_make_expression (p, izmir_expression_case_undefined);
     $$->return_result = e; }
 | PRINT expression SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_print);
+  { $$ = izmir_make_statement (p, izmir_statement_case_print, @$.first_line);
     $$->print_expression = $2; }
 | begin statements end
   { $$ = $2; }
@@ -346,33 +460,32 @@ statement:
   { /* Parse "while A do B end" as "if A then repeat B until not A else
        skip". */
     struct izmir_statement *r
-      = izmir_make_statement (izmir_statement_case_repeat_until);
+      = izmir_make_statement (p, izmir_statement_case_repeat_until, @$.first_line);
     r->repeat_until_body = $4;
-    /* FIXME: clone $2 into a separate heap object, if I want to be able to free
-       ASTs. */
+    /* The guard $2 is shared by the two parents, which is harmless since the
+       AST is freed all at once. */
     r->repeat_until_guard
-      = izmir_make_unary (izmir_primitive_logical_not, $2);
-    $$ = izmir_make_statement (izmir_statement_case_if_then_else);
+      = izmir_make_unary (p, izmir_primitive_logical_not, $2);
+    $$ = izmir_make_statement (p, izmir_statement_case_if_then_else, @$.first_line);
     $$->if_then_else_condition = $2;
     $$->if_then_else_then_branch = r;
     $$->if_then_else_else_branch
-      = izmir_make_statement (izmir_statement_case_skip); }
+      = izmir_make_statement (p, izmir_statement_case_skip, @$.first_line); }
 | REPEAT statements UNTIL expression SEMICOLON
-  { $$ = izmir_make_statement (izmir_statement_case_repeat_until);
+  { $$ = izmir_make_statement (p, izmir_statement_case_repeat_until, @$.first_line);
     $$->repeat_until_body = $2;
     $$->repeat_until_guard = $4; }
 | variable OPEN_PAREN actuals CLOSE_PAREN
-    { $$ = izmir_make_statement (izmir_statement_case_call);
+    { $$ = izmir_make_statement (p, izmir_statement_case_call, @$.first_line);
       $$->callee = $1;
       $$->actuals = (struct izmir_expression **) $3->pointers;
       $$->actual_no = $3->pointer_no;
-      /* FIXME: I could free $3 if I cared about not leaking memory at
-         parsing time. */}
+      /* $3 stays in the arena until the program is destroyed. */}
   ;
 
 if_statement:
   expression THEN statements if_statement_rest
-  { $$ = izmir_make_statement (izmir_statement_case_if_then_else);
+  { $$ = izmir_make_statement (p, izmir_statement_case_if_then_else, @$.first_line);
     $$->if_then_else_condition = $1;
     $$->if_then_else_then_branch = $3;
     $$->if_then_else_else_branch = $4; }
@@ -381,9 +494,9 @@ if_statement:
 if_statement_rest:
   end
   { /* Parse "if A then B end" as "if A then B else skip end". */
-    $$ = izmir_make_statement (izmir_statement_case_skip); }
+    $$ = izmir_make_statement (p, izmir_statement_case_skip, @$.first_line); }
 | ELIF expression THEN statements if_statement_rest
-  { $$ = izmir_make_statement (izmir_statement_case_if_then_else);
+  { $$ = izmir_make_statement (p, izmir_statement_case_if_then_else, @$.first_line);
     $$->if_then_else_condition = $2;
     $$->if_then_else_then_branch = $4;
     $$->if_then_else_else_branch = $5; }
@@ -391,114 +504,116 @@ if_statement_rest:
   { $$ = $2; }
 ;
 
+/* A block extends to the end of the statement list containing it.  Like the
+   other statements, declarations are collected into the list with left
+   recursion; izmir_make_statements then nests the blocks. */
 statements:
-  /* nothing */
-  { $$ = izmir_make_statement (izmir_statement_case_skip); }
-| one_or_more_statements
-  { $$ = $1; }
-  ;
-
-one_or_more_statements:
-  statement
-  { $$ = $1; }
-| statement one_or_more_statements
-  { $$ = izmir_make_statement (izmir_statement_case_sequence);
-    $$->sequence_statement_0 = $1;
-    $$->sequence_statement_1 = $2; }
-| VAR block
-  { $$ = $2; }
+  statement_list
+  { $$ = izmir_make_statements (p, $1, @$.first_line); }
   ;
 
-block:
-  variable optional_initialization block_rest
-  { $$ = izmir_make_statement (izmir_statement_case_block);
-    $$->block_variable = $1;
-    $$->block_body = izmir_make_block ($1, $2, $3); }
+statement_list:
+  /* nothing */
+  { $$ = izmir_make_sequence (p); }
+| statement_list statement
+  { izmir_sequence_append_statement (p, $1, $2);
+    $$ = $1; }
+| statement_list VAR declarations SEMICOLON
+  { size_t i;
+    for (i = 0; i < $3->pointer_no; i ++)
+      izmir_sequence_append (p, $1, $3->pointers [i]);
+    $$ = $1; }
   ;
 
-block_rest:
-  SEMICOLON statements
-  { $$ = $2; }
-| COMMA block
-  { $$ = $2; }
+declarations:
+  variable optional_initialization
+  { $$ = izmir_make_sequence (p);
+    izmir_sequence_append_declaration (p, $$, $1, $2, @$.first_line); }
+| declarations COMMA variable optional_initialization
+  { izmir_sequence_append_declaration (p, $1, $3, $4, @3.first_line);
+    $$ = $1; }
   ;
 
 optional_initialization:
   /* nothing*/
-  { $$ = izmir_make_expression (izmir_expression_case_undefined); }
+  { $$ = izmir_make_expression (p, izmir_expression_case_undefined); }
 | EQUAL expression
   { $$ = $2; }
   ;
 
 expression:
   UNDEFINED
-  { $$ = izmir_make_expression (izmir_expression_case_undefined); }
+  { $$ = izmir_make_expression (p, izmir_expression_case_undefined); }
 | literal
-  { $$ = izmir_make_expression (izmir_expression_case_literal);
+  { $$ = izmir_make_expression (p, izmir_expression_case_literal);
     $$->literal = $1; }
 | variable
-  { $$ = izmir_make_expression (izmir_expression_case_variable);
+  { $$ = izmir_make_expression (p, izmir_expression_case_variable);
     $$->variable = $1; }
 | OPEN_PAREN expression CLOSE_PAREN
   { $$ = $2; }
 | IF if_expression
   { $$ = $2; }
 | expression PLUS expression
-  { $$ = izmir_make_binary (izmir_primitive_plus, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_plus, $1, $3); }
 | expression MINUS expression
-  { $$ = izmir_make_binary (izmir_primitive_minus, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_minus, $1, $3); }
 | MINUS expression %prec UNARY_MINUS
-  { $$ = izmir_make_unary (izmir_primitive_unary_minus, $2); }
+  { $$ = izmir_make_unary (p, izmir_primitive_unary_minus, $2); }
 | expression TIMES expression
-  { $$ = izmir_make_binary (izmir_primitive_times, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_times, $1, $3); }
 | expression DIVIDED expression
-  { $$ = izmir_make_binary (izmir_primitive_divided, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_divided, $1, $3); }
 | expression REMAINDER expression
-  { $$ = izmir_make_binary (izmir_primitive_remainder, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_remainder, $1, $3); }
 | expression EQUAL expression
-  { $$ = izmir_make_binary (izmir_primitive_equal, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_equal, $1, $3); }
 | expression DIFFERENT expression
-  { $$ = izmir_make_binary (izmir_primitive_different, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_different, $1, $3); }
 | expression LESS expression
-  { $$ = izmir_make_binary (izmir_primitive_less, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_less, $1, $3); }
 | expression LESS_OR_EQUAL expression
-  { $$ = izmir_make_binary (izmir_primitive_less_or_equal, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_less_or_equal, $1, $3); }
 | expression GREATER expression
-  { $$ = izmir_make_binary (izmir_primitive_greater, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_greater, $1, $3); }
 | expression GREATER_OR_EQUAL expression
-  { $$ = izmir_make_binary (izmir_primitive_greater_or_equal, $1, $3); }
+  { $$ = izmir_make_binary (p, izmir_primitive_greater_or_equal, $1, $3); }
 | expression LOGICAL_AND expression
   { /* Parse "A and B" as "if A then B else false end". */
-    $$ = izmir_make_expression (izmir_expression_case_if_then_else);
+    $$ = izmir_make_expression (p, izmir_expression_case_if_then_else);
     $$->if_then_else_condition = $1;
     $$->if_then_else_then_branch = $3;
     $$->if_then_else_else_branch
-      = izmir_make_expression (izmir_expression_case_literal);
+      = izmir_make_expression (p, izmir_expression_case_literal);
     $$->if_then_else_else_branch->literal = 0; }
 | expression LOGICAL_OR expression
   { /* Parse "A or B" as "if A then true else B end". */
-    $$ = izmir_make_expression (izmir_expression_case_if_then_else);
+    $$ = izmir_make_expression (p, izmir_expression_case_if_then_else);
     $$->if_then_else_condition = $1;
     $$->if_then_else_then_branch
-      = izmir_make_expression (izmir_expression_case_literal);
+      = izmir_make_expression (p, izmir_expression_case_literal);
     $$->if_then_else_then_branch->literal = 1;
     $$->if_then_else_else_branch = $3; }
 | LOGICAL_NOT expression
-  { $$ = izmir_make_unary (izmir_primitive_logical_not, $2); }
+  { $$ = izmir_make_unary (p, izmir_primitive_logical_not, $2); }
 | INPUT
-  { $$ = izmir_make_nullary (izmir_primitive_input); }
+  { $$ = izmir_make_nullary (p, izmir_primitive_input); }
+| variable OPEN_BRACKET expression CLOSE_BRACKET
+  { struct izmir_expression *a
+      = izmir_make_expression (p, izmir_expression_case_variable);
+    a->variable = $1;
+    $$ = izmir_make_binary (p, izmir_primitive_array_element, a, $3); }
 | variable OPEN_PAREN actuals CLOSE_PAREN
-    { $$ = izmir_make_expression (izmir_expression_case_call);
+    { $$ = izmir_make_expression (p, izmir_expression_case_call);
       $$->callee = $1;
       $$->actuals = (struct izmir_expression **) $3->pointers;
       $$->actual_no = $3->pointer_no;
-      /* FIXME: I could free $3 if I cared about not leaking memory at
-         parsing time. */}
+      /* $3 stays in the arena until the program is destroyed. */}
   ;
 
 if_expression:
   expression THEN expression if_expression_rest
-  { $$ = izmir_make_expression (izmir_expression_case_if_then_else);
+  { $$ = izmir_make_expression (p, izmir_expression_case_if_then_else);
     $$->if_then_else_condition = $1;
     $$->if_then_else_then_branch = $3;
     $$->if_then_else_else_branch = $4; }
@@ -508,7 +623,7 @@ if_expression_rest:
   /* For expressions there is no if..then..end without else; however elif
      clauses are permitted. */
   ELIF expression THEN expression if_expression_rest
-  { $$ = izmir_make_expression (izmir_expression_case_if_then_else);
+  { $$ = izmir_make_expression (p, izmir_expression_case_if_then_else);
     $$->if_then_else_condition = $2;
     $$->if_then_else_then_branch = $4;
     $$->if_then_else_else_branch = $5; }
@@ -527,7 +642,7 @@ literal:
 
 variable:
   VARIABLE
-  { $$ = IZMIR_TEXT_COPY; }
+  { $$ = IZMIR_TEXT_INTERNED; }
   ;
 
 optional_skip:
@@ -555,10 +670,9 @@ void
 izmir_error (YYLTYPE *locp, struct izmir_program *p, yyscan_t izmir_scanner,
                  char *message)
 {
-  printf ("%s:%i: %s near \"%s\".\n",
-          (p != NULL) ? p->source_file_name : "<INPUT>",
-          izmir_get_lineno (izmir_scanner), message, IZMIR_TEXT);
-  exit (EXIT_FAILURE);
+  izmir_fail ("%s:%i: %s near \"%s\"",
+              (p != NULL) ? p->source_file_name : "<INPUT>",
+              izmir_get_lineno (izmir_scanner), message, IZMIR_TEXT);
 }
 
 void
@@ -568,8 +682,12 @@ izmir_scan_error (void *izmir_scanner)
   IZMIR_PARSE_ERROR("scan error");
 }
 
+/* Parse the given stream, using the given name in error messages, and return
+   the program.  On error close the stream if close_on_error is non-false,
+   release everything allocated so far and fail with izmir_fail . */
 static struct izmir_program *
-izmir_parse_file_star_with_name (FILE *input_file, const char *file_name)
+izmir_parse_file_star_with_name (FILE *input_file, const char *file_name,
+                                 bool close_on_error)
 {
   yyscan_t scanner;
   izmir_lex_init (&scanner);
@@ -577,11 +695,23 @@ izmir_parse_file_star_with_name (FILE *input_file, const char *file_name)
 
   struct izmir_program *res
     = jitter_xmalloc (sizeof (struct izmir_program));
-  izmir_initialize_program (res, file_name);
-  /* FIXME: if I ever make parsing errors non-fatal, call izmir_lex_destroy before
-     returning, and finalize the program -- which might be incomplete! */
+  izmir_program_initialize (res, file_name);
+
+  /* The program might be incomplete after an error, but its arena can be
+     released anyway. */
+  struct izmir_recovery recovery;
+  if (setjmp (recovery.jump) != 0)
+    {
+      izmir_lex_destroy (scanner);
+      izmir_program_destroy (res);
+      if (close_on_error)
+        fclose (input_file);
+      izmir_fail ("%s", recovery.message);
+    }
+  izmir_recovery_push (& recovery);
   if (izmir_parse (res, scanner))
     izmir_error (izmir_get_lloc (scanner), res, scanner, "parse error");
+  izmir_recovery_pop (& recovery);
   izmir_set_in (NULL, scanner);
   izmir_lex_destroy (scanner);
 
@@ -591,7 +721,7 @@ izmir_parse_file_star_with_name (FILE *input_file, const char *file_name)
 struct izmir_program *
 izmir_parse_file_star (FILE *input_file)
 {
-  return izmir_parse_file_star_with_name (input_file, "<stdin>");
+  return izmir_parse_file_star_with_name (input_file, "<stdin>", false);
 }
 
 struct izmir_program *
@@ -601,10 +731,21 @@ izmir_parse_file (const char *input_file_name)
   if ((f = fopen (input_file_name, "r")) == NULL)
     jitter_fatal ("failed opening file %s", input_file_name);
 
-  /* FIXME: if I ever make parse errors non-fatal, I'll need to close the file
-     before returning. */
   struct izmir_program *res
-    = izmir_parse_file_star_with_name (f, input_file_name);
+    = izmir_parse_file_star_with_name (f, input_file_name, true);
+  fclose (f);
+  return res;
+}
+
+struct izmir_program *
+izmir_parse_memory (const char *text, size_t size, const char *file_name)
+{
+  FILE *f;
+  if ((f = fmemopen ((void *) text, size, "r")) == NULL)
+    jitter_fatal ("failed reading %s from memory", file_name);
+
+  struct izmir_program *res
+    = izmir_parse_file_star_with_name (f, file_name, true);
   fclose (f);
   return res;
 }